@@ -0,0 +1,719 @@
+/* Synthetic WDBF generator; writes valid, and deliberately corrupted, compound files of any size for scale and stress testing.
+ * Every file is a complete Word Binary File as far as the decoder goes: header, FAT (with DIFAT sectors once there are more
+ * than 109 FAT sectors), directory, MiniFAT and mini stream, a `1Table` stream holding the CLX, and a `WordDocument` stream
+ * holding a FIB and the text. Files are written sparse; only sectors holding structures or text take up space, so a file
+ * of tens of GB is written in seconds.
+ *
+ *      --version 3|4           Major version; 512-byte (3) or 4096-byte (4) sectors. Default 3.
+ *      --size N[K|M|G]         File size; the `WordDocument` stream grows to fill it. Default: as small as the contents allow.
+ *      --FAT-sectors N         At least N FAT sectors (more than the file needs); past 109 they need DIFAT sectors.
+ *      --fragment P            Percent (0 - 100) of data sectors moved out of order; streams become chains of short runs.
+ *      --entries N             Directory entries, Root Entry, `WordDocument` and `1Table` included. Default 8.
+ *      --mini-streams N        Streams stored in the mini stream (N <= entries - 3). Default 2.
+ *      --mini-size N           Size of each of them, 1 - 4095 bytes. Default 700.
+ *      --text N                Characters of text. Default 16384.
+ *      --pieces N              Pieces the text is split over. Default 1.
+ *      --unicode               Store the text as UTF-16LE rather than CP1252.
+ *      --corrupt a,b,...       Header flaws, as detected (and repaired) by `DotDoc_Header`: signature, padding, minor, major,
+ *                              byte-order, sector-size, mini-sector-size, dir-sectors (Major Version 3 only), or all.
+ *      --seed N                Seed for the text and the fragmentation. Default 1.
+ *
+ * Build:   g++ bench/corpus_generator.cpp -std=c++20 -O2 -o corpus_generator.o
+ * Run:     ./corpus_generator.o [options] <output.doc>
+ *          ./corpus_generator.o --corpus <directory> [--scale N[K|M|G]]   - A standard set of files; `--scale` adds a Major Version 4 file of that size.
+ * */
+#include <random>
+#include "../common.hpp"
+
+#define corpus_mini_sector_size     0x40
+#define corpus_mini_cutoff          0x1000
+#define corpus_FIB_size             900     // FibBase, 14 rgW, 22 rgLw, 93 fc/lcb pairs (FibRgFcLcb97), no FibRgCswNew
+#define corpus_text_offset          0x400
+
+struct corpus_options
+{
+    ut_WORD major_version = 3;
+    ut_LSIZE size = 0;
+    ut_DWORD FAT_sectors = 0;
+    ut_DWORD fragment_percent = 0;
+    ut_DWORD entries = 8;
+    ut_DWORD mini_streams = 2;
+    ut_DWORD mini_size = 700;
+    ut_LSIZE text_characters = 16384;
+    ut_DWORD pieces = 1;
+    bool unicode = false;
+    std::vector<enum error_type> corruptions;
+    ut_DWORD seed = 1;
+};
+
+/* A chain of sectors, in stream order. */
+typedef std::vector<ut_DWORD> sector_chain;
+
+class CorpusWriter : public PD_WDBF_values
+{
+private:
+    struct corpus_options options;
+    std::mt19937_64 random;
+
+    nt_DWORD output = -1;
+    ut_LSIZE sector_size, entries_per_sector;
+    ut_LSIZE sector_count, FAT_count, DIFAT_count;
+    std::vector<ut_DWORD> FAT;
+
+    sector_chain directory, MiniFAT, mini_stream, table_stream, WordDocument;
+    ut_LSIZE mini_sector_count, WordDocument_size, table_stream_size, CLX_size;
+
+    static ut_LSIZE sectors_for(ut_LSIZE bytes, ut_LSIZE unit)
+    { return (bytes + unit - 1) / unit; }
+
+    ut_LSIZE get_sector_offset(ut_DWORD sector)
+    { return ((ut_LSIZE) sector + 1) * sector_size; }
+
+    void write_at(ut_LSIZE offset, const ut_BYTE *data, ut_LSIZE length)
+    {
+        while(length > 0)
+        {
+            ssize_t written = pwrite(output, data, length, offset);
+            if(written < 0 && errno == EINTR) continue;
+
+            dot_doc_assert(written > 0, "\n%sCorpus Error:%s\n\tWrite failed at offset %llX (%s).\n",
+                red, white,
+                offset, strerror(errno))
+
+            data += written;
+            offset += written;
+            length -= written;
+        }
+    }
+
+    /* Write `data` at `offset` of the stream stored in `chain`; runs of adjacent sectors are written in one go. */
+    void write_stream(const sector_chain& chain, ut_LSIZE offset, const ut_BYTE *data, ut_LSIZE length)
+    {
+        while(length > 0)
+        {
+            ut_LSIZE index = offset / sector_size, within = offset % sector_size;
+            ut_LSIZE run = 1;
+
+            while(index + run < chain.size() && chain[index + run] == chain[index] + run && run * sector_size - within < length)
+                run++;
+
+            ut_LSIZE part = std::min(length, run * sector_size - within);
+            write_at(get_sector_offset(chain[index]) + within, data, part);
+
+            data += part;
+            offset += part;
+            length -= part;
+        }
+    }
+
+    /* FAT and DIFAT sectors needed for `sector_count` sectors, taking into account they are sectors themselves. */
+    void size_FAT(ut_LSIZE data_sectors)
+    {
+        FAT_count = std::max<ut_LSIZE> (options.FAT_sectors, 1);
+        DIFAT_count = 0;
+
+        for(;;)
+        {
+            ut_LSIZE needed_FAT = std::max<ut_LSIZE> (sectors_for(data_sectors + FAT_count + DIFAT_count, entries_per_sector), options.FAT_sectors);
+            ut_LSIZE needed_DIFAT = needed_FAT > WDBF_header_DIFAT_entries ? sectors_for(needed_FAT - WDBF_header_DIFAT_entries, entries_per_sector - 1) : 0;
+
+            if(needed_FAT == FAT_count && needed_DIFAT == DIFAT_count)
+                break;
+
+            FAT_count = needed_FAT;
+            DIFAT_count = needed_DIFAT;
+        }
+    }
+
+    /* Work out every size, then lay the streams out over the data sectors (out of order, when fragmenting). */
+    void plan()
+    {
+        sector_size = options.major_version == 3 ? 512 : 4096;
+        entries_per_sector = sector_size / sizeof(ut_DWORD);
+
+        ut_LSIZE text_size = options.text_characters * (options.unicode ? 2 : 1);
+        CLX_size = 5 + (options.pieces + 1) * sizeof(ut_DWORD) + options.pieces * 8;
+        table_stream_size = std::max<ut_LSIZE> (corpus_mini_cutoff, CLX_size);
+        mini_sector_count = (ut_LSIZE) options.mini_streams * sectors_for(options.mini_size, corpus_mini_sector_size);
+
+        ut_LSIZE directory_sectors = sectors_for(options.entries, sector_size / CFB_dir_entry_size);
+        ut_LSIZE MiniFAT_sectors = sectors_for(mini_sector_count, entries_per_sector);
+        ut_LSIZE mini_stream_sectors = sectors_for(mini_sector_count * corpus_mini_sector_size, sector_size);
+        ut_LSIZE table_sectors = sectors_for(table_stream_size, sector_size);
+        ut_LSIZE WordDocument_sectors = sectors_for(std::max<ut_LSIZE> (corpus_mini_cutoff, corpus_text_offset + text_size), sector_size);
+        ut_LSIZE other_sectors = directory_sectors + MiniFAT_sectors + mini_stream_sectors + table_sectors;
+
+        /* Grow `WordDocument` to fill the requested size; the FAT grows with it. */
+        size_FAT(other_sectors + WordDocument_sectors);
+        if(options.size > 0)
+        {
+            ut_LSIZE target_sectors = options.size / sector_size - 1;
+
+            for(ut_DWORD round = 0; round < 8; round++)
+            {
+                if(target_sectors > other_sectors + FAT_count + DIFAT_count + WordDocument_sectors)
+                    WordDocument_sectors = target_sectors - other_sectors - FAT_count - DIFAT_count;
+
+                size_FAT(other_sectors + WordDocument_sectors);
+            }
+        }
+
+        WordDocument_size = WordDocument_sectors * sector_size;
+        sector_count = FAT_count + DIFAT_count + other_sectors + WordDocument_sectors;
+
+        dot_doc_assert(options.major_version == 4 || WordDocument_size <= 0xFFFFFFFF,
+            "\n%sCorpus Error:%s\n\tMajor Version 3 stream sizes are 32-bit; %llu bytes is too big. Use `--version 4`.\n",
+            red, white,
+            WordDocument_size)
+
+        dot_doc_assert(sector_count <= CFB_MAXREGSECT, "\n%sCorpus Error:%s\n\tToo many sectors (%llu).\n",
+            red, white,
+            sector_count)
+
+        FAT.assign(FAT_count * entries_per_sector, CFB_FREESECT);
+        for(ut_DWORD sector = 0; sector < FAT_count; sector++) FAT[sector] = CFB_FATSECT;
+        for(ut_DWORD sector = 0; sector < DIFAT_count; sector++) FAT[FAT_count + sector] = CFB_DIFSECT;
+
+        /* Data sectors, in the order they are handed out; `fragment_percent` of them swap places with another one. */
+        ut_LSIZE first_data_sector = FAT_count + DIFAT_count;
+        std::vector<ut_DWORD> order(sector_count - first_data_sector);
+
+        for(ut_LSIZE slot = 0; slot < order.size(); slot++) order[slot] = first_data_sector + slot;
+        if(options.fragment_percent > 0)
+        {
+            for(ut_LSIZE slot = 0; slot < order.size(); slot++)
+                if(random() % 100 < options.fragment_percent) std::swap(order[slot], order[random() % order.size()]);
+        }
+
+        ut_LSIZE next_slot = 0;
+        auto allocate = [&](sector_chain& chain, ut_LSIZE sectors) {
+            chain.assign(order.begin() + next_slot, order.begin() + next_slot + sectors);
+            next_slot += sectors;
+
+            for(ut_LSIZE i = 0; i < chain.size(); i++)
+                FAT[chain[i]] = i + 1 < chain.size() ? chain[i + 1] : CFB_ENDOFCHAIN;
+        };
+
+        allocate(directory, directory_sectors);
+        allocate(MiniFAT, MiniFAT_sectors);
+        allocate(mini_stream, mini_stream_sectors);
+        allocate(table_stream, table_sectors);
+        allocate(WordDocument, WordDocument_sectors);
+    }
+
+    void write_header()
+    {
+        std::vector<ut_BYTE> header(sector_size, 0);
+        ut_BYTE *at = header.data();
+
+        memcpy(at + (ut_LSIZE) data_locations::WDBF_HS, dot_doc_header_sig, sizeof(dot_doc_header_sig));
+        memcpy(at + (ut_LSIZE) data_locations::WDBF_MV, dot_doc_req_minor_v, 2);
+        memcpy(at + (ut_LSIZE) data_locations::WDBF_MJV, options.major_version == 3 ? dot_doc_majr_vers_3 : dot_doc_majr_vers_4, 2);
+        memcpy(at + (ut_LSIZE) data_locations::WDBF_BO, dot_doc_byte_order, 2);
+        memcpy(at + (ut_LSIZE) data_locations::WDBF_SS, options.major_version == 3 ? dot_doc_MV3_SS : dot_doc_MV4_SS, 2);
+        memcpy(at + (ut_LSIZE) data_locations::WDBF_MSS, dot_doc_MSS, 2);
+
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_NOD, options.major_version == 3 ? 0 : directory.size());
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_NOFS, FAT_count);
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_FDSL, directory[0]);
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_MSCS, corpus_mini_cutoff);
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_FMFSL, MiniFAT.empty() ? CFB_ENDOFCHAIN : MiniFAT[0]);
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_NOMFS, MiniFAT.size());
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_FDFSL, DIFAT_count > 0 ? FAT_count : CFB_ENDOFCHAIN);
+        store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_NODFS, DIFAT_count);
+
+        /* FAT sectors are sectors 0 to `FAT_count - 1`. */
+        for(ut_DWORD i = 0; i < WDBF_header_DIFAT_entries; i++)
+            store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_FSL + i * sizeof(ut_DWORD), i < FAT_count ? i : CFB_FREESECT);
+
+        for(enum error_type corruption : options.corruptions)
+        {
+            switch(corruption)
+            {
+                case invalid_doc_file_header_sig: at[(ut_LSIZE) data_locations::WDBF_HS + 3] ^= 0x5A; break;
+                case invalid_doc_file_padding: {
+                    at[(ut_LSIZE) data_locations::WDBF_PD1 + 5] = 0x5A;
+                    at[(ut_LSIZE) data_locations::WDBF_PD2 + 1] = 0xA5;
+                    break;
+                }
+                case invalid_CFB_minor_version: store_le<ut_WORD> (at + (ut_LSIZE) data_locations::WDBF_MV, 0x553E); break;
+                case invalid_CFB_major_version: store_le<ut_WORD> (at + (ut_LSIZE) data_locations::WDBF_MJV, 0x0005); break;
+                case invalid_CFB_little_endian_indication: store_le<ut_WORD> (at + (ut_LSIZE) data_locations::WDBF_BO, 0xFEFF); break;
+                case invalid_CFB_sector_size_indication: {
+                    store_le<ut_WORD> (at + (ut_LSIZE) data_locations::WDBF_SS, options.major_version == 3 ? 0x000C : 0x0009);
+                    break;
+                }
+                case invalid_CFB_mini_stream_sector_size: store_le<ut_WORD> (at + (ut_LSIZE) data_locations::WDBF_MSS, 0x0007); break;
+                case invalid_CFB_dir_sector_count: store_le<ut_DWORD> (at + (ut_LSIZE) data_locations::WDBF_NOD, directory.size()); break;
+                default: break;
+            }
+        }
+
+        write_at(0, header.data(), header.size());
+    }
+
+    void write_FAT()
+    {
+        /* The FAT sectors are contiguous; one write, in pieces so a FAT of a huge file does not need a second copy. */
+        std::vector<ut_BYTE> buffer(std::min<ut_LSIZE> (FAT.size(), 1 << 20) * sizeof(ut_DWORD));
+
+        for(ut_LSIZE entry = 0; entry < FAT.size();)
+        {
+            ut_LSIZE count = std::min<ut_LSIZE> (FAT.size() - entry, buffer.size() / sizeof(ut_DWORD));
+            for(ut_LSIZE i = 0; i < count; i++) store_le<ut_DWORD> (buffer.data() + i * sizeof(ut_DWORD), FAT[entry + i]);
+
+            write_at(get_sector_offset(0) + entry * sizeof(ut_DWORD), buffer.data(), count * sizeof(ut_DWORD));
+            entry += count;
+        }
+
+        /* DIFAT sectors; the FAT sector locations past the 109 in the header, the last entry links to the next DIFAT sector. */
+        std::vector<ut_BYTE> DIFAT_sector(sector_size);
+        ut_LSIZE next_FAT = WDBF_header_DIFAT_entries;
+
+        for(ut_DWORD sector = 0; sector < DIFAT_count; sector++)
+        {
+            for(ut_LSIZE i = 0; i < entries_per_sector - 1; i++, next_FAT++)
+                store_le<ut_DWORD> (DIFAT_sector.data() + i * sizeof(ut_DWORD), next_FAT < FAT_count ? next_FAT : CFB_FREESECT);
+
+            store_le<ut_DWORD> (DIFAT_sector.data() + (entries_per_sector - 1) * sizeof(ut_DWORD),
+                sector + 1 < DIFAT_count ? FAT_count + sector + 1 : CFB_ENDOFCHAIN);
+            write_at(get_sector_offset(FAT_count + sector), DIFAT_sector.data(), sector_size);
+        }
+    }
+
+    /* Entries in CFB order (shorter names first, then case-insensitively) as a balanced tree; nodes on an incomplete last
+     * level are red, every other node black, which keeps it a valid red-black tree. Returns the root of `[first, last)`.
+     * */
+    ut_DWORD build_tree(std::vector<ut_DWORD>& sorted, nt_DWORD first, nt_DWORD last, ut_DWORD depth, ut_DWORD red_depth,
+        std::vector<ut_BYTE>& entries)
+    {
+        if(first >= last) return CFB_NOSTREAM;
+
+        nt_DWORD middle = first + (last - first) / 2;
+        ut_BYTE *entry = entries.data() + (ut_LSIZE) sorted[middle] * CFB_dir_entry_size;
+
+        store_le<ut_DWORD> (entry + CFB_dir_left_sibling, build_tree(sorted, first, middle, depth + 1, red_depth, entries));
+        store_le<ut_DWORD> (entry + CFB_dir_right_sibling, build_tree(sorted, middle + 1, last, depth + 1, red_depth, entries));
+        entry[CFB_dir_color] = depth == red_depth ? 0 : 1;
+
+        return sorted[middle];
+    }
+
+    void write_directory()
+    {
+        std::vector<ut_BYTE> entries(directory.size() * sector_size, 0);
+        std::vector<std::string> names(options.entries);
+
+        for(ut_LSIZE entry = 0; entry < directory.size() * sector_size / CFB_dir_entry_size; entry++)
+        {
+            ut_BYTE *at = entries.data() + entry * CFB_dir_entry_size;
+            store_le<ut_DWORD> (at + CFB_dir_left_sibling, CFB_NOSTREAM);
+            store_le<ut_DWORD> (at + CFB_dir_right_sibling, CFB_NOSTREAM);
+            store_le<ut_DWORD> (at + CFB_dir_child, CFB_NOSTREAM);
+        }
+
+        auto set_entry = [&](ut_DWORD entry, std::string name, dir_entry_type type, ut_DWORD start_sector, ut_LSIZE size) {
+            ut_BYTE *at = entries.data() + (ut_LSIZE) entry * CFB_dir_entry_size;
+
+            for(ut_LSIZE i = 0; i < name.size(); i++) store_le<ut_WORD> (at + i * 2, (ut_BYTE) name[i]);
+            store_le<ut_WORD> (at + CFB_dir_name_length, (name.size() + 1) * 2);
+            at[CFB_dir_type] = (ut_BYTE) type;
+            at[CFB_dir_color] = 1;
+            store_le<ut_DWORD> (at + CFB_dir_start_sector, start_sector);
+            store_le<ut_LSIZE> (at + CFB_dir_stream_size, size);
+
+            names[entry] = name;
+        };
+
+        set_entry(0, "Root Entry", dir_entry_type::root, mini_stream.empty() ? CFB_ENDOFCHAIN : mini_stream[0],
+            mini_sector_count * corpus_mini_sector_size);
+        set_entry(1, "WordDocument", dir_entry_type::stream, WordDocument[0], WordDocument_size);
+        set_entry(2, "1Table", dir_entry_type::stream, table_stream[0], table_stream_size);
+
+        ut_DWORD mini_sectors_per_stream = sectors_for(options.mini_size, corpus_mini_sector_size);
+        nt_BYTE name[32];
+
+        for(ut_DWORD entry = 3; entry < options.entries; entry++)
+        {
+            ut_DWORD mini_stream_index = entry - 3;
+            bool in_mini_stream = mini_stream_index < options.mini_streams;
+
+            snprintf(name, sizeof(name), in_mini_stream ? "MiniStream%06u" : "Stream%06u", mini_stream_index);
+            set_entry(entry, name, dir_entry_type::stream, in_mini_stream ? mini_stream_index * mini_sectors_per_stream : CFB_ENDOFCHAIN,
+                in_mini_stream ? options.mini_size : 0);
+        }
+
+        /* Every stream is a child of the Root Entry. */
+        std::vector<ut_DWORD> sorted;
+        for(ut_DWORD entry = 1; entry < options.entries; entry++) sorted.push_back(entry);
+
+        std::sort(sorted.begin(), sorted.end(), [&names](ut_DWORD a, ut_DWORD b) {
+            if(names[a].size() != names[b].size()) return names[a].size() < names[b].size();
+            return strcasecmp(names[a].c_str(), names[b].c_str()) < 0;
+        });
+
+        ut_DWORD depth = std::bit_width(sorted.size()) - 1;
+        bool complete = sorted.size() + 1 == (1ULL << (depth + 1));
+
+        store_le<ut_DWORD> (entries.data() + CFB_dir_child,
+            build_tree(sorted, 0, sorted.size(), 0, complete ? CFB_NOSTREAM : depth, entries));
+
+        write_stream(directory, 0, entries.data(), entries.size());
+    }
+
+    /* The MiniFAT (one contiguous chain per mini stream), and the data of every mini stream. */
+    void write_mini_streams()
+    {
+        if(mini_sector_count == 0)
+            return;
+
+        ut_DWORD mini_sectors_per_stream = sectors_for(options.mini_size, corpus_mini_sector_size);
+        std::vector<ut_BYTE> MiniFAT_data(MiniFAT.size() * sector_size);
+
+        for(ut_LSIZE mini_sector = 0; mini_sector < MiniFAT.size() * entries_per_sector; mini_sector++)
+        {
+            ut_DWORD next = mini_sector >= mini_sector_count ? CFB_FREESECT
+                : (mini_sector + 1) % mini_sectors_per_stream == 0 ? CFB_ENDOFCHAIN : mini_sector + 1;
+            store_le<ut_DWORD> (MiniFAT_data.data() + mini_sector * sizeof(ut_DWORD), next);
+        }
+
+        write_stream(MiniFAT, 0, MiniFAT_data.data(), MiniFAT_data.size());
+
+        std::vector<ut_BYTE> mini_data(mini_sector_count * corpus_mini_sector_size, 0);
+        for(ut_DWORD stream = 0; stream < options.mini_streams; stream++)
+            for(ut_DWORD i = 0; i < options.mini_size; i++)
+                mini_data[(ut_LSIZE) stream * mini_sectors_per_stream * corpus_mini_sector_size + i] = (ut_BYTE) (stream * 31 + i);
+
+        write_stream(mini_stream, 0, mini_data.data(), mini_data.size());
+    }
+
+    /* The CLX: one Pcdt, the text split evenly over `pieces` pieces stored one after another. */
+    void write_table_stream()
+    {
+        std::vector<ut_BYTE> CLX(CLX_size, 0);
+        ut_LSIZE PlcPcd_size = CLX_size - 5;
+        ut_LSIZE character_size = options.unicode ? 2 : 1;
+
+        CLX[0] = WDBF_clxt_Pcdt;
+        store_le<ut_DWORD> (CLX.data() + 1, PlcPcd_size);
+
+        for(ut_DWORD piece = 0; piece <= options.pieces; piece++)
+        {
+            ut_LSIZE CP = options.text_characters * piece / options.pieces;
+            store_le<ut_DWORD> (CLX.data() + 5 + piece * sizeof(ut_DWORD), CP);
+
+            if(piece == options.pieces)
+                continue;
+
+            ut_LSIZE offset = corpus_text_offset + CP * character_size;
+            ut_DWORD fc = options.unicode ? offset : (offset * 2) | WDBF_fc_compressed;
+            store_le<ut_DWORD> (CLX.data() + 5 + (options.pieces + 1) * sizeof(ut_DWORD) + piece * WDBF_Pcd_size + 2, fc);
+        }
+
+        write_stream(table_stream, 0, CLX.data(), CLX.size());
+    }
+
+    /* Words, sentences and paragraphs; with a few characters outside of ASCII (CP1252 quotes and accents, or for UTF-16 also
+     * Greek, CJK and a character outside of the BMP).
+     * */
+    ut_LSIZE put_text(ut_BYTE *out, ut_LSIZE characters)
+    {
+        static const nt_BYTE *words[] = {"the", "decoder", "sector", "stream", "of", "a", "chain", "document", "piece", "table",
+            "and", "header", "is", "in", "file", "binary", "word", "text"};
+        static const ut_WORD CP1252_extra[] = {0x93, 0x94, 0x96, 0xE9, 0xFC};
+        static const ut_WORD UTF16_extra[] = {0x201C, 0x201D, 0x2013, 0x00E9, 0x03B1, 0x6587, 0xD83D};
+
+        ut_BYTE *start = out;
+        ut_LSIZE written = 0;
+
+        auto put = [&](ut_WORD unit) {
+            if(options.unicode) { store_le<ut_WORD> (out, unit); out += 2; }
+            else *out++ = unit;
+            written++;
+        };
+
+        while(written < characters)
+        {
+            ut_LSIZE roll = random() % 100;
+
+            if(roll < 4) put(0x0D);
+            else if(roll < 6)
+            {
+                if(!options.unicode) put(CP1252_extra[random() % 5]);
+                else
+                {
+                    ut_WORD unit = UTF16_extra[random() % 7];
+                    put(unit);
+
+                    /* Low surrogate of U+1F600; a pair cut at the end of the text is left unpaired, like a damaged document. */
+                    if(unit == 0xD83D && written < characters) put(0xDE00);
+                }
+            }
+            else
+            {
+                for(const nt_BYTE *c = words[random() % (sizeof(words) / sizeof(words[0]))]; *c && written < characters; c++) put(*c);
+                if(written < characters) put(' ');
+            }
+        }
+
+        return out - start;
+    }
+
+    void write_WordDocument()
+    {
+        std::vector<ut_BYTE> FIB(corpus_FIB_size, 0);
+        ut_BYTE *at = FIB.data();
+        ut_LSIZE text_size = options.text_characters * (options.unicode ? 2 : 1);
+
+        store_le<ut_WORD> (at + 0x00, WDBF_FIB_ident);
+        store_le<ut_WORD> (at + 0x02, 0x00C1);                      // nFib; Word 97
+        store_le<ut_WORD> (at + 0x06, 0x0409);                      // lid; en-US
+        store_le<ut_WORD> (at + 0x0A, WDBF_FIB_fWhichTblStm | WDBF_FIB_fExtChar);
+        store_le<ut_WORD> (at + 0x0C, 0x00BF);                      // nFibBack
+
+        ut_LSIZE position = WDBF_FIB_base_size;
+        store_le<ut_WORD> (at + position, 14);                      // csw
+        position += sizeof(ut_WORD) + 14 * sizeof(ut_WORD);
+
+        store_le<ut_WORD> (at + position, 22);                      // cslw
+        store_le<ut_DWORD> (at + position + sizeof(ut_WORD) + (ut_LSIZE) fib_lw::cbMac * sizeof(ut_DWORD), corpus_text_offset + text_size);
+        store_le<ut_DWORD> (at + position + sizeof(ut_WORD) + (ut_LSIZE) fib_lw::ccpText * sizeof(ut_DWORD), options.text_characters);
+        position += sizeof(ut_WORD) + 22 * sizeof(ut_DWORD);
+
+        store_le<ut_WORD> (at + position, (ut_WORD) fib_fc_lcb::FibRgFcLcb97_count);
+        store_le<ut_DWORD> (at + position + sizeof(ut_WORD) + (ut_LSIZE) fib_fc_lcb::Clx * 8, 0);
+        store_le<ut_DWORD> (at + position + sizeof(ut_WORD) + (ut_LSIZE) fib_fc_lcb::Clx * 8 + 4, CLX_size);
+
+        write_stream(WordDocument, 0, FIB.data(), FIB.size());
+
+        /* The text, in chunks; only these sectors (and the structures) take up space in the file. */
+        const ut_LSIZE chunk_characters = 1 << 20;
+        std::vector<ut_BYTE> chunk(chunk_characters * 2);
+
+        for(ut_LSIZE character = 0; character < options.text_characters; character += chunk_characters)
+        {
+            ut_LSIZE chunk_size = put_text(chunk.data(), std::min(chunk_characters, options.text_characters - character));
+            write_stream(WordDocument, corpus_text_offset + character * (options.unicode ? 2 : 1), chunk.data(), chunk_size);
+        }
+    }
+
+public:
+    CorpusWriter(const struct corpus_options& corpus_options)
+        : options(corpus_options), random(corpus_options.seed)
+    {
+        dot_doc_assert(options.major_version == 3 || options.major_version == 4,
+            "\n%sArgument Error:%s\n\t`--version` expects 3 or 4.\n",
+            red, white)
+
+        dot_doc_assert(options.entries >= 3 && options.mini_streams <= options.entries - 3,
+            "\n%sArgument Error:%s\n\tThere must be at least 3 directory entries, and at most `entries - 3` mini streams.\n",
+            red, white)
+
+        dot_doc_assert(options.mini_size > 0 && options.mini_size < corpus_mini_cutoff,
+            "\n%sArgument Error:%s\n\t`--mini-size` expects 1 - 4095 bytes.\n",
+            red, white)
+
+        dot_doc_assert(options.pieces > 0 && options.pieces <= std::max<ut_LSIZE> (options.text_characters, 1) && options.fragment_percent <= 100,
+            "\n%sArgument Error:%s\n\tExpected 1 to `--text` pieces, and a `--fragment` percentage of 0 - 100.\n",
+            red, white)
+
+        for(enum error_type corruption : options.corruptions)
+            dot_doc_assert(corruption != invalid_CFB_dir_sector_count || options.major_version == 3,
+                "\n%sArgument Error:%s\n\tThe directory sector count is only a flaw in Major Version 3 files.\n",
+                red, white)
+    }
+
+    void write(const nt_BYTE *path)
+    {
+        plan();
+
+        output = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dot_doc_assert(output >= 0, "\n%sCorpus Error:%s\n\tCould not create `%s` (%s).\n",
+            red, white,
+            path, strerror(errno))
+
+        dot_doc_assert(ftruncate(output, get_sector_offset(sector_count)) == 0,
+            "\n%sCorpus Error:%s\n\tCould not size `%s` to %llu bytes (%s).\n",
+            red, white,
+            path, get_sector_offset(sector_count), strerror(errno))
+
+        write_header();
+        write_FAT();
+        write_directory();
+        write_mini_streams();
+        write_table_stream();
+        write_WordDocument();
+
+        close(output);
+        output = -1;
+
+        printf("%s: v%d, %llu bytes, %llu sectors (%llu FAT, %llu DIFAT), %u entries, %u mini streams, %llu characters in %u piece(s)%s%s\n",
+            path, options.major_version, get_sector_offset(sector_count), sector_count, FAT_count, DIFAT_count, options.entries,
+            options.mini_streams, options.text_characters, options.pieces, options.unicode ? ", UTF-16" : "",
+            options.corruptions.empty() ? "" : ", corrupted");
+    }
+};
+
+ut_LSIZE parse_size(const nt_BYTE *size)
+{
+    nt_BYTE *unit;
+    ut_LSIZE value = strtoull(size, &unit, 10);
+
+    switch(toupper(*unit))
+    {
+        case 'K': return value << 10;
+        case 'M': return value << 20;
+        case 'G': return value << 30;
+        default: break;
+    }
+
+    return value;
+}
+
+const struct { const nt_BYTE *name; enum error_type corruption; } corruption_names[] = {
+    {"signature", invalid_doc_file_header_sig}, {"padding", invalid_doc_file_padding}, {"minor", invalid_CFB_minor_version},
+    {"major", invalid_CFB_major_version}, {"byte-order", invalid_CFB_little_endian_indication},
+    {"sector-size", invalid_CFB_sector_size_indication}, {"mini-sector-size", invalid_CFB_mini_stream_sector_size},
+    {"dir-sectors", invalid_CFB_dir_sector_count}
+};
+
+void parse_corruptions(const nt_BYTE *list, std::vector<enum error_type>& corruptions)
+{
+    std::string names = list;
+
+    for(ut_LSIZE start = 0; start <= names.size();)
+    {
+        ut_LSIZE end = names.find(',', start);
+        if(end == std::string::npos) end = names.size();
+
+        std::string name = names.substr(start, end - start);
+        bool known = false;
+
+        for(const auto& corruption : corruption_names)
+        {
+            if(name == corruption.name || name == "all")
+            {
+                corruptions.push_back(corruption.corruption);
+                known = true;
+            }
+        }
+
+        dot_doc_assert(known, "\n%sArgument Error:%s\n\tUnknown corruption `%s`.\n",
+            red, white,
+            name.c_str())
+
+        start = end + 1;
+    }
+}
+
+/* The standard set: both versions, fragmented, many entries, deep DIFAT, UTF-16 text in many pieces, and every header flaw. */
+void write_corpus(const std::string& directory, ut_LSIZE scale)
+{
+    std::filesystem::create_directories(directory);
+
+    auto generate = [&directory](const nt_BYTE *name, struct corpus_options options) {
+        CorpusWriter(options).write((directory + "/" + name).c_str());
+    };
+
+    struct corpus_options options;
+    generate("v3-small.doc", options);
+
+    options.major_version = 4;
+    generate("v4-small.doc", options);
+
+    options = corpus_options{};
+    options.size = 8 << 20;
+    options.fragment_percent = 50;
+    options.text_characters = 1 << 20;
+    generate("v3-fragmented.doc", options);
+
+    options.major_version = 4;
+    options.size = 64 << 20;
+    generate("v4-fragmented.doc", options);
+
+    options = corpus_options{};
+    options.entries = 4096;
+    options.mini_streams = 2048;
+    generate("v3-many-entries.doc", options);
+
+    options = corpus_options{};
+    options.major_version = 4;
+    options.FAT_sectors = 2000;
+    generate("v4-deep-DIFAT.doc", options);
+
+    options = corpus_options{};
+    options.unicode = true;
+    options.pieces = 64;
+    options.text_characters = 1 << 18;
+    generate("v3-unicode-pieces.doc", options);
+
+    for(const auto& corruption : corruption_names)
+    {
+        options = corpus_options{};
+        options.corruptions.push_back(corruption.corruption);
+        generate(("v3-corrupt-" + std::string(corruption.name) + ".doc").c_str(), options);
+    }
+
+    options = corpus_options{};
+    parse_corruptions("all", options.corruptions);
+    generate("v3-corrupt-all.doc", options);
+
+    if(scale > 0)
+    {
+        options = corpus_options{};
+        options.major_version = 4;
+        options.size = scale;
+        options.fragment_percent = 5;
+        options.text_characters = 16 << 20;
+        generate("v4-large.doc", options);
+    }
+}
+
+int main(int args, char *argv[])
+{
+    struct corpus_options options;
+    const nt_BYTE *output_path = nullptr, *corpus_directory = nullptr;
+    ut_LSIZE scale = 0;
+
+    try
+    {
+        for(int arg = 1; arg < args; arg++)
+        {
+            bool has_value = arg + 1 < args;
+
+            if(strcmp(argv[arg], "--version") == 0 && has_value) options.major_version = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--size") == 0 && has_value) options.size = parse_size(argv[++arg]);
+            else if(strcmp(argv[arg], "--FAT-sectors") == 0 && has_value) options.FAT_sectors = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--fragment") == 0 && has_value) options.fragment_percent = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--entries") == 0 && has_value) options.entries = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--mini-streams") == 0 && has_value) options.mini_streams = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--mini-size") == 0 && has_value) options.mini_size = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--text") == 0 && has_value) options.text_characters = parse_size(argv[++arg]);
+            else if(strcmp(argv[arg], "--pieces") == 0 && has_value) options.pieces = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--unicode") == 0) options.unicode = true;
+            else if(strcmp(argv[arg], "--corrupt") == 0 && has_value) parse_corruptions(argv[++arg], options.corruptions);
+            else if(strcmp(argv[arg], "--seed") == 0 && has_value) options.seed = atoi(argv[++arg]);
+            else if(strcmp(argv[arg], "--corpus") == 0 && has_value) corpus_directory = argv[++arg];
+            else if(strcmp(argv[arg], "--scale") == 0 && has_value) scale = parse_size(argv[++arg]);
+            else output_path = argv[arg];
+        }
+
+        if(corpus_directory)
+        {
+            write_corpus(corpus_directory, scale);
+            return 0;
+        }
+
+        dot_doc_assert(output_path, "\n%sArgument Error:%s\n\tExpected an output file, or `--corpus <directory>`.\n",
+            red, white)
+
+        CorpusWriter(options).write(output_path);
+    }
+    catch(dot_doc_fatal_error& fatal_error)
+    {
+        fprintf(stderr, "%s", fatal_error.what());
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/* Benchmark harness for the decoder, stage by stage; what `make bench` runs.
+ * For every file (directories are walked for `.doc` files) each stage is timed on its own:
+ *      decode    - `DotDoc_File` + `decode`, end to end (open, map, header, FAT, directory, MiniFAT, FIB); bytes are the file size.
+ *      session   - The same through one `DotDoc_Session`, opened, decoded and closed over and over.
+ *      header    - `parse_WDBF_heading`; 512 bytes.
+ *      FAT       - `DotDoc_FAT::build`; the bytes of the next-sector table.
+ *      directory - `DotDoc_Directory::build`; 128 bytes per directory entry.
+ *      text      - `extract_text`; the bytes of UTF-8 produced.
+ * A stage runs in batches sized to take about `batch_ns`; ns/op is the median of `batches` batches, allocations/op
+ * (calls to `operator new`/`new[]`) the average over all of them. A stage the file can not go through (e.g. no text) is skipped.
+ *
+ * Results are printed as a table and, with `--output`, written as JSON lines (one object per file and stage) so runs of
+ * different builds can be compared; `--baseline` compares against such a file and exits with failure when a stage got slower
+ * by more than `--threshold` percent (default 10).
+ * Build:   g++ bench/decode_bench.cpp -std=c++20 -O2 -pthread -o decode_bench.o
+ * Run:     ./decode_bench.o [--output results.jsonl] [--baseline old.jsonl] [--threshold %] [--label name] <file|directory>...
+ * */
+#include <chrono>
+#include <algorithm>
+#include "../common.hpp"
+
+/* Every allocation the decoder makes goes through these. They pair `malloc` with `free`; GCC sees the inlined `free` under
+ * `delete[]` and warns about a mismatch that is not there.
+ * */
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+std::atomic<ut_LSIZE> allocation_count{0};
+
+void *operator new(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if(void *allocation = malloc(size ? size : 1)) return allocation;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if(void *allocation = malloc(size ? size : 1)) return allocation;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *allocation) noexcept
+{ free(allocation); }
+
+void operator delete[](void *allocation) noexcept
+{ free(allocation); }
+
+void operator delete(void *allocation, size_t) noexcept
+{ free(allocation); }
+
+void operator delete[](void *allocation, size_t) noexcept
+{ free(allocation); }
+
+#define batch_ns        20000000.0
+#define batches         5
+
+struct stage_result
+{
+    std::string file;
+    const nt_BYTE *stage;
+    ut_LSIZE iterations;
+    double ns_per_op;
+    ut_LSIZE bytes_per_op;
+    double allocations_per_op;
+};
+
+/* Time `operation`, which processes `bytes_per_op` bytes every call. */
+template<typename F>
+struct stage_result run_stage(const std::string& file, const nt_BYTE *stage, ut_LSIZE bytes_per_op, F operation)
+{
+    /* Grow the batch until it takes long enough to time. */
+    ut_LSIZE iterations = 1;
+    for(;;)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(ut_LSIZE i = 0; i < iterations; i++) operation();
+        double elapsed = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start).count();
+
+        if(elapsed >= batch_ns / 4 || iterations >= (1ULL << 30)) break;
+        iterations *= elapsed > 0 ? std::min(16.0, std::max(2.0, batch_ns / elapsed)) : 16;
+    }
+
+    double batch_results[batches];
+    ut_LSIZE allocations_before = allocation_count.load();
+
+    for(ut_DWORD batch = 0; batch < batches; batch++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(ut_LSIZE i = 0; i < iterations; i++) operation();
+        batch_results[batch] = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    ut_LSIZE allocations = allocation_count.load() - allocations_before;
+    std::sort(batch_results, batch_results + batches);
+
+    return stage_result{file, stage, iterations * batches, batch_results[batches / 2], bytes_per_op,
+        (double) allocations / (iterations * batches)};
+}
+
+void bench_file(const std::string& path, std::vector<struct stage_result>& results)
+{
+    /* The decoded file the other stages work on. */
+    DotDoc_File *WDBF;
+
+    try
+    {
+        results.push_back(run_stage(path, "decode", std::filesystem::file_size(path), [&path]() {
+            DotDoc_File WDBF(ut_BYTE_PTR path.c_str(), true);
+            WDBF.decode();
+        }));
+
+        DotDoc_Session session;
+        results.push_back(run_stage(path, "session", std::filesystem::file_size(path), [&path, &session]() {
+            session.open(path.c_str());
+            session.decode();
+            session.close();
+        }));
+
+        WDBF = new DotDoc_File(ut_BYTE_PTR path.c_str(), true);
+        WDBF->decode();
+    }
+    catch(dot_doc_fatal_error& fatal_error)
+    {
+        fprintf(stderr, "%s: skipped, it does not decode.\n", path.c_str());
+        return;
+    }
+
+    DotDoc_Header *WDBFH = WDBF->get_header();
+
+    results.push_back(run_stage(path, "header", WDBF_header_block_size, [WDBFH]() {
+        WDBFH->parse_WDBF_heading();
+    }));
+
+    results.push_back(run_stage(path, "FAT", (ut_LSIZE) WDBF->get_FAT()->get_table_size() * sizeof(ut_DWORD), [WDBF, WDBFH]() {
+        WDBF->get_FAT()->build(*WDBFH->get_fapi(), *WDBFH->get_WDBF_header());
+    }));
+
+    results.push_back(run_stage(path, "directory", (ut_LSIZE) WDBF->get_directory()->get_entry_count() * CFB_dir_entry_size, [WDBF, WDBFH]() {
+        WDBF->get_directory()->build(*WDBFH->get_fapi(), *WDBFH->get_WDBF_header(), *WDBF->get_FAT());
+    }));
+
+    try
+    {
+        std::string text;
+        WDBF->extract_text(text);
+
+        results.push_back(run_stage(path, "text", text.size(), [WDBF, &text]() {
+            text.clear();
+            WDBF->extract_text(text);
+        }));
+    }
+    catch(dot_doc_fatal_error& fatal_error)
+    {
+        fprintf(stderr, "%s: text skipped, it has no readable text.\n", path.c_str());
+    }
+
+    delete WDBF;
+}
+
+/* Value of `"key":` in one of our own JSON lines; numbers and strings without escapes only. */
+std::string get_field(const std::string& line, const nt_BYTE *key)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    ut_LSIZE at = line.find(pattern);
+    if(at == std::string::npos) return "";
+
+    at += pattern.size();
+    if(line[at] == '"') return line.substr(at + 1, line.find('"', at + 1) - at - 1);
+    return line.substr(at, line.find_first_of(",}", at) - at);
+}
+
+/* Returns the number of stages that got slower than `threshold` percent. */
+ut_DWORD compare_with_baseline(const nt_BYTE *baseline_path, std::vector<struct stage_result>& results, double threshold)
+{
+    FILE *baseline = fopen(baseline_path, "r");
+    dot_doc_assert(baseline, "\n%sArgument Error:%s\n\tCould not open the baseline `%s`.\n",
+        red, white,
+        baseline_path)
+
+    std::map<std::string, double> baseline_ns;
+    nt_BYTE *line = nullptr;
+    size_t line_capacity = 0;
+
+    while(getline(&line, &line_capacity, baseline) != -1)
+    {
+        std::string record = line;
+        std::string ns_per_op = get_field(record, "ns_per_op");
+        if(!ns_per_op.empty()) baseline_ns[get_field(record, "file") + "\t" + get_field(record, "stage")] = atof(ns_per_op.c_str());
+    }
+
+    free(line);
+    fclose(baseline);
+
+    ut_DWORD regressions = 0;
+    printf("\nAgainst `%s` (threshold %.0f%%):\n", baseline_path, threshold);
+
+    for(const struct stage_result& result : results)
+    {
+        auto previous = baseline_ns.find(result.file + "\t" + result.stage);
+        if(previous == baseline_ns.end() || previous->second <= 0) continue;
+
+        double change = (result.ns_per_op / previous->second - 1) * 100;
+        bool regressed = change > threshold;
+        regressions += regressed;
+
+        printf("%s%-10s%s %-32s %+7.1f%%  (%.1f -> %.1f ns/op)\n", regressed ? red : green, result.stage, white,
+            result.file.c_str(), change, previous->second, result.ns_per_op);
+    }
+
+    return regressions;
+}
+
+int main(int args, char *argv[])
+{
+    const nt_BYTE *output_path = nullptr, *baseline_path = nullptr, *label = "default";
+    double threshold = 10;
+    std::vector<std::string> paths;
+
+    for(int arg = 1; arg < args; arg++)
+    {
+        if(strcmp(argv[arg], "--output") == 0 && arg + 1 < args) output_path = argv[++arg];
+        else if(strcmp(argv[arg], "--baseline") == 0 && arg + 1 < args) baseline_path = argv[++arg];
+        else if(strcmp(argv[arg], "--threshold") == 0 && arg + 1 < args) threshold = atof(argv[++arg]);
+        else if(strcmp(argv[arg], "--label") == 0 && arg + 1 < args) label = argv[++arg];
+        else if(std::filesystem::is_directory(argv[arg]))
+        {
+            std::vector<std::string> found;
+            for(const auto& entry : std::filesystem::recursive_directory_iterator(argv[arg]))
+                if(entry.is_regular_file() && entry.path().extension() == ".doc") found.push_back(entry.path().string());
+
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        }
+        else paths.push_back(argv[arg]);
+    }
+
+    dot_doc_assert(!paths.empty(), "\n%sArgument Error:%s\n\tExpected file(s) or directories as input.\n",
+        red, white)
+
+    std::vector<struct stage_result> results;
+    for(const std::string& path : paths)
+        bench_file(path, results);
+
+    printf("%-10s %-32s %12s %12s %12s %12s\n", "stage", "file", "iterations", "ns/op", "MB/s", "allocs/op");
+    for(const struct stage_result& result : results)
+        printf("%-10s %-32s %12llu %12.1f %12.1f %12.2f\n", result.stage, result.file.c_str(), result.iterations,
+            result.ns_per_op, result.bytes_per_op * 1e3 / result.ns_per_op, result.allocations_per_op);
+
+    if(output_path)
+    {
+        FILE *output = fopen(output_path, "w");
+        dot_doc_assert(output, "\n%sArgument Error:%s\n\tCould not create `%s`.\n",
+            red, white,
+            output_path)
+
+        for(const struct stage_result& result : results)
+            fprintf(output, "{\"label\":\"%s\",\"compiler\":\"%s\",\"log_level\":%d,\"file\":\"%s\",\"stage\":\"%s\",\"iterations\":%llu,"
+                "\"ns_per_op\":%.3f,\"bytes_per_op\":%llu,\"bytes_per_s\":%.0f,\"allocs_per_op\":%.3f}\n",
+                label, __VERSION__, DOT_DOC_LOG_LEVEL, result.file.c_str(), result.stage, result.iterations,
+                result.ns_per_op, result.bytes_per_op, result.bytes_per_op * 1e9 / result.ns_per_op, result.allocations_per_op);
+
+        fclose(output);
+        printf("\nResults written to `%s`.\n", output_path);
+    }
+
+    if(baseline_path && compare_with_baseline(baseline_path, results, threshold) > 0)
+        return EXIT_FAILURE;
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/* Benchmark for building the FAT next-sector table (`DotDoc_FAT::build`) of a large Major Version 4 WDBF,
+ * and for following a chain through it.
+ * A sparse Major Version 4 file is written first: FAT sectors, then DIFAT sectors, then one chain running through every data sector.
+ * It has no directory, so only its header is read before the FAT is built.
+ * Build:   g++ bench/fat_build_bench.cpp -std=c++20 -O2 -o fat_build_bench.o
+ * Run:     ./fat_build_bench.o [size in MiB (default 4096)] [path (default /tmp/fat_build_bench.doc)]
+ * */
+#include <chrono>
+#include "../common.hpp"
+
+#define MV4_sector_size     0x1000
+#define MV4_FAT_entries     (MV4_sector_size / sizeof(ut_DWORD))
+
+void write_sector(FILE *file, ut_DWORD sector, ut_DWORD *data)
+{
+    fseek(file, ((ut_LSIZE) sector + 1) * MV4_sector_size, SEEK_SET);
+    fwrite(data, 1, MV4_sector_size, file);
+}
+
+/* Returns the sector the data chain starts at. */
+ut_DWORD write_MV4_file(const nt_BYTE *path, ut_LSIZE size_in_MiB)
+{
+    ut_DWORD sector_count = (size_in_MiB << 20) / MV4_sector_size - 1;
+    ut_DWORD FAT_count = (sector_count + MV4_FAT_entries - 1) / MV4_FAT_entries;
+    ut_DWORD DIFAT_count = FAT_count > WDBF_header_DIFAT_entries ? (FAT_count - WDBF_header_DIFAT_entries + MV4_FAT_entries - 2) / (MV4_FAT_entries - 1) : 0;
+    ut_DWORD data_start = FAT_count + DIFAT_count;
+
+    FILE *file = fopen(path, "wb");
+    dot_doc_assert(file, "\n%sFile Error:%s\n\tCould not create `%s`.\n", red, white, path)
+
+    /* Sparse; only the header, FAT and DIFAT sectors are actually written. */
+    ftruncate(fileno(file), ((ut_LSIZE) sector_count + 1) * MV4_sector_size);
+
+    ut_BYTE header[MV4_sector_size] = {0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+    store_le<ut_WORD> (header + 0x18, 0x3E);
+    store_le<ut_WORD> (header + 0x1A, 0x4);
+    store_le<ut_WORD> (header + 0x1C, 0xFFFE);
+    store_le<ut_WORD> (header + 0x1E, 0xC);
+    store_le<ut_WORD> (header + 0x20, 0x6);
+    store_le<ut_DWORD> (header + 0x2C, FAT_count);
+    store_le<ut_DWORD> (header + 0x30, CFB_ENDOFCHAIN);
+    store_le<ut_DWORD> (header + 0x38, 0x1000);
+    store_le<ut_DWORD> (header + 0x3C, CFB_ENDOFCHAIN);
+    store_le<ut_DWORD> (header + 0x44, DIFAT_count ? FAT_count : CFB_ENDOFCHAIN);
+    store_le<ut_DWORD> (header + 0x48, DIFAT_count);
+    for(ut_DWORD i = 0; i < WDBF_header_DIFAT_entries; i++)
+        store_le<ut_DWORD> (header + 0x4C + i * 4, i < FAT_count ? i : CFB_FREESECT);
+    fseek(file, 0, SEEK_SET);
+    fwrite(header, 1, MV4_sector_size, file);
+
+    ut_DWORD data[MV4_FAT_entries];
+    for(ut_DWORD FAT_sector = 0; FAT_sector < FAT_count; FAT_sector++)
+    {
+        for(ut_DWORD i = 0; i < MV4_FAT_entries; i++)
+        {
+            ut_DWORD sector = FAT_sector * MV4_FAT_entries + i;
+
+            if(sector < FAT_count) data[i] = CFB_FATSECT;
+            else if(sector < data_start) data[i] = CFB_DIFSECT;
+            else if(sector + 1 < sector_count) data[i] = sector + 1;
+            else if(sector + 1 == sector_count) data[i] = CFB_ENDOFCHAIN;
+            else data[i] = CFB_FREESECT;
+        }
+        write_sector(file, FAT_sector, data);
+    }
+
+    ut_DWORD next_FAT = WDBF_header_DIFAT_entries;
+    for(ut_DWORD DIFAT_sector = 0; DIFAT_sector < DIFAT_count; DIFAT_sector++)
+    {
+        for(ut_DWORD i = 0; i < MV4_FAT_entries - 1; i++, next_FAT++)
+            data[i] = next_FAT < FAT_count ? next_FAT : CFB_FREESECT;
+
+        data[MV4_FAT_entries - 1] = DIFAT_sector + 1 < DIFAT_count ? FAT_count + DIFAT_sector + 1 : CFB_ENDOFCHAIN;
+        write_sector(file, FAT_count + DIFAT_sector, data);
+    }
+
+    fclose(file);
+    printf("%s: %llu MiB, %u sectors, %u FAT sectors, %u DIFAT sectors\n", path, size_in_MiB, sector_count, FAT_count, DIFAT_count);
+
+    return data_start;
+}
+
+int main(int args, char *argv[])
+{
+    ut_LSIZE size_in_MiB = args > 1 ? strtoull(argv[1], nullptr, 10) : 4096;
+    const nt_BYTE *path = args > 2 ? argv[2] : "/tmp/fat_build_bench.doc";
+    const ut_DWORD iterations = 20;
+
+    ut_DWORD chain_start = write_MV4_file(path, size_in_MiB);
+
+    /* The file is gigabytes, if sparse; it goes whether the benchmark gets through or not. */
+    try
+    {
+        /* The file has nothing past its FAT and DIFAT; only the header is gathered, not a whole decode. */
+        DotDoc_Header WDBFH(ut_BYTE_PTR path, true);
+        WDBFH.gather_WDBF_heading();
+
+        DotDoc_FAT FAT;
+        auto start = std::chrono::steady_clock::now();
+        for(ut_DWORD i = 0; i < iterations; i++)
+            FAT.build(*WDBFH.get_fapi(), *WDBFH.get_WDBF_header());
+        auto end = std::chrono::steady_clock::now();
+
+        double build_ns = std::chrono::duration<double, std::nano> (end - start).count() / iterations;
+        printf("FAT build: %.3f ms/build, %.1f MB/s of FAT (%u entries)\n",
+            build_ns / 1e6, (FAT.get_table_size() * sizeof(ut_DWORD)) / (build_ns / 1e9) / 1e6, FAT.get_table_size());
+
+        start = std::chrono::steady_clock::now();
+        ut_DWORD chain_length = FAT.chain_length(chain_start);
+        end = std::chrono::steady_clock::now();
+
+        printf("chain walk: %u sectors, %.2f ns/sector\n",
+            chain_length, std::chrono::duration<double, std::nano> (end - start).count() / chain_length);
+    }
+    catch(dot_doc_fatal_error& fatal_error)
+    {
+        fprintf(stderr, "%s", fatal_error.what());
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,31 @@
+/* Microbenchmark for the cost of reading, and checking, the fixed 76-byte WDBF header.
+ * Build:   g++ bench/header_read_bench.cpp -std=c++20 -O2 -o header_read_bench.o
+ * Run:     ./header_read_bench.o ss.doc
+ * */
+#include <chrono>
+#include "../common.hpp"
+
+int main(int args, char *argv[])
+{
+    dot_doc_assert(args > 1, "\n%sArgument Error:%s\n\tExpected file as input.\n",
+        red, white)
+
+    const ut_DWORD iterations = 1000000;
+    DotDoc_Header *WDBFH = new DotDoc_Header(ut_BYTE_PTR argv[1]);
+
+    /* Warm up; also repairs any flaws in our (private) copy so the timed loop measures the clean path. */
+    WDBFH->parse_WDBF_heading();
+
+    auto start = std::chrono::steady_clock::now();
+    for(ut_DWORD i = 0; i < iterations; i++)
+        WDBFH->parse_WDBF_heading();
+    auto end = std::chrono::steady_clock::now();
+
+    printf("header read: %.1f ns/header (%u iterations)\n",
+        std::chrono::duration<double, std::nano> (end - start).count() / iterations,
+        iterations);
+
+    WDBFH->delete_instance(WDBFH);
+
+    return 0;
+}
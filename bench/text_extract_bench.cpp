@@ -0,0 +1,109 @@
+/* Throughput benchmark for text extraction; the transcoding kernels, and `DotDoc_File::extract_text` end to end.
+ * The piece text of every file is gathered, then tiled until it is the requested size ("scaling up" the document), and both
+ * kernels (vectorized and scalar) are run over it. The text is transcoded as found (CP1252 or UTF-16LE) and, to measure
+ * the other kernel on the same text, also widened/narrowed to the other encoding.
+ * Build:   g++ bench/text_extract_bench.cpp -std=c++20 -O2 -o text_extract_bench.o
+ * Run:     ./text_extract_bench.o ss.doc strr.doc [--size MiB (default 64)]
+ * */
+#include <chrono>
+#include "../common.hpp"
+
+typedef ut_LSIZE (*transcoder)(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out);
+
+/* Best of `runs`, in MB/s of input. */
+double time_transcoder(transcoder transcode, const std::vector<ut_BYTE>& in, ut_LSIZE count, std::vector<ut_BYTE>& out, ut_DWORD runs = 5)
+{
+    double best_seconds = 1e30;
+
+    for(ut_DWORD run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        volatile ut_LSIZE written = transcode(in.data(), count, out.data());
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        (void) written;
+        if(elapsed.count() < best_seconds) best_seconds = elapsed.count();
+    }
+
+    return in.size() / best_seconds / 1e6;
+}
+
+int main(int args, char *argv[])
+{
+    ut_LSIZE target_size = 64ULL << 20;
+    std::vector<const nt_BYTE *> paths;
+
+    for(int arg = 1; arg < args; arg++)
+    {
+        if(strcmp(argv[arg], "--size") == 0 && arg + 1 < args) target_size = strtoull(argv[++arg], nullptr, 10) << 20;
+        else paths.push_back(argv[arg]);
+    }
+
+    dot_doc_assert(!paths.empty(), "\n%sArgument Error:%s\n\tExpected file(s) as input.\n",
+        red, white)
+
+    for(const nt_BYTE *path : paths)
+    {
+        DotDoc_File WDBF(ut_BYTE_PTR path, true);
+        WDBF.decode();
+
+        /* End to end; decode already done, so this is piece table + transcoding. */
+        std::string text;
+        const ut_DWORD iterations = 2000;
+
+        auto start = std::chrono::steady_clock::now();
+        for(ut_DWORD i = 0; i < iterations; i++)
+        {
+            text.clear();
+            WDBF.extract_text(text);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        printf("%s: %u characters, extract_text %.0f ns/doc (%.1f MB/s of UTF-8)\n", path, WDBF.get_FIB()->get_rgLw(fib_lw::ccpText),
+            elapsed.count() / iterations, text.size() * 1e3 / (elapsed.count() / iterations));
+
+        /* The characters of the text, as CP1252 (narrowed, when the document is UTF-16LE) and as UTF-16LE. */
+        DotDoc_Stream table_stream;
+        WDBF.open_stream(WDBF.get_FIB()->get_table_stream_name(), table_stream);
+
+        DotDoc_PieceTable piece_table;
+        piece_table.build(table_stream, *WDBF.get_FIB());
+
+        std::vector<ut_BYTE> narrow, wide;
+        DotDoc_Stream *WordDocument = WDBF.get_WordDocument();
+
+        for(ut_DWORD piece = 0; piece < piece_table.get_piece_count(); piece++)
+        {
+            ut_DWORD characters = piece_table.get_piece_CP(piece + 1) - piece_table.get_piece_CP(piece);
+            ut_LSIZE offset = piece_table.get_piece_offset(piece);
+
+            for(ut_DWORD c = 0; c < characters; c++)
+            {
+                ut_WORD unit = piece_table.is_compressed(piece)
+                    ? WordDocument->get<ut_BYTE> (offset + c)
+                    : WordDocument->get<ut_WORD> (offset + c * 2);
+
+                /* CP1252 0x80 - 0x9F widen to their Unicode code points; UTF-16 units above 0xFF narrow to '?'. */
+                if(piece_table.is_compressed(piece) && unit >= 0x80 && unit < 0xA0) unit = CP1252_high_control[unit - 0x80];
+
+                narrow.push_back(piece_table.is_compressed(piece) ? WordDocument->get<ut_BYTE> (offset + c) : unit < 0x100 ? unit : '?');
+                wide.push_back(unit & 0xFF);
+                wide.push_back(unit >> 8);
+            }
+        }
+
+        /* Scale up. */
+        ut_LSIZE narrow_size = narrow.size(), wide_size = wide.size();
+        while(narrow.size() < target_size) narrow.insert(narrow.end(), narrow.begin(), narrow.begin() + narrow_size);
+        while(wide.size() < target_size * 2) wide.insert(wide.end(), wide.begin(), wide.begin() + wide_size);
+
+        std::vector<ut_BYTE> out(std::max(narrow.size() * 3, wide.size() / 2 * 3) + 64);
+
+        printf("\tCP1252   %6.1f MiB: vectorized %8.1f MB/s, scalar %8.1f MB/s\n", narrow.size() / 1048576.0,
+            time_transcoder(transcode_CP1252, narrow, narrow.size(), out), time_transcoder(transcode_CP1252_scalar, narrow, narrow.size(), out));
+        printf("\tUTF-16LE %6.1f MiB: vectorized %8.1f MB/s, scalar %8.1f MB/s\n", wide.size() / 1048576.0,
+            time_transcoder(transcode_UTF16LE, wide, wide.size() / 2, out), time_transcoder(transcode_UTF16LE_scalar, wide, wide.size() / 2, out));
+    }
+
+    return 0;
+}
@@ -3,6 +3,36 @@
 #include <iostream>
 #include <cstring>
 #include <limits>
+#include <exception>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+#include <functional>
+#include <bit>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <csignal>
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#endif
 
 extern "C"
 {
@@ -84,13 +114,25 @@ extern "C"
 #define white				ut_BYTE_CPTR "\e[0;37m"
 #define reset				white
 
+/* Fatal errors get thrown as `dot_doc_fatal_error` rather than exiting right away, so that one bad document does not take
+ * down a batch of them. `main` catches it, prints the message and exits with `EXIT_FAILURE`.
+ * */
+struct dot_doc_fatal_error : public std::exception
+{
+    nt_BYTE     message[512];
+
+    const nt_BYTE *what() const noexcept override
+    { return message; }
+};
+
 /* Custom asserts/printing.
  * `dot_doc_assert_NERR` means assert, but warn rather than error and exit.
  * */
 #define dot_doc_error(msg, ...)			\
 {						\
-	fprintf(stderr, msg, ##__VA_ARGS__);	\
-	exit(EXIT_FAILURE);			\
+	dot_doc_fatal_error fatal_error;	\
+	snprintf(fatal_error.message, sizeof(fatal_error.message), msg, ##__VA_ARGS__);	\
+	throw fatal_error;			\
 }
 #define dot_doc_warning(msg, ...)       \
 {                                       \
@@ -103,6 +145,29 @@ extern "C"
     if(!(cond))                             \
         dot_doc_warning(msg, ##__VA_ARGS__)
 
+/* Log level, fixed at compile time; `-DDOT_DOC_LOG_LEVEL=n` (`make release` builds with 1).
+ *      0 (none)  - Nothing but fatal errors.
+ *      1 (flaws) - Flaws found in the WDBF.
+ *      2 (debug) - Flaws, and every `[DEBUG ➟ ...]` message; the default.
+ * Output above the compiled level sits behind `if constexpr (dot_doc_logs(...))`, so it is not in the binary at all.
+ * The `quiet` flag of a session still silences what is compiled in, at run time.
+ * */
+#ifndef DOT_DOC_LOG_LEVEL
+#define DOT_DOC_LOG_LEVEL   2
+#endif
+
+enum class dot_doc_log_level : ut_BYTE
+{
+    none = 0,
+    flaws = 1,
+    debug = 2
+};
+
+constexpr dot_doc_log_level dot_doc_compiled_log_level = (dot_doc_log_level) DOT_DOC_LOG_LEVEL;
+
+constexpr bool dot_doc_logs(dot_doc_log_level level)
+{ return level <= dot_doc_compiled_log_level; }
+
 /* Checks for ASCII, number, ASCII with exception and number with exception.
  * is_ascii_WE - WE stands for With Exception.
  * is_number_WE - WE stand for With Exception.
@@ -169,14 +234,60 @@ T convert_endian(T value)
 
             break;
         }
+        case 8: {
+            value = (T) ((((ut_LSIZE) convert_endian<ut_DWORD> (value & 0xFFFFFFFF)) << 32) |
+                    convert_endian<ut_DWORD> ((ut_LSIZE) value >> 32));
+            break;
+        }
         default: break;
     }
 
     return value;
 }
 
-#include "error.hpp"
+/* Load a little-endian value of type `T` from `at`.
+ * Compiles down to a single (unaligned) load on little-endian hosts.
+ * */
+template<typename T>
+    requires std::integral<T>
+T load_le(const ut_BYTE *at)
+{
+    T value;
+    memcpy(&value, at, sizeof(value));
+
+    if constexpr(std::endian::native == std::endian::big)
+        value = convert_endian<T> (value);
+
+    return value;
+}
+
+/* Store `value` at `at` in little-endian. */
+template<typename T>
+    requires std::integral<T>
+void store_le(ut_BYTE *at, T value)
+{
+    if constexpr(std::endian::native == std::endian::big)
+        value = convert_endian<T> (value);
+
+    memcpy(at, &value, sizeof(value));
+}
+
+#include "dot_doc_stats.hpp"
+#include "dot_doc_arena.hpp"
 #include "file_api.hpp"
+#include "error.hpp"
 #include "dot_doc_file_beginning.hpp"
+#include "dot_doc_file_structure.hpp"
+#include "dot_doc_beginning/dot_doc_FIB.hpp"
+#include "dot_doc_file_text.hpp"
+#include "dot_doc_file_metadata.hpp"
+#include "dot_doc_file.hpp"
+#include "dot_doc_snapshot.hpp"
+#include "dot_doc_session.hpp"
+#include "dot_doc_thread_pool.hpp"
+#include "dot_doc_async_io.hpp"
+#include "dot_doc_sink.hpp"
+#include "dot_doc_batch.hpp"
+#include "dot_doc_server.hpp"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+#ifndef dot_doc_arena
+#define dot_doc_arena
+
+/* DotDoc_Arena - monotonic (bump) allocator for everything a decode session keeps for as long as it lives: the header,
+ *           the error log, the FAT sector locations, the FAT and MiniFAT tables, the directory arrays and the decode objects
+ *           of `DotDoc_File`. Allocating is a pointer bump; nothing is freed on its own, the whole arena is cleared in one step
+ *           when the session ends.
+ *
+ *           Arenas are handed out by `acquire` and given back by `release`, which clears them and keeps them on a per-thread
+ *           free list (`dot_doc_arena_pool_size` of them, keeping up to `dot_doc_arena_retained` bytes each). A batch worker
+ *           decoding file after file therefore reuses the same chunks and hardly ever calls `malloc`/`free`.
+ *
+ *           What is not in the arena: memory that scales with the size of the file (the file data when it is read into memory,
+ *           the sector cache) and memory that lives for one call (`extract_text`); keeping those would bloat every arena on
+ *           the free list.
+ *
+ * Variables:
+ *      arena_chunk *first - Chunks, in the order they are used; they stay allocated, and are used again, after `clear`.
+ *      arena_chunk *current - The chunk being bumped; its `used` bytes are taken.
+ */
+#define dot_doc_arena_chunk_size    (1ULL << 16)
+#define dot_doc_arena_max_chunk     (1ULL << 22)
+#define dot_doc_arena_alignment     16
+#define dot_doc_arena_retained      (1ULL << 23)
+#define dot_doc_arena_pool_size     4
+
+class DotDoc_Arena
+{
+private:
+    struct alignas(dot_doc_arena_alignment) arena_chunk
+    {
+        arena_chunk *next;
+        ut_LSIZE size;
+        ut_LSIZE used;
+
+        ut_BYTE *data()
+        { return ut_BYTE_PTR (this + 1); }
+    };
+
+    arena_chunk *first = nullptr;
+    arena_chunk *current = nullptr;
+    ut_LSIZE chunk_count = 0;
+
+    arena_chunk *new_chunk(ut_LSIZE size)
+    {
+        arena_chunk *chunk = (arena_chunk *) ::operator new(sizeof(arena_chunk) + size, std::align_val_t(dot_doc_arena_alignment));
+
+        chunk->next = nullptr;
+        chunk->size = size;
+        chunk->used = 0;
+        chunk_count++;
+
+        return chunk;
+    }
+
+    static void delete_chunk(arena_chunk *chunk)
+    { ::operator delete(chunk, std::align_val_t(dot_doc_arena_alignment)); }
+
+    /* Move on to a chunk with room for `size` bytes; the next one if it is big enough, otherwise a new one put in before it.
+     * Chunks double in size (up to `dot_doc_arena_max_chunk`), so a session needs a handful of them at most.
+     * */
+    void advance(ut_LSIZE size)
+    {
+        if(current && current->next && current->next->size >= size)
+        {
+            current = current->next;
+            current->used = 0;
+            return;
+        }
+
+        ut_LSIZE chunk_size = dot_doc_arena_chunk_size << (chunk_count < 6 ? chunk_count : 6);
+        if(chunk_size > dot_doc_arena_max_chunk) chunk_size = dot_doc_arena_max_chunk;
+        if(chunk_size < size) chunk_size = size;
+
+        arena_chunk *chunk = new_chunk(chunk_size);
+
+        if(!current)
+        {
+            chunk->next = first;
+            first = chunk;
+        }
+        else
+        {
+            chunk->next = current->next;
+            current->next = chunk;
+        }
+
+        current = chunk;
+    }
+
+    /* Free every chunk past the first `retained` bytes. */
+    void trim(ut_LSIZE retained)
+    {
+        ut_LSIZE kept = 0;
+        arena_chunk **link = &first;
+
+        while(*link)
+        {
+            if(kept + (*link)->size <= retained)
+            {
+                kept += (*link)->size;
+                link = &(*link)->next;
+                continue;
+            }
+
+            arena_chunk *dropped = *link;
+            *link = dropped->next;
+            delete_chunk(dropped);
+            chunk_count--;
+        }
+    }
+
+    /* Arenas given back on this thread. */
+    struct arena_pool
+    {
+        DotDoc_Arena *arenas[dot_doc_arena_pool_size];
+        ut_DWORD count = 0;
+
+        ~arena_pool()
+        {
+            while(count > 0) delete arenas[--count];
+        }
+    };
+
+    static arena_pool& get_pool()
+    {
+        static thread_local arena_pool pool;
+        return pool;
+    }
+
+public:
+    /* Where `rewind` goes back to. */
+    struct arena_mark
+    {
+        arena_chunk *chunk;
+        ut_LSIZE used;
+    };
+
+    DotDoc_Arena() = default;
+    DotDoc_Arena(const DotDoc_Arena&) = delete;
+
+    /* Room for `count` `T`s, uninitialized. Only for types that need no destructor; objects go through `create`. */
+    template<typename T>
+    T *allocate(ut_LSIZE count)
+    {
+        static_assert(std::is_trivially_destructible_v<T> && alignof(T) <= dot_doc_arena_alignment);
+
+        dot_doc_assert(count <= (~0ULL - dot_doc_arena_alignment) / sizeof(T),
+            "\n%sMemory Allocation Error:%s\n\tAn allocation of %llu elements of %zu bytes is too large.\n",
+            red, white,
+            count, sizeof(T))
+
+        ut_LSIZE size = (count * sizeof(T) + dot_doc_arena_alignment - 1) & ~(ut_LSIZE) (dot_doc_arena_alignment - 1);
+
+        if(!current || current->size - current->used < size)
+            advance(size);
+
+        T *allocation = (T *) (current->data() + current->used);
+        current->used += size;
+
+        return allocation;
+    }
+
+    /* A `T` constructed in the arena; `destroy` it before the arena is cleared. */
+    template<typename T, typename... Arguments>
+    T *create(Arguments&&... arguments)
+    {
+        static_assert(alignof(T) <= dot_doc_arena_alignment);
+
+        ut_LSIZE size = (sizeof(T) + dot_doc_arena_alignment - 1) & ~(ut_LSIZE) (dot_doc_arena_alignment - 1);
+
+        if(!current || current->size - current->used < size)
+            advance(size);
+
+        T *object = new(current->data() + current->used) T(std::forward<Arguments> (arguments)...);
+        current->used += size;
+
+        return object;
+    }
+
+    /* Run the destructor of an object from `create`; its memory goes back with the rest of the arena. */
+    template<typename T>
+    void destroy(T *object)
+    {
+        if(object) object->~T();
+    }
+
+    /* For scratch memory: everything allocated after `get_mark` is given back by `rewind`. */
+    arena_mark get_mark()
+    { return arena_mark{current, current ? current->used : 0}; }
+
+    void rewind(arena_mark mark)
+    {
+        if(!mark.chunk)
+        {
+            clear();
+            return;
+        }
+
+        current = mark.chunk;
+        current->used = mark.used;
+    }
+
+    /* Give back everything at once; the chunks are kept for what gets allocated next. */
+    void clear()
+    {
+        current = first;
+        if(current) current->used = 0;
+    }
+
+    /* Bytes held in chunks, used or not. */
+    ut_LSIZE get_capacity()
+    {
+        ut_LSIZE capacity = 0;
+        for(arena_chunk *chunk = first; chunk; chunk = chunk->next) capacity += chunk->size;
+
+        return capacity;
+    }
+
+    /* A cleared arena; from this thread's free list if there is one on it. */
+    static DotDoc_Arena *acquire()
+    {
+        arena_pool& pool = get_pool();
+        return pool.count > 0 ? pool.arenas[--pool.count] : new DotDoc_Arena;
+    }
+
+    /* Reset `arena` and keep it for the next `acquire` on this thread, trimmed to `dot_doc_arena_retained` bytes. */
+    static void release(DotDoc_Arena *arena)
+    {
+        if(!arena) return;
+
+        arena_pool& pool = get_pool();
+        if(pool.count == dot_doc_arena_pool_size)
+        {
+            delete arena;
+            return;
+        }
+
+        arena->trim(dot_doc_arena_retained);
+        arena->clear();
+        pool.arenas[pool.count++] = arena;
+    }
+
+    ~DotDoc_Arena()
+    {
+        while(first)
+        {
+            arena_chunk *next = first->next;
+            delete_chunk(first);
+            first = next;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,630 @@
+#ifndef dot_doc_async_io
+#define dot_doc_async_io
+
+/* DotDoc_AsyncIO - opens, and reads, the files of a batch ahead of the workers that decode them.
+ *           A batch of small files spends most of its time waiting on `open`, `fstat` and the first reads of every file, one
+ *           at a time per worker. Here up to `depth` files are in flight at once, each opened, sized and (if it is small
+ *           enough) read whole, without any worker waiting on it; a file that is done comes back from `poll`/`reap` as a
+ *           `FBWW_preloaded`, and `FileAPI` takes it over as it is.
+ *
+ *           `get_async_io` picks the implementation:
+ *               DotDoc_UringIO  - io_uring (`openat`, `statx` and `read` submitted in batches, from one thread); Linux 5.6 and up.
+ *               DotDoc_ThreadIO - Threads doing `open`/`fstat`/`pread`; wherever io_uring can not be set up (older kernels,
+ *                                 seccomp filters that block it, other systems).
+ *           Only the thread feeding the batch calls `submit`, `poll` and `reap`.
+ *
+ * Variables:
+ *      ut_DWORD depth - Files in flight at most; `submit` only while not `is_full`.
+ *      ut_LSIZE read_limit - Files up to this size are read whole. Larger ones are only opened, or, with `read_prefix`, read
+ *                            up to `read_limit` (`FBWW_probe_size` for probing).
+ *      ut_DWORD in_flight - Files submitted and not yet handed back.
+ */
+#define dot_doc_io_default_depth    64
+#define dot_doc_io_preload_max      (1ULL << 18)
+#define dot_doc_io_max_threads      16
+#define dot_doc_io_submit_batch     8
+
+/* `-DDOT_DOC_IO_URING=0` builds without io_uring; the threads are then always used. */
+#ifndef DOT_DOC_IO_URING
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define DOT_DOC_IO_URING            1
+#else
+#define DOT_DOC_IO_URING            0
+#endif
+#endif
+
+class DotDoc_AsyncIO
+{
+protected:
+    ut_DWORD depth;
+    ut_LSIZE read_limit;
+    bool read_prefix;
+    ut_DWORD in_flight = 0;
+
+    /* Bytes to read ahead from a file of `size` bytes. */
+    ut_LSIZE get_read_size(ut_LSIZE size)
+    { return size <= read_limit ? size : (read_prefix ? read_limit : 0); }
+
+public:
+    DotDoc_AsyncIO(ut_DWORD queue_depth, ut_LSIZE file_read_limit, bool prefix)
+        : depth(queue_depth > 0 ? queue_depth : 1), read_limit(file_read_limit), read_prefix(prefix)
+    {}
+
+    DotDoc_AsyncIO(const DotDoc_AsyncIO&) = delete;
+
+    bool is_full()
+    { return in_flight >= depth; }
+
+    ut_DWORD get_depth()
+    { return depth; }
+
+    /* Start opening (and reading) `path`. */
+    virtual void submit(std::string path) = 0;
+
+    /* A file that is done, if there is one; never waits. */
+    virtual bool poll(FBWW_preloaded& preloaded) = 0;
+
+    /* Wait for a file to be done; false once none are in flight. */
+    virtual bool reap(FBWW_preloaded& preloaded) = 0;
+
+    virtual const nt_BYTE *get_name() = 0;
+
+    /* io_uring if it can be set up, threads otherwise. */
+    static DotDoc_AsyncIO *get_async_io(ut_DWORD queue_depth, ut_LSIZE file_read_limit, bool prefix);
+
+    /* Close and free what a file read ahead holds; for one that is dropped rather than handed to `FileAPI`. */
+    static void discard(FBWW_preloaded& preloaded)
+    {
+        if(preloaded.fd >= 0) close(preloaded.fd);
+        delete[] preloaded.data;
+
+        preloaded.fd = -1;
+        preloaded.data = nullptr;
+    }
+
+    virtual ~DotDoc_AsyncIO() = default;
+};
+
+/* DotDoc_ThreadIO - `min(depth, dot_doc_io_max_threads)` threads, each taking a path, opening and reading it with plain
+ *           syscalls and queueing the result.
+ * */
+class DotDoc_ThreadIO : public DotDoc_AsyncIO
+{
+private:
+    std::mutex io_lock;
+    std::condition_variable request_cond;
+    std::condition_variable done_cond;
+    std::deque<std::string> requests;
+    std::deque<FBWW_preloaded> done;
+    std::vector<std::thread> io_threads;
+    bool closed = false;
+
+    void load(FBWW_preloaded& preloaded)
+    {
+        struct stat file_stat;
+
+        preloaded.fd = open(preloaded.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(preloaded.fd < 0)
+            return;
+
+        /* Anything but a regular file is left for `FileAPI` to deal with. */
+        if(fstat(preloaded.fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+            return;
+
+        preloaded.size = file_stat.st_size;
+        ut_LSIZE read_size = get_read_size(preloaded.size);
+        if(read_size == 0)
+            return;
+
+        preloaded.data = new ut_BYTE[read_size];
+        while(preloaded.loaded < read_size)
+        {
+            ssize_t result = pread(preloaded.fd, preloaded.data + preloaded.loaded, read_size - preloaded.loaded, preloaded.loaded);
+
+            if(result < 0 && errno == EINTR)
+                continue;
+
+            /* A read error is `FileAPI`'s to report; it reads the file itself. */
+            if(result < 0)
+            {
+                delete[] preloaded.data;
+                preloaded.data = nullptr;
+                preloaded.loaded = 0;
+                return;
+            }
+
+            /* The file got shorter since `fstat`; it is what could be read. */
+            if(result == 0)
+            {
+                preloaded.size = preloaded.loaded;
+                return;
+            }
+
+            preloaded.loaded += result;
+        }
+    }
+
+    void io_loop()
+    {
+        while(true)
+        {
+            FBWW_preloaded preloaded;
+
+            {
+                std::unique_lock<std::mutex> io_guard(io_lock);
+                request_cond.wait(io_guard, [this] { return !requests.empty() || closed; });
+
+                if(requests.empty())
+                    return;
+
+                preloaded.path = std::move(requests.front());
+                requests.pop_front();
+            }
+
+            load(preloaded);
+
+            {
+                std::lock_guard<std::mutex> io_guard(io_lock);
+                done.push_back(std::move(preloaded));
+            }
+            done_cond.notify_one();
+        }
+    }
+
+public:
+    DotDoc_ThreadIO(ut_DWORD queue_depth, ut_LSIZE file_read_limit, bool prefix)
+        : DotDoc_AsyncIO(queue_depth, file_read_limit, prefix)
+    {
+        ut_DWORD thread_count = std::min<ut_DWORD> (depth, dot_doc_io_max_threads);
+
+        for(ut_DWORD i = 0; i < thread_count; i++)
+            io_threads.emplace_back(&DotDoc_ThreadIO::io_loop, this);
+    }
+
+    void submit(std::string path) override
+    {
+        {
+            std::lock_guard<std::mutex> io_guard(io_lock);
+            requests.push_back(std::move(path));
+        }
+
+        in_flight++;
+        request_cond.notify_one();
+    }
+
+    bool poll(FBWW_preloaded& preloaded) override
+    {
+        std::lock_guard<std::mutex> io_guard(io_lock);
+        if(done.empty())
+            return false;
+
+        preloaded = std::move(done.front());
+        done.pop_front();
+        in_flight--;
+
+        return true;
+    }
+
+    bool reap(FBWW_preloaded& preloaded) override
+    {
+        if(in_flight == 0)
+            return false;
+
+        std::unique_lock<std::mutex> io_guard(io_lock);
+        done_cond.wait(io_guard, [this] { return !done.empty(); });
+
+        preloaded = std::move(done.front());
+        done.pop_front();
+        in_flight--;
+
+        return true;
+    }
+
+    const nt_BYTE *get_name() override
+    { return "threads"; }
+
+    ~DotDoc_ThreadIO()
+    {
+        {
+            std::lock_guard<std::mutex> io_guard(io_lock);
+            closed = true;
+        }
+        request_cond.notify_all();
+
+        /* The threads finish every request still queued before they exit. */
+        for(std::thread& io_thread : io_threads)
+            io_thread.join();
+
+        for(FBWW_preloaded& preloaded : done)
+            discard(preloaded);
+    }
+};
+
+#if DOT_DOC_IO_URING
+/* DotDoc_UringIO - io_uring, through the raw syscalls (no liburing); one ring, fed and drained by the batch's thread.
+ *           A file takes two round trips: `openat` and `statx` (by path) go in together, then, once both are back and the
+ *           file is small enough, `read`s until it is read. Submissions are flushed `dot_doc_io_submit_batch` at a time, or
+ *           when waiting for completions; `poll` only looks at the completion ring and costs no syscall at all.
+ *
+ * Variables:
+ *      io_request *requests - One slot per file in flight; a completion's `user_data` is its slot * 4 + `io_op`.
+ *      ut_DWORD *free_slots - Slots not in use.
+ *      ut_DWORD to_submit - Queued submissions the kernel has not been told about yet.
+ */
+class DotDoc_UringIO : public DotDoc_AsyncIO
+{
+private:
+    enum class io_op : ut_BYTE
+    {
+        open = 0,
+        stat = 1,
+        read = 2
+    };
+
+    struct io_request
+    {
+        FBWW_preloaded preloaded;
+        struct statx file_stat;
+        nt_DWORD stat_result = 0;
+        ut_LSIZE read_size = 0;
+        ut_BYTE waiting = 0;
+    };
+
+    nt_DWORD ring_fd = -1;
+    void *sq_ring = MAP_FAILED;
+    void *cq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    struct io_uring_sqe *sqes = (struct io_uring_sqe *) MAP_FAILED;
+    size_t sqes_size = 0;
+
+    ut_DWORD *sq_head, *sq_tail, *sq_mask, *sq_array, sq_entries = 0;
+    ut_DWORD *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    ut_DWORD to_submit = 0;
+
+    io_request *requests = nullptr;
+    ut_DWORD *free_slots = nullptr;
+    ut_DWORD free_count = 0;
+    std::deque<FBWW_preloaded> done;
+
+    /* Whether the kernel knows all of `ops`; io_uring itself being there does not mean `openat` or `statx` are. */
+    bool supports(std::initializer_list<ut_BYTE> ops)
+    {
+        const ut_DWORD probe_ops = 256;
+        ut_BYTE probe_memory[sizeof(struct io_uring_probe) + probe_ops * sizeof(struct io_uring_probe_op)] = {};
+        struct io_uring_probe *probe = (struct io_uring_probe *) probe_memory;
+
+        if(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+            return false;
+
+        for(ut_BYTE op : ops)
+            if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return false;
+
+        return true;
+    }
+
+    /* Tell the kernel about queued submissions and, with `wait_for`, wait for that many completions. */
+    void enter(ut_DWORD wait_for)
+    {
+        while(true)
+        {
+            nt_DWORD result = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_for, wait_for ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+            if(result >= 0)
+            {
+                to_submit -= std::min<ut_DWORD> (result, to_submit);
+                return;
+            }
+
+            if(errno == EINTR)
+                continue;
+
+            /* Out of room for completions (or kernel memory) for the moment; drain what is there and try again. */
+            if((errno == EBUSY || errno == EAGAIN) && drain())
+                continue;
+
+            dot_doc_error("\n%sI/O Error:%s\n\t`io_uring_enter` failed: %s.\n",
+                red, white,
+                strerror(errno))
+        }
+    }
+
+    struct io_uring_sqe *get_sqe()
+    {
+        ut_DWORD tail = *sq_tail;
+
+        if(tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries)
+        {
+            enter(0);
+            tail = *sq_tail;
+        }
+
+        ut_DWORD index = tail & *sq_mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+
+        sq_array[index] = index;
+        return sqe;
+    }
+
+    void queue(struct io_uring_sqe *sqe, ut_DWORD slot, io_op op)
+    {
+        sqe->user_data = (ut_LSIZE) slot * 4 + (ut_BYTE) op;
+        __atomic_store_n(sq_tail, *sq_tail + 1, __ATOMIC_RELEASE);
+        to_submit++;
+    }
+
+    void flush_batch()
+    {
+        if(to_submit >= dot_doc_io_submit_batch) enter(0);
+    }
+
+    void queue_read(ut_DWORD slot)
+    {
+        io_request& request = requests[slot];
+        ut_LSIZE left = request.read_size - request.preloaded.loaded;
+
+        struct io_uring_sqe *sqe = get_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = request.preloaded.fd;
+        sqe->addr = (ut_LSIZE) (request.preloaded.data + request.preloaded.loaded);
+        sqe->len = left < (1U << 30) ? left : (1U << 30);
+        sqe->off = request.preloaded.loaded;
+
+        request.waiting = 1;
+        queue(sqe, slot, io_op::read);
+        flush_batch();
+    }
+
+    void finish_request(ut_DWORD slot)
+    {
+        io_request& request = requests[slot];
+
+        done.push_back(std::move(request.preloaded));
+        request.preloaded = FBWW_preloaded();
+        request.read_size = 0;
+
+        free_slots[free_count++] = slot;
+    }
+
+    /* `openat` and `statx` are both back; read the file, or hand it over as it is. */
+    void opened(ut_DWORD slot)
+    {
+        io_request& request = requests[slot];
+
+        /* Anything but a regular file, or a file that could not be opened, is left for `FileAPI` to deal with. */
+        if(request.preloaded.fd < 0 || request.stat_result < 0 || !S_ISREG(request.file_stat.stx_mode))
+        {
+            finish_request(slot);
+            return;
+        }
+
+        request.preloaded.size = request.file_stat.stx_size;
+        request.read_size = get_read_size(request.preloaded.size);
+        if(request.read_size == 0)
+        {
+            finish_request(slot);
+            return;
+        }
+
+        request.preloaded.data = new ut_BYTE[request.read_size];
+        queue_read(slot);
+    }
+
+    void complete(ut_DWORD slot, io_op op, nt_DWORD result)
+    {
+        io_request& request = requests[slot];
+        request.waiting--;
+
+        switch(op)
+        {
+            case io_op::open: request.preloaded.fd = result; break;
+            case io_op::stat: request.stat_result = result; break;
+            case io_op::read: {
+                /* A read error is `FileAPI`'s to report; it reads the file itself. */
+                if(result < 0 && result != -EINTR && result != -EAGAIN)
+                {
+                    delete[] request.preloaded.data;
+                    request.preloaded.data = nullptr;
+                    request.preloaded.loaded = 0;
+                    finish_request(slot);
+                    return;
+                }
+
+                /* End of file before `read_size`; the file got shorter since `statx`. */
+                if(result == 0)
+                {
+                    request.preloaded.size = request.preloaded.loaded;
+                    finish_request(slot);
+                    return;
+                }
+
+                if(result > 0) request.preloaded.loaded += result;
+
+                if(request.preloaded.loaded < request.read_size) queue_read(slot);
+                else finish_request(slot);
+                return;
+            }
+        }
+
+        if(request.waiting == 0)
+            opened(slot);
+    }
+
+    /* Process every completion in the ring; true if there were any. */
+    bool drain()
+    {
+        bool drained = false;
+
+        /* `complete` may queue more work, and submitting it may drain in turn; the head is read again every time. */
+        for(ut_DWORD head = *cq_head; head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE); head = *cq_head)
+        {
+            struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+            ut_LSIZE user_data = cqe->user_data;
+            nt_DWORD result = cqe->res;
+
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            complete(user_data / 4, (io_op) (user_data % 4), result);
+            drained = true;
+        }
+
+        return drained;
+    }
+
+    bool hand_over(FBWW_preloaded& preloaded)
+    {
+        if(done.empty())
+            return false;
+
+        preloaded = std::move(done.front());
+        done.pop_front();
+        in_flight--;
+
+        return true;
+    }
+
+public:
+    DotDoc_UringIO(ut_DWORD queue_depth, ut_LSIZE file_read_limit, bool prefix)
+        : DotDoc_AsyncIO(queue_depth, file_read_limit, prefix)
+    {}
+
+    /* Set up the ring; false if io_uring, or one of the operations used, is not there. */
+    bool start()
+    {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+
+        /* Every file has at most two submissions out at a time. */
+        ring_fd = syscall(__NR_io_uring_setup, depth * 2, &params);
+        if(ring_fd < 0 || !supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ}))
+            return false;
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(ut_DWORD);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+        sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if(sq_ring == MAP_FAILED)
+            return false;
+
+        cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? sq_ring
+            : mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if(cq_ring == MAP_FAILED)
+            return false;
+
+        sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = (struct io_uring_sqe *) mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if(sqes == MAP_FAILED)
+            return false;
+
+        sq_head = ut_DWORD_PTR (ut_BYTE_PTR sq_ring + params.sq_off.head);
+        sq_tail = ut_DWORD_PTR (ut_BYTE_PTR sq_ring + params.sq_off.tail);
+        sq_mask = ut_DWORD_PTR (ut_BYTE_PTR sq_ring + params.sq_off.ring_mask);
+        sq_array = ut_DWORD_PTR (ut_BYTE_PTR sq_ring + params.sq_off.array);
+        sq_entries = params.sq_entries;
+
+        cq_head = ut_DWORD_PTR (ut_BYTE_PTR cq_ring + params.cq_off.head);
+        cq_tail = ut_DWORD_PTR (ut_BYTE_PTR cq_ring + params.cq_off.tail);
+        cq_mask = ut_DWORD_PTR (ut_BYTE_PTR cq_ring + params.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe *) (ut_BYTE_PTR cq_ring + params.cq_off.cqes);
+
+        requests = new io_request[depth];
+        free_slots = new ut_DWORD[depth];
+        for(ut_DWORD slot = depth; slot > 0; slot--) free_slots[free_count++] = slot - 1;
+
+        return true;
+    }
+
+    void submit(std::string path) override
+    {
+        dot_doc_assert(free_count > 0, "\n%sI/O Error:%s\n\tMore than %u files were submitted at once.\n",
+            red, white,
+            depth)
+
+        ut_DWORD slot = free_slots[--free_count];
+        io_request& request = requests[slot];
+        request.preloaded.path = std::move(path);
+        request.stat_result = 0;
+        request.waiting = 2;
+        in_flight++;
+
+        struct io_uring_sqe *sqe = get_sqe();
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (ut_LSIZE) request.preloaded.path.c_str();
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        queue(sqe, slot, io_op::open);
+
+        sqe = get_sqe();
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (ut_LSIZE) request.preloaded.path.c_str();
+        sqe->len = STATX_TYPE | STATX_SIZE;
+        sqe->off = (ut_LSIZE) &request.file_stat;
+        queue(sqe, slot, io_op::stat);
+
+        flush_batch();
+    }
+
+    bool poll(FBWW_preloaded& preloaded) override
+    {
+        drain();
+        return hand_over(preloaded);
+    }
+
+    bool reap(FBWW_preloaded& preloaded) override
+    {
+        while(!hand_over(preloaded))
+        {
+            if(in_flight == 0)
+                return false;
+
+            if(!drain()) enter(1);
+        }
+
+        return true;
+    }
+
+    const nt_BYTE *get_name() override
+    { return "io_uring"; }
+
+    ~DotDoc_UringIO()
+    {
+        FBWW_preloaded preloaded;
+
+        /* Nothing the kernel may still write to can be freed before it is done with it. */
+        try
+        {
+            if(requests)
+                while(reap(preloaded)) discard(preloaded);
+        }
+        catch(dot_doc_fatal_error&) {}
+
+        delete[] requests;
+        delete[] free_slots;
+
+        if(sqes != MAP_FAILED) munmap(sqes, sqes_size);
+        if(cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if(sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+        if(ring_fd >= 0) close(ring_fd);
+    }
+};
+#endif
+
+inline DotDoc_AsyncIO *DotDoc_AsyncIO::get_async_io(ut_DWORD queue_depth, ut_LSIZE file_read_limit, bool prefix)
+{
+#if DOT_DOC_IO_URING
+    DotDoc_UringIO *uring_IO = new DotDoc_UringIO(queue_depth, file_read_limit, prefix);
+    if(uring_IO->start())
+        return uring_IO;
+
+    delete uring_IO;
+#endif
+
+    return new DotDoc_ThreadIO(queue_depth, file_read_limit, prefix);
+}
+
+#endif
@@ -0,0 +1,381 @@
+#ifndef dot_doc_batch
+#define dot_doc_batch
+
+/* DotDoc_Batch - decodes many WDBFs in one process, spread over all cores via `DotDoc_ThreadPool`.
+ *           Paths can be added one at a time (`add_path`; directories are walked recursively for `.doc` files) or read,
+ *           newline-separated, from a stream (`add_paths_from`). Every file gets exactly one result record; a file that
+ *           fails to decode is reported as such and the batch carries on.
+ *
+ * Variables:
+ *      std::atomic<ut_LSIZE> decoded_count - Files that decoded (possibly after repairing flaws in the header).
+ *      std::atomic<ut_LSIZE> failed_count - Files that could not be decoded.
+ *      std::mutex report_lock - Serializes results so records from different workers never interleave.
+ *      DotDoc_Sink *sink - Where the results go (`dot_doc_sink_format`); one record per file, then the summary.
+ *      DotDoc_StatsSummary *stats_summary - Statistics of every decoded file (`collect_stats`); printed to stderr by `finish`,
+ *                                           so the sink's output stays as it is. `nullptr` unless asked for.
+ *      ut_LSIZE cache_budget - Read every file through a sector cache of this many bytes (`FBWW_cached`); zero maps them.
+ *      const nt_BYTE *sidecar_directory - Where the sidecar indexes of the files are kept (`use_sidecars`); `nullptr` for none.
+ *      bool probe - Only classify every file from its header block (`DotDoc_Header::probe_WDBF_heading`); nothing past the
+ *                   first 512 bytes of any file is read. `FAT_entries` is then what the header declares, `directory_entries` zero.
+ *      bool metadata_only - Only read the metadata of every file (`DotDoc_File::read_metadata`); of a file, nothing but the
+ *                           header, the FAT, the directory and the two property set streams is read.
+ *      FILE *trace - Chrome trace (`write_trace`) the phases of every decoded file go to; `nullptr` unless asked for.
+ *      DotDoc_AsyncIO *async_IO - Opens and reads files ahead of the workers (`use_async_io`), `io_depth` of them at a time; the
+ *                                 workers then start decoding from memory. Small files (up to `dot_doc_io_preload_max`) are
+ *                                 read whole, only the header block is read for probing, and nothing is read through the
+ *                                 sector cache. Created on the first file queued; `nullptr` when every worker opens its own files.
+ */
+class DotDoc_Batch
+{
+private:
+    std::atomic<ut_LSIZE> decoded_count{0};
+    std::atomic<ut_LSIZE> failed_count{0};
+    std::mutex report_lock;
+    DotDoc_Sink *sink;
+    DotDoc_StatsSummary *stats_summary = nullptr;
+    ut_LSIZE cache_budget = 0;
+    const nt_BYTE *sidecar_directory = nullptr;
+    bool probe = false;
+    bool metadata_only = false;
+    FILE *trace = nullptr;
+    bool first_trace_event = true;
+    DotDoc_AsyncIO *async_IO = nullptr;
+    ut_DWORD io_depth = 0;
+    DotDoc_ThreadPool<FBWW_preloaded> pool;
+
+    /* Strip color escapes, and collapse newlines/tabs, so an error message fits on the result line. */
+    static std::string compact_message(const nt_BYTE *message)
+    {
+        std::string compacted;
+
+        for(const nt_BYTE *c = message; *c; c++)
+        {
+            if(*c == '\e')
+            {
+                while(*c && *c != 'm') c++;
+                if(!*c) break;
+                continue;
+            }
+
+            if(*c == '\n' || *c == '\t' || *c == ' ')
+            {
+                if(!compacted.empty() && compacted.back() != ' ') compacted.push_back(' ');
+                continue;
+            }
+
+            compacted.push_back(*c);
+        }
+
+        while(!compacted.empty() && compacted.back() == ' ') compacted.pop_back();
+        return compacted;
+    }
+
+    void report(struct dot_doc_file_result& result, DotDoc_Stats *stats = nullptr)
+    {
+        std::lock_guard<std::mutex> report_guard(report_lock);
+        sink->write_result(result);
+
+        if(stats && stats_summary) stats_summary->add(*stats);
+        if(stats && trace) stats->write_trace(trace, result.path, first_trace_event);
+    }
+
+    void report_failure(std::string& path, std::string message)
+    {
+        struct dot_doc_file_result result;
+        result.path = path;
+        result.message = message;
+
+        failed_count++;
+        report(result);
+    }
+
+    static void copy_flaws(error_log *flaw_log, struct dot_doc_file_result& result)
+    {
+        struct error_record flaw;
+
+        result.flaw_count = flaw_log->get_error_count();
+        for(ut_DWORD index = 0; index < flaw_log->get_record_count(); index++)
+            if(flaw_log->get_record(index, flaw)) result.flaws.push_back(flaw);
+    }
+
+    static bool probe_into(FBWW_preloaded& file, struct dot_doc_file_result& result, DotDoc_Stats *stats)
+    {
+        DotDoc_Header WDBFH(file, true, FileAPI_backend::FBWW_probe);
+        WDBF_probe_verdict verdict = WDBFH.probe_WDBF_heading();
+
+        if(verdict == WDBF_probe_verdict::WDBF_damaged || verdict == WDBF_probe_verdict::WDBF_not_CFB)
+        {
+            result.message = get_probe_verdict_name(verdict);
+            return false;
+        }
+
+        const struct _dot_doc_header *WDBF_header = WDBFH.get_WDBF_header();
+
+        result.decoded = true;
+        result.major_version = WDBF_header->CFB_major_version;
+        result.sector_size = WDBF_header->get_sector_size();
+        result.FAT_entries = WDBF_header->CFB_number_of_FAT_sectors * (WDBF_header->get_sector_size() / sizeof(ut_DWORD));
+        copy_flaws(WDBFH.get_error_log(), result);
+
+        if(stats) *stats = WDBFH.get_fapi()->get_stats();
+        return true;
+    }
+
+    void decode_file(FBWW_preloaded& file, ut_DWORD)
+    {
+        struct dot_doc_file_result result;
+        DotDoc_Stats stats;
+
+        if(!decode_into(file, result, probe, cache_budget, false, &stats, sidecar_directory, nullptr, metadata_only))
+        {
+            failed_count++;
+            report(result);
+            return;
+        }
+
+        decoded_count++;
+        report(result, &stats);
+    }
+
+    /* Hand a file over to the workers; through `async_IO` if there is one, handing over every file it has done meanwhile. */
+    void queue_file(std::string path)
+    {
+        FBWW_preloaded file;
+
+        if(io_depth > 0 && !async_IO)
+        {
+            /* Reading a whole file ahead is wasted on metadata, which is in a few of its sectors; it is only opened. */
+            ut_LSIZE read_limit = probe ? FBWW_probe_size : cache_budget || metadata_only ? 0 : dot_doc_io_preload_max;
+            async_IO = DotDoc_AsyncIO::get_async_io(io_depth, read_limit, probe);
+        }
+
+        if(!async_IO)
+        {
+            file.path = std::move(path);
+            pool.submit(file);
+            return;
+        }
+
+        while(async_IO->poll(file)) pool.submit(file);
+        if(async_IO->is_full() && async_IO->reap(file)) pool.submit(file);
+
+        async_IO->submit(std::move(path));
+    }
+
+    static bool is_doc_file(const std::filesystem::path& path)
+    {
+        std::string extension = path.extension().string();
+        for(nt_BYTE& c : extension) c = tolower(c);
+
+        return extension == ".doc";
+    }
+
+public:
+    /* Decode `file` into `result`, or only probe it (`probe`); see `use_sector_cache` for `cache_budget` and `use_sidecars` for
+     * `sidecar_directory`. With `with_text` the text of the document goes into `result.text`, extracted only where the file
+     * changed since its snapshot in `snapshot_directory` if there is one (`DotDoc_Snapshot`), and `stats` gets the statistics
+     * of the session if given. With `metadata_only`, the file is decoded no further than its directory and `result.metadata`
+     * gets its properties instead. Whatever went wrong ends up in `result.message`; returns whether the file decoded.
+     * */
+    static bool decode_into(FBWW_preloaded& file, struct dot_doc_file_result& result, bool probe, ut_LSIZE cache_budget,
+                            bool with_text = false, DotDoc_Stats *stats = nullptr, const nt_BYTE *sidecar_directory = nullptr,
+                            const nt_BYTE *snapshot_directory = nullptr, bool metadata_only = false)
+    {
+        /* One session per worker thread, kept warm from file to file. */
+        static thread_local DotDoc_Session session;
+
+        bool decoded = false;
+        result.path = file.path;
+
+        try
+        {
+            if(probe)
+                decoded = probe_into(file, result, stats);
+            else
+            {
+                session.set_backend(cache_budget ? FileAPI_backend::FBWW_cached : FileAPI_backend::FBWW_mapped, cache_budget);
+                session.set_sidecar_directory(sidecar_directory);
+                session.set_snapshot_directory(snapshot_directory);
+                session.open(file);
+
+                if(metadata_only)
+                {
+                    session.read_metadata(result.metadata);
+                    result.has_metadata = true;
+                }
+                else
+                    session.decode();
+
+                DotDoc_File *WDBF = session.get_file();
+                const struct _dot_doc_header *WDBF_header = WDBF->get_header()->get_WDBF_header();
+
+                result.major_version = WDBF_header->CFB_major_version;
+                result.sector_size = WDBF_header->get_sector_size();
+                result.FAT_entries = WDBF->get_FAT()->get_table_size();
+                result.directory_entries = WDBF->get_directory()->get_entry_count();
+
+                /* The records are copied out as they are; the sink formats them, if it formats them at all. */
+                copy_flaws(WDBF->get_header()->get_error_log(), result);
+
+                if(with_text)
+                {
+                    session.append_text(result.text);
+                    result.has_text = true;
+                }
+
+                result.decoded = decoded = true;
+                if(stats) *stats = WDBF->get_header()->get_fapi()->get_stats();
+            }
+        }
+        catch(dot_doc_fatal_error& fatal_error)
+        {
+            result.message = compact_message(fatal_error.what());
+        }
+        catch(std::exception& exception)
+        {
+            result.message = exception.what();
+        }
+
+        /* Whatever `FileAPI` did not get to take over; the file is not kept open past its record, decoded or not. */
+        DotDoc_AsyncIO::discard(file);
+        session.close();
+
+        /* A file that failed part of the way carries nothing but its path and the reason. */
+        if(!decoded)
+        {
+            std::string path = std::move(result.path), message = std::move(result.message);
+            result = dot_doc_file_result();
+            result.path = std::move(path);
+            result.message = std::move(message);
+        }
+
+        return decoded;
+    }
+
+    /* `jobs` of zero means one worker per core. */
+    DotDoc_Batch(ut_DWORD jobs = 0, dot_doc_sink_format format = dot_doc_sink_format::human)
+        : sink(DotDoc_Sink::get_sink(format)), pool(jobs > 0 ? jobs : std::max(1u, std::thread::hardware_concurrency()),
+            [this](FBWW_preloaded& file, ut_DWORD worker_ID) { decode_file(file, worker_ID); })
+    {}
+
+    /* Decode every file through a sector cache of `budget` bytes, so memory no longer grows with the size of the files;
+     * call before queueing any.
+     * */
+    void use_sector_cache(ut_LSIZE budget)
+    { cache_budget = budget; }
+
+    /* Probe rather than decode every file; call before queueing any. */
+    void probe_only()
+    { probe = true; }
+
+    /* Read the metadata of every file rather than decode it; call before queueing any. */
+    void read_metadata_only()
+    { metadata_only = true; }
+
+    /* Decode every file from its sidecar index in `directory` when it has a usable one, and save one there when it does not
+     * (`DotDoc_Sidecar`); call before queueing any. Not for probing, which reads nothing an index would save.
+     * */
+    void use_sidecars(const nt_BYTE *directory)
+    { sidecar_directory = directory; }
+
+    /* Open and read files `depth` at a time ahead of the workers (`DotDoc_AsyncIO`); call before queueing any. */
+    void use_async_io(ut_DWORD depth)
+    {
+        io_depth = depth;
+
+        /* Queued files now hold their data; a few per worker keep them busy without holding many in memory. */
+        if(io_depth > 0) pool.set_max_pending(pool.get_worker_count() * 4);
+    }
+
+    /* Keep statistics of every decoded file; call before queueing any. */
+    void collect_stats()
+    {
+        if(!stats_summary) stats_summary = new DotDoc_StatsSummary;
+    }
+
+    /* Write the phases of every decoded file to `trace_path` as a Chrome trace (chrome://tracing, Perfetto); call before queueing any. */
+    void write_trace_to(const nt_BYTE *trace_path)
+    {
+        trace = fopen(trace_path, "w");
+        dot_doc_assert(trace, "\n%sArgument Error:%s\n\tCould not create the trace `%s`.\n",
+            red, white,
+            trace_path)
+
+        fputs("{\"traceEvents\":[\n", trace);
+    }
+
+    /* Queue a file, or every `.doc` file under a directory. */
+    void add_path(std::string path)
+    {
+        std::error_code walk_error;
+
+        if(!std::filesystem::is_directory(path, walk_error))
+        {
+            queue_file(path);
+            return;
+        }
+
+        std::filesystem::recursive_directory_iterator walker(path, std::filesystem::directory_options::skip_permission_denied, walk_error);
+        for(; !walk_error && walker != std::filesystem::recursive_directory_iterator(); walker.increment(walk_error))
+        {
+            if(walker->is_regular_file(walk_error) && is_doc_file(walker->path()))
+                queue_file(walker->path().string());
+        }
+
+        if(walk_error)
+            report_failure(path, walk_error.message());
+    }
+
+    /* Queue every path listed, one per line, in `list` (e.g. stdin). */
+    void add_paths_from(FILE *list)
+    {
+        nt_BYTE *line = nullptr;
+        size_t line_capacity = 0;
+        ssize_t line_length;
+
+        while((line_length = getline(&line, &line_capacity, list)) != -1)
+        {
+            while(line_length > 0 && (line[line_length - 1] == '\n' || line[line_length - 1] == '\r'))
+                line[--line_length] = '\0';
+
+            if(line_length > 0) add_path(line);
+        }
+
+        free(line);
+    }
+
+    /* Wait for every queued file, print the summary and return the exit status for the process. */
+    nt_DWORD finish()
+    {
+        FBWW_preloaded file;
+        while(async_IO && async_IO->reap(file)) pool.submit(file);
+
+        pool.finish();
+
+        sink->write_summary(decoded_count.load(), failed_count.load());
+        sink->flush();
+
+        if(stats_summary) stats_summary->print(stderr);
+        if(stats_summary && async_IO) fprintf(stderr, "I/O: %s, %u files in flight\n", async_IO->get_name(), async_IO->get_depth());
+        if(trace)
+        {
+            fputs("\n]}\n", trace);
+            fclose(trace);
+            trace = nullptr;
+        }
+
+        return failed_count.load() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    ~DotDoc_Batch()
+    {
+        /* Workers may still be reporting to the sink. */
+        pool.finish();
+        delete async_IO;
+        delete sink;
+        delete stats_summary;
+        if(trace) fclose(trace);
+    }
+};
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef dot_doc_FIB
+#define dot_doc_FIB
+
+#define WDBF_FIB_ident              0xA5EC  // `wIdent`; every Word Binary File starts its `WordDocument` stream with EC A5
+#define WDBF_FIB_base_size          0x20    // FibBase is always 32 bytes
+#define WDBF_FIB_fWhichTblStm       0x0200  // Bit of `FIB_flags`; set when the table stream is `1Table`, clear for `0Table`
+
+/* FibBase flag bits (`FIB_flags`). */
+#define WDBF_FIB_fDot               0x0001
+#define WDBF_FIB_fGlsy              0x0002
+#define WDBF_FIB_fComplex           0x0004
+#define WDBF_FIB_fHasPic            0x0008
+#define WDBF_FIB_fEncrypted         0x0100
+#define WDBF_FIB_fReadOnlyRecommended 0x0400
+#define WDBF_FIB_fWriteReservation  0x0800
+#define WDBF_FIB_fExtChar           0x1000
+#define WDBF_FIB_fObfuscated        0x8000
+
+/* FibRgLw97 fields; index of the 4-byte value. The indices not listed are reserved. */
+enum class fib_lw : ut_WORD
+{
+    cbMac       = 0,
+    ccpText     = 3,
+    ccpFtn      = 4,
+    ccpHdd      = 5,
+    ccpAtn      = 7,
+    ccpEdn      = 8,
+    ccpTxbx     = 9,
+    ccpHdrTxbx  = 10
+};
+
+/* FibRgFcLcb fields; index of the fc/lcb pair (`fc` at `index * 8`, `lcb` at `index * 8 + 4`).
+ * These are the 93 pairs of FibRgFcLcb97, which every later variant (2000, 2002, 2003, 2007) starts with; pairs of the later
+ * variants can be read by passing their index directly.
+ * */
+enum class fib_fc_lcb : ut_WORD
+{
+    StshfOrig = 0, Stshf, PlcffndRef, PlcffndTxt, PlcfandRef, PlcfandTxt, PlcfSed, PlcPad, PlcfPhe, SttbfGlsy, PlcfGlsy,
+    PlcfHdd, PlcfBteChpx, PlcfBtePapx, PlcfSea, SttbfFfn, PlcfFldMom, PlcfFldHdr, PlcfFldFtn, PlcfFldAtn, PlcfFldMcr,
+    SttbfBkmk, PlcfBkf, PlcfBkl, Cmds, Unused1, SttbfMcr, PrDrvr, PrEnvPort, PrEnvLand, Wss, Dop, SttbfAssoc,
+    Clx,                                                                                    // 33; the piece table
+    PlcfPgdFtn, AutosaveSource, GrpXstAtnOwners, SttbfAtnBkmk, Unused2, Unused3, PlcSpaMom, PlcSpaHdr, PlcfAtnBkf,
+    PlcfAtnBkl, Pms, FormFldSttbs, PlcfendRef, PlcfendTxt, PlcfFldEdn, Unused4, DggInfo, SttbfRMark, SttbfCaption,
+    SttbfAutoCaption, PlcfWkb, PlcfSpl, PlcftxbxTxt, PlcfFldTxbx, PlcfHdrtxbxTxt, PlcffldHdrTxbx, StwUser, SttbTtmbd,
+    CookieData, PgdMotherOldOld, BkdMotherOldOld, PgdFtnOldOld, BkdFtnOldOld, PgdEdnOldOld, BkdEdnOldOld, SttbfIntlFld,
+    RouteSlip, SttbSavedBy, SttbFnm, PlfLst, PlfLfo, PlcfTxbxBkd, PlcfTxbxHdrBkd, DocUndoWord9, RgbUse, Usp, Uskf,
+    PlcupcRgbUse, PlcupcUsp, SttbGlsyStyle, Plgosl, Plcocx, PlcfBteLvc, ModifiedTime, PlcfLvcPre10, PlcfAsumy, PlcfGram,
+    SttbListNames, SttbfUssr,
+    FibRgFcLcb97_count                                                                      // 93 (0x5D)
+};
+
+/* FibBase; the first 32 bytes of the `WordDocument` stream, decoded eagerly. */
+struct _dot_doc_FIB_base
+{
+    ut_WORD         FIB_ident;              // EC A5
+    ut_WORD         FIB_nFib;               // File format version; superseded by `nFibNew` in FibRgCswNew when present
+    ut_WORD         FIB_lid;                // Install language of the application that created the file
+    ut_WORD         FIB_pnNext;             // Offset (in 512-byte units) of the AutoText FIB, if any
+    ut_WORD         FIB_flags;              // fDot, fGlsy, fComplex, ..., fWhichTblStm, ..., fObfuscated
+    ut_WORD         FIB_nFibBack;
+    ut_DWORD        FIB_lKey;               // Encryption/obfuscation key when `fEncrypted` is set
+    ut_BYTE         FIB_envr;
+    ut_BYTE         FIB_flags2;             // fMac, fEmptySpecial, fLoadOverridePage, ...
+};
+
+/* DotDoc_FIB - the File Information Block at the start of the `WordDocument` stream.
+ *           Only FibBase is decoded up front. For everything after it (FibRgW97, FibRgLw97, the FibRgFcLcb variant and
+ *           FibRgCswNew) only the counts are read, to work out where each part starts; a field is decoded when its
+ *           accessor is called, as a bounds-checked little-endian load at that offset. Most decodes only need
+ *           `fcClx`/`lcbClx` and `fWhichTblStm`, so the hundreds of other fc/lcb pairs are never touched.
+ *
+ *           The FIB bytes are viewed in place in the `WordDocument` stream; they are only copied (into `FIB_copy`, in the session's arena) when the
+ *           FIB straddles two extents of a fragmented stream, or the file is read through the sector cache.
+ *
+ * Variables:
+ *      struct _dot_doc_FIB_base FIB_base - The decoded FibBase.
+ *      FBWW_span FIB - The whole FIB, FibBase through FibRgCswNew.
+ *      ut_DWORD rgW_offset, rgLw_offset, rgFcLcb_offset, rgCswNew_offset - Offset, into `FIB`, of FibRgW97, FibRgLw97, FibRgFcLcb
+ *          and FibRgCswNew.
+ *      ut_WORD csw, cslw, cbRgFcLcb, cswNew - Number of 2-byte, 4-byte, 8-byte (fc/lcb pair) and 2-byte values in each part.
+ */
+class DotDoc_FIB
+{
+private:
+    struct _dot_doc_FIB_base FIB_base;
+    FBWW_span FIB;
+    ut_BYTE *FIB_copy = nullptr;
+    ut_LSIZE FIB_copy_capacity = 0;
+
+    ut_WORD csw = 0, cslw = 0, cbRgFcLcb = 0, cswNew = 0;
+    ut_DWORD rgW_offset = 0, rgLw_offset = 0, rgFcLcb_offset = 0, rgCswNew_offset = 0;
+
+public:
+    DotDoc_FIB() = default;
+    DotDoc_FIB(const DotDoc_FIB&) = delete;
+
+    void parse(DotDoc_Stream& WordDocument)
+    {
+        dot_doc_assert(WordDocument.get_size() >= WDBF_FIB_base_size + sizeof(ut_WORD),
+            "\n%sFIB Error:%s\n\tThe `WordDocument` stream is only %llu bytes; too small to hold a FIB.\n",
+            red, white,
+            WordDocument.get_size())
+
+        /* FibBase. */
+        ut_BYTE base_scratch[WDBF_FIB_base_size];
+        FBWW_span base = WordDocument.view(0, WDBF_FIB_base_size, base_scratch);
+
+        FIB_base.FIB_ident      = base.get<ut_WORD> (0x00);
+        FIB_base.FIB_nFib       = base.get<ut_WORD> (0x02);
+        FIB_base.FIB_lid        = base.get<ut_WORD> (0x06);
+        FIB_base.FIB_pnNext     = base.get<ut_WORD> (0x08);
+        FIB_base.FIB_flags      = base.get<ut_WORD> (0x0A);
+        FIB_base.FIB_nFibBack   = base.get<ut_WORD> (0x0C);
+        FIB_base.FIB_lKey       = base.get<ut_DWORD> (0x0E);
+        FIB_base.FIB_envr       = base.get<ut_BYTE> (0x12);
+        FIB_base.FIB_flags2     = base.get<ut_BYTE> (0x13);
+
+        dot_doc_assert(FIB_base.FIB_ident == WDBF_FIB_ident,
+            "\n%sFIB Error:%s\n\tThe FIB identifier is `%X`; expected `%X`. The `WordDocument` stream is not a Word Binary File.\n",
+            red, white,
+            FIB_base.FIB_ident, WDBF_FIB_ident)
+
+        /* Counts of the variable-sized parts; each count precedes its part. */
+        rgW_offset = WDBF_FIB_base_size + sizeof(ut_WORD);
+        csw = WordDocument.get<ut_WORD> (WDBF_FIB_base_size);
+
+        ut_LSIZE count_offset = rgW_offset + (ut_LSIZE) csw * sizeof(ut_WORD);
+        dot_doc_assert(count_offset + sizeof(ut_WORD) <= WordDocument.get_size(),
+            "\n%sFIB Error:%s\n\tFibRgW97 (%u values) runs past the end of the `WordDocument` stream.\n",
+            red, white, csw)
+        cslw = WordDocument.get<ut_WORD> (count_offset);
+        rgLw_offset = count_offset + sizeof(ut_WORD);
+
+        count_offset = rgLw_offset + (ut_LSIZE) cslw * sizeof(ut_DWORD);
+        dot_doc_assert(count_offset + sizeof(ut_WORD) <= WordDocument.get_size(),
+            "\n%sFIB Error:%s\n\tFibRgLw97 (%u values) runs past the end of the `WordDocument` stream.\n",
+            red, white, cslw)
+        cbRgFcLcb = WordDocument.get<ut_WORD> (count_offset);
+        rgFcLcb_offset = count_offset + sizeof(ut_WORD);
+
+        count_offset = rgFcLcb_offset + (ut_LSIZE) cbRgFcLcb * 2 * sizeof(ut_DWORD);
+        dot_doc_assert(count_offset + sizeof(ut_WORD) <= WordDocument.get_size(),
+            "\n%sFIB Error:%s\n\tFibRgFcLcb (%u fc/lcb pairs) runs past the end of the `WordDocument` stream.\n",
+            red, white, cbRgFcLcb)
+        cswNew = WordDocument.get<ut_WORD> (count_offset);
+        rgCswNew_offset = count_offset + sizeof(ut_WORD);
+
+        ut_LSIZE FIB_size = rgCswNew_offset + (ut_LSIZE) cswNew * sizeof(ut_WORD);
+        dot_doc_assert(FIB_size <= WordDocument.get_size(),
+            "\n%sFIB Error:%s\n\tFibRgCswNew (%u values) runs past the end of the `WordDocument` stream.\n",
+            red, white, cswNew)
+
+        /* Keep a view of the whole FIB; copied only if it straddles two extents, or views do not last (the sector cache). */
+        bool needs_copy = !WordDocument.is_contiguous(0, FIB_size) || !WordDocument.has_stable_views();
+        if(needs_copy && FIB_copy_capacity < FIB_size)
+        {
+            FIB_copy = WordDocument.get_fapi()->get_arena().allocate<ut_BYTE> (FIB_size);
+            FIB_copy_capacity = FIB_size;
+        }
+
+        FIB = WordDocument.view(0, FIB_size, needs_copy ? FIB_copy : nullptr);
+    }
+
+    const struct _dot_doc_FIB_base& get_FIB_base()
+    { return FIB_base; }
+
+    /* The file format version; `nFibNew` (the first value of FibRgCswNew) when there is one, otherwise FibBase's `nFib`. */
+    ut_WORD get_nFib()
+    { return cswNew > 0 ? FIB.get<ut_WORD> (rgCswNew_offset) : FIB_base.FIB_nFib; }
+
+    bool is_complex()
+    { return FIB_base.FIB_flags & WDBF_FIB_fComplex; }
+
+    bool is_encrypted()
+    { return FIB_base.FIB_flags & WDBF_FIB_fEncrypted; }
+
+    bool is_obfuscated()
+    { return FIB_base.FIB_flags & WDBF_FIB_fObfuscated; }
+
+    /* fWhichTblStm; 1 when the table stream is `1Table`, 0 for `0Table`. */
+    ut_BYTE get_which_table_stream()
+    { return FIB_base.FIB_flags & WDBF_FIB_fWhichTblStm ? 1 : 0; }
+
+    /* Name of the table stream, for `DotDoc_File::open_stream`. */
+    const nt_BYTE *get_table_stream_name()
+    { return get_which_table_stream() ? "1Table" : "0Table"; }
+
+    /* FibRgW97 value `index`; 0 when the FIB has fewer values. */
+    ut_WORD get_rgW(ut_WORD index)
+    { return index < csw ? FIB.get<ut_WORD> (rgW_offset + index * sizeof(ut_WORD)) : 0; }
+
+    /* FibRgLw97 value; 0 when the FIB has fewer values. */
+    ut_DWORD get_rgLw(fib_lw field)
+    {
+        ut_WORD index = (ut_WORD) field;
+        return index < cslw ? FIB.get<ut_DWORD> (rgLw_offset + index * sizeof(ut_DWORD)) : 0;
+    }
+
+    /* `fc` (stream offset, in the table stream unless noted otherwise) of fc/lcb pair `field`; 0 when the FIB has fewer pairs. */
+    ut_DWORD get_fc(fib_fc_lcb field)
+    {
+        ut_WORD index = (ut_WORD) field;
+        return index < cbRgFcLcb ? FIB.get<ut_DWORD> (rgFcLcb_offset + index * 2 * sizeof(ut_DWORD)) : 0;
+    }
+
+    /* `lcb` (size in bytes) of fc/lcb pair `field`; 0 when the FIB has fewer pairs, meaning the structure is absent. */
+    ut_DWORD get_lcb(fib_fc_lcb field)
+    {
+        ut_WORD index = (ut_WORD) field;
+        return index < cbRgFcLcb ? FIB.get<ut_DWORD> (rgFcLcb_offset + index * 2 * sizeof(ut_DWORD) + sizeof(ut_DWORD)) : 0;
+    }
+
+    ut_WORD get_fc_lcb_count()
+    { return cbRgFcLcb; }
+
+    ut_LSIZE get_FIB_size()
+    { return FIB.size; }
+};
+
+#endif
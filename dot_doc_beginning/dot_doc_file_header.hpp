@@ -5,6 +5,15 @@
 #define WDBF_header_sig_length      0x08
 #define WDBF_PL_header_sig          0x10 // PL - Padding Length; 16 bytes of padding following 8-byte header signature
 #define WDBF_RPL_header_sig         0x06 // RPL - Reserved Padding Length; 6 bytes of padding following Mini Stream sector size 
+#define WDBF_header_DIFAT_entries   0x6D // 109 DIFAT entries follow the 76-byte fixed header
+#define WDBF_header_block_size      0x200 // 76-byte fixed header + 109 * 4-byte DIFAT entries = one 512-byte block
+
+/* Special sector numbers. */
+#define CFB_MAXREGSECT              0xFFFFFFFA // Largest regular sector number
+#define CFB_DIFSECT                 0xFFFFFFFC // Sector is a DIFAT sector
+#define CFB_FATSECT                 0xFFFFFFFD // Sector is a FAT sector
+#define CFB_ENDOFCHAIN              0xFFFFFFFE // Last sector of a chain
+#define CFB_FREESECT                0xFFFFFFFF // Unallocated sector
 
 /* Word Document Binary file heading structure. */
 struct _dot_doc_header : public PD_WDBF_values
@@ -31,32 +40,70 @@ public:
     ut_DWORD        CFB_number_of_minifat_sectors;  
     ut_DWORD        CFB_first_DIFAT_sector_loc;
     ut_DWORD        CFB_number_of_DIFAT_sectors;
+    ut_DWORD        CFB_header_DIFAT[WDBF_header_DIFAT_entries]; // First 109 FAT sector locations
 
+    /* Every FAT sector location; the 109 in the header followed by those in the DIFAT sector chain.
+     * In the arena of the `FileAPI` they were read from; `FAT_sector_capacity` is how many fit before gathering again
+     * needs more of it.
+     * */
     ut_DWORD        *FAT_sector_locations;
+    ut_DWORD        FAT_sector_capacity;
+
+    ut_LSIZE get_sector_size() const
+    { return 1ULL << CFB_sector_size; }
+
+    /* Sector `n` starts right after the header sector, which is as big as any other sector (512 or 4096 bytes). */
+    ut_LSIZE get_sector_offset(ut_DWORD sector) const
+    { return ((ut_LSIZE) sector + 1) << CFB_sector_size; }
+
+    /* Number of (possibly partial) sectors in a file of `file_size` bytes, not counting the header sector. */
+    ut_DWORD get_sector_count(ut_LSIZE file_size) const
+    {
+        if(file_size <= get_sector_size()) return 0;
+        return (file_size - get_sector_size() + get_sector_size() - 1) >> CFB_sector_size;
+    }
+
     void allocate_FAT_sector_locations_memory(FileAPI& fapi)
     {
+        ut_LSIZE sector_size = get_sector_size();
+        ut_DWORD sector_count = get_sector_count(fapi.get_size());
 
-        /* If `CFB_major_version` is `03 00`, `FAT_sector_locations` will have a size of 436 (0x1B4) bytes.
-         * Otherwise, if it is `04 00`, `FAT_sector_locations` will have a size of 3,584 (0xE00) bytes.
+        dot_doc_assert(CFB_number_of_FAT_sectors <= sector_count,
+            "\n%sFAT Error:%s\n\tThe header claims %u FAT sectors, but the WDBF only has %u sectors.\n",
+            red, white,
+            CFB_number_of_FAT_sectors, sector_count)
+
+        if(!FAT_sector_locations || FAT_sector_capacity < CFB_number_of_FAT_sectors)
+        {
+            FAT_sector_locations = fapi.get_arena().allocate<ut_DWORD> (CFB_number_of_FAT_sectors);
+            FAT_sector_capacity = CFB_number_of_FAT_sectors;
+        }
+
+        /* The first 109 locations are in the header. */
+        ut_DWORD found = 0;
+        for(; found < CFB_number_of_FAT_sectors && found < WDBF_header_DIFAT_entries; found++)
+            FAT_sector_locations[found] = CFB_header_DIFAT[found];
+
+        /* The rest are in the DIFAT sector chain. Each DIFAT sector holds `sector_size / 4 - 1` locations;
+         * the last 4 bytes of the sector are the location of the next DIFAT sector.
          * */
-        if(CFB_major_version == mv3)
+        ut_DWORD DIFAT_sector = CFB_first_DIFAT_sector_loc;
+        ut_DWORD DIFAT_entries = sector_size / sizeof(ut_DWORD) - 1;
+
+        for(ut_DWORD DIFAT_sectors_read = 0; found < CFB_number_of_FAT_sectors; DIFAT_sectors_read++)
         {
-            std::cout << "Major Version 3." << std::endl;
-            
-            /* Perform some checks. */
-            if(CFB_number_of_dir_sectors != 0)
-            {
-                CFB_number_of_dir_sectors = 0;
-                fapi.rewrite_specific <ut_DWORD> (data_locations::WDBF_NOD, CFB_number_of_dir_sectors);
-            }
+            dot_doc_assert(DIFAT_sectors_read < CFB_number_of_DIFAT_sectors && DIFAT_sector < sector_count,
+                "\n%sFAT Error:%s\n\tThe DIFAT chain ended after %u sector(s) (next sector `0x%X`); only %u of %u FAT sector locations were found.\n",
+                red, white,
+                DIFAT_sectors_read, DIFAT_sector, found, CFB_number_of_FAT_sectors)
 
-            //if()
-            return;
-        }
+            FBWW_span DIFAT{fapi.FBWW_view(get_sector_offset(DIFAT_sector), sector_size), sector_size};
 
-        std::cout << "Major Version 4." << std::endl;
-        printf("%X, %X\n", CFB_major_version, mv4);
-        return;
+            for(ut_DWORD i = 0; i < DIFAT_entries && found < CFB_number_of_FAT_sectors; i++)
+                FAT_sector_locations[found++] = DIFAT.get<ut_DWORD> (i * sizeof(ut_DWORD));
+
+            DIFAT_sector = DIFAT.get<ut_DWORD> (DIFAT_entries * sizeof(ut_DWORD));
+        }
     }
 
     _dot_doc_header()
@@ -66,24 +113,53 @@ public:
         /* Set all elements to one to make sure the padding in the WDBF is represented by zeroes. */
         memset(padding, 1, WDBF_PL_header_sig);
 
-        CFB_minor_version = CFB_major_version = CFB_byte_order_indication = CFB_sector_size = 0;
+        CFB_minor_version = CFB_major_version = CFB_byte_order_indication = CFB_sector_size = CFB_mini_sector_size = 0;
+        CFB_number_of_dir_sectors = CFB_number_of_FAT_sectors = CFB_first_dir_sector_loc = CFB_transaction_sig_number = 0;
+        CFB_mini_stream_cutoff_size = CFB_first_minifat_sector_loc = CFB_number_of_minifat_sectors = 0;
+        CFB_first_DIFAT_sector_loc = CFB_number_of_DIFAT_sectors = 0;
+        memset(CFB_header_DIFAT, 0xFF, sizeof(CFB_header_DIFAT));
         FAT_sector_locations = nullptr;
+        FAT_sector_capacity = 0;
     }
+};
 
-    ~_dot_doc_header()
-    {
-        if(FAT_sector_locations) delete FAT_sector_locations;
-
-        FAT_sector_locations = nullptr;
-    }
+/* What `DotDoc_Header::probe_WDBF_heading` makes of a file from its header block alone.
+ *      WDBF_valid      - The header is well-formed.
+ *      WDBF_repairable - The header has flaws, all of which can be repaired (`main.o --repair`).
+ *      WDBF_damaged    - A compound file, but the header can not be repaired or does not fit the size of the file; it will not decode.
+ *      WDBF_not_CFB    - Not a compound file at all; shorter than the header, or most of the signature is missing.
+ * */
+enum class WDBF_probe_verdict : ut_BYTE
+{
+    WDBF_valid      = 0x0,
+    WDBF_repairable = 0x1,
+    WDBF_damaged    = 0x2,
+    WDBF_not_CFB    = 0x3
 };
 
+inline const nt_BYTE *get_probe_verdict_name(WDBF_probe_verdict verdict)
+{
+    static const nt_BYTE *names[] = {"valid", "repairable", "damaged", "not a compound file"};
+    return names[(ut_BYTE) verdict];
+}
+
 class DotDoc_Header : public PD_WDBF_values
 {
+    /* `DotDoc_Sidecar` fills in the repaired heading and the flaws from a sidecar index, in place of parsing. */
+    friend class DotDoc_Sidecar;
+
 private:
     
     FileAPI *fapi = nullptr;
     struct _dot_doc_header *WDBF_header = nullptr;
+    error_log *err_log = nullptr;
+    bool quiet = false;
+
+    /* Predetermined 2-byte values, in `PD_WDBF_values`, are stored as the bytes appear in the file.
+     * PDV - Predetermined Value; returns the value those bytes represent.
+     * */
+    ut_WORD PDV(const ut_BYTE (&bytes)[2])
+    { return merge_bytes<ut_WORD, ut_BYTE> (bytes[1], bytes[0]); }
 
     /* DIT - Data Input Type.
      *      DIT will be WDBF_PD1 for the 16-bytes of padding after 8-byte header signature.
@@ -94,11 +170,11 @@ private:
         switch(DIT)
         {
             case data_locations::WDBF_PD1: {
-                memcpy(&WDBF_header->padding, fapi->FBWW_read_in<ut_BYTE> (WDBF_PL_header_sig), WDBF_PL_header_sig);
+                memcpy(&WDBF_header->padding, fapi->read_bytes(WDBF_PL_header_sig).data, WDBF_PL_header_sig);
                 return;
             }
             case data_locations::WDBF_PD2: {
-                memcpy(&WDBF_header->reserved, fapi->FBWW_read_in<ut_BYTE> (WDBF_RPL_header_sig), WDBF_RPL_header_sig);
+                memcpy(&WDBF_header->reserved, fapi->read_bytes(WDBF_RPL_header_sig).data, WDBF_RPL_header_sig);
                 return;
             }
             default: break;
@@ -107,25 +183,18 @@ private:
 
     void get_WDBF_heading_sig()
     {
-        memcpy(&WDBF_header->header_sig, fapi->FBWW_read_in<ut_BYTE> (WDBF_header_sig_length), WDBF_header_sig_length);
+        memcpy(&WDBF_header->header_sig, fapi->read_bytes(WDBF_header_sig_length).data, WDBF_header_sig_length);
         
         /* Make sure all 8 bytes are correct for the header signature. */
         for(ut_BYTE i = 0; i < WDBF_header_sig_length; i++)
         {
             if(WDBF_header->header_sig[i] != dot_doc_header_sig[i])
             {
-                if(!err_tracker->is_same_error(invalid_doc_file_header_sig))
-                    dot_doc_raise_exception(invalid_doc_file_header_sig, true,
-                        "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tAt index %d of the 8-byte header signature, the value encountered was \e[0;31m`0x%X`\e[0;37m when the program was expecting \e[0;33m`0x%X`\e[0;37m.\n",
-                        i + 1, WDBF_header->header_sig[i], dot_doc_header_sig[i])
-                else
-                    dot_doc_raise_exception(invalid_doc_file_header_sig, true,
-                        "\t\e[0;33m[WordDocument Binary Flaw]\e[0;37m\tException #%d: Value encountered at index %d was \e[0;31m`0x%X`\e[0;37m, expected \e[0;33m`0x%X`\e[0;37m.\n",
-                            err_tracker->get_same_error_count() + 1,
-                            i + 1, WDBF_header->header_sig[i], dot_doc_header_sig[i])
+                dot_doc_record_flaw(invalid_doc_file_header_sig, true,
+                    (ut_LSIZE) data_locations::WDBF_HS + i, WDBF_header->header_sig[i], dot_doc_header_sig[i])
 
                 WDBF_header->header_sig[i] = dot_doc_header_sig[i];
-                fapi->rewrite<ut_BYTE> (WDBF_header->header_sig[i]);
+                fapi->rewrite_at<ut_BYTE> ((ut_LSIZE) data_locations::WDBF_HS + i, WDBF_header->header_sig[i]);
             }
         }
 
@@ -137,131 +206,90 @@ private:
         {
             if(WDBF_header->padding[i] != 0)
             {
-                if(!err_tracker->is_same_error(invalid_doc_file_padding))
-                    dot_doc_raise_exception(invalid_doc_file_padding, true,
-                        "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tAt index %d of the 16 bytes of padding the value found was \e[0;31m`0x%X`\e[0;37m, when it is expected to be `0x00`.\n",
-                        i + 1, WDBF_header->padding[i])
-                else
-                    dot_doc_raise_exception(invalid_doc_file_padding, true,
-                        "\t\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tException #%d: Value encountered at index %d was \e[0;31m`0x%X`\e[0;37m, expected `0x00`.\n",
-                        err_tracker->get_same_error_count() + 1,
-                        i + 1, WDBF_header->padding[i])
+                dot_doc_record_flaw(invalid_doc_file_padding, true,
+                    (ut_LSIZE) data_locations::WDBF_PD1 + i, WDBF_header->padding[i], 0x00)
 
                 WDBF_header->padding[i] = 0x0;
-                fapi->rewrite<ut_BYTE> (WDBF_header->padding[i]);
+                fapi->rewrite_at<ut_BYTE> ((ut_LSIZE) data_locations::WDBF_PD1 + i, WDBF_header->padding[i]);
             }
         }
     }
 
     void get_WDBF_minor_and_major_version()
     {
-        WDBF_header->CFB_minor_version = convert_endian<ut_WORD> (merge_bytes<ut_WORD, ut_BYTE> (fapi->FBWW_read_in<ut_BYTE> (1)[0], fapi->FBWW_read_in<ut_BYTE> (1)[0]));
+        WDBF_header->CFB_minor_version = fapi->read_u16();
 
         /* Make sure the minor version matches. */
-        if(((WDBF_header->CFB_minor_version >> 8) & 0xFF) != dot_doc_req_minor_v[0] ||
-           (WDBF_header->CFB_minor_version & 0xFF) != dot_doc_req_minor_v[1])
+        if(WDBF_header->CFB_minor_version != PDV(dot_doc_req_minor_v))
         {
-            dot_doc_raise_exception(invalid_CFB_minor_version, true,
-                "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe minor version was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0x3E00`\e[0;37m.\n",
-                WDBF_header->CFB_minor_version)
+            dot_doc_record_flaw(invalid_CFB_minor_version, true,
+                data_locations::WDBF_MV, WDBF_header->CFB_minor_version, PDV(dot_doc_req_minor_v))
 
-            WDBF_header->CFB_minor_version ^= WDBF_header->CFB_minor_version;
-            WDBF_header->CFB_minor_version |= convert_endian<ut_WORD> (merge_bytes<ut_WORD, ut_BYTE> (dot_doc_req_minor_v[0], dot_doc_req_minor_v[1]));
+            WDBF_header->CFB_minor_version = PDV(dot_doc_req_minor_v);
             fapi->rewrite<ut_WORD> (WDBF_header->CFB_minor_version);
         }
 
-        WDBF_header->CFB_major_version = convert_endian<ut_WORD> (merge_bytes<ut_WORD, ut_BYTE> (fapi->FBWW_read_in<ut_BYTE> (1)[0], fapi->FBWW_read_in<ut_BYTE> (1)[0]));
+        WDBF_header->CFB_major_version = fapi->read_u16();
 
         /* Make sure the major version is valid. */
-        if((((WDBF_header->CFB_major_version >> 8) & 0xFF) != dot_doc_majr_vers_3[0] ||
-           (WDBF_header->CFB_major_version & 0xFF) != dot_doc_majr_vers_3[1]) && 
-           (((WDBF_header->CFB_major_version >> 8) & 0xFF) != dot_doc_majr_vers_4[0] ||
-           (WDBF_header->CFB_major_version & 0xFF) != dot_doc_majr_vers_4[1]))
+        if(WDBF_header->CFB_major_version != WDBF_header->mv3 && WDBF_header->CFB_major_version != WDBF_header->mv4)
         {
-            dot_doc_raise_exception(invalid_CFB_major_version, true,
-                "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe major version was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0x0300`\e[0;37m or \e[0;33m`0x0400`\e[0;37m.\n",
-                WDBF_header->CFB_major_version)
+            dot_doc_record_flaw(invalid_CFB_major_version, true,
+                data_locations::WDBF_MJV, WDBF_header->CFB_major_version, WDBF_header->mv3)
 
-            WDBF_header->CFB_major_version ^= WDBF_header->CFB_major_version;
-            WDBF_header->CFB_major_version |= convert_endian<ut_WORD> (merge_bytes<ut_WORD, ut_BYTE> (dot_doc_majr_vers_3[0], dot_doc_majr_vers_3[1]));
+            WDBF_header->CFB_major_version = WDBF_header->mv3;
             fapi->rewrite<ut_WORD> (WDBF_header->CFB_major_version);
         }
     }
 
     void get_WDBF_byte_order()
     {
-        WDBF_header->CFB_byte_order_indication = convert_endian<ut_WORD> (merge_bytes<ut_WORD, ut_BYTE> (fapi->FBWW_read_in<ut_BYTE> (1)[0], fapi->FBWW_read_in<ut_BYTE> (1)[0]));
+        WDBF_header->CFB_byte_order_indication = fapi->read_u16();
 
-        if(((WDBF_header->CFB_byte_order_indication >> 8) & 0xFF) != dot_doc_byte_order[0] ||
-           (WDBF_header->CFB_byte_order_indication & 0xFF) != dot_doc_byte_order[1])
+        if(WDBF_header->CFB_byte_order_indication != PDV(dot_doc_byte_order))
         {
-            dot_doc_raise_exception(invalid_CFB_little_endian_indication, true,
-                "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe byte order indication was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0xFEFF`\e[0;37m.\n",
-                WDBF_header->CFB_minor_version)
+            dot_doc_record_flaw(invalid_CFB_little_endian_indication, true,
+                data_locations::WDBF_BO, WDBF_header->CFB_byte_order_indication, PDV(dot_doc_byte_order))
 
-            WDBF_header->CFB_byte_order_indication ^= WDBF_header->CFB_byte_order_indication;
-            WDBF_header->CFB_byte_order_indication |= merge_bytes<ut_WORD, ut_BYTE> (dot_doc_byte_order[0], dot_doc_byte_order[1]);
+            WDBF_header->CFB_byte_order_indication = PDV(dot_doc_byte_order);
             fapi->rewrite<ut_WORD> (WDBF_header->CFB_byte_order_indication);
         }
     }
 
-    /* TODO: Is there a way to do the following without much repitition in the code being performed? */
     void get_WDBF_sector_size()
     {
-        WDBF_header->CFB_sector_size = merge_bytes<ut_WORD, ut_BYTE> (fapi->FBWW_read_in<ut_BYTE> (1)[0], fapi->FBWW_read_in<ut_BYTE> (1)[0]);
+        WDBF_header->CFB_sector_size = fapi->read_u16();
         
         /* Depending on the major version, test if the value is correct.
-         * Major Version 3 = 09 00 in binary.
-         * Major Version 4 = 0C 00 in binary.
+         * Major Version 3 = 09 00 in binary (512-byte sectors).
+         * Major Version 4 = 0C 00 in binary (4096-byte sectors).
          * */
-        if(WDBF_header->CFB_major_version == WDBF_header->mv3)
-        {
-            /* `CFB_sector_size` should only represent one byte. */
-            if((WDBF_header->CFB_sector_size & 0xFF) != dot_doc_MV3_SS[0])
-            {
-                dot_doc_raise_exception(invalid_CFB_sector_size_indication, true,
-                    "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe sector size indication was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0x%X`\e[0;37m.\n\t\t\t\tThe Major Version is \e[0;33m`0x%X` (%s)\e[0;37m, which requires sector size of 512 bytes.\n",
-                        WDBF_header->CFB_sector_size, merge_bytes<ut_WORD, ut_BYTE> (dot_doc_MV3_SS[1], dot_doc_MV3_SS[0]), WDBF_header->CFB_major_version,
-                        "Major Version 3")
-                
-                WDBF_header->CFB_sector_size ^= WDBF_header->CFB_sector_size;
-                WDBF_header->CFB_sector_size |= merge_bytes<ut_WORD, ut_BYTE> (dot_doc_MV3_SS[1], dot_doc_MV3_SS[0]);
-                fapi->rewrite<ut_WORD> (WDBF_header->CFB_sector_size);
-            }
-            return;
-        }
+        bool is_mv3 = WDBF_header->CFB_major_version == WDBF_header->mv3;
+        ut_WORD expected_sector_size = is_mv3 ? PDV(dot_doc_MV3_SS) : PDV(dot_doc_MV4_SS);
 
-        /* `CFB_sector_size` should only represent one byte. */
-        if((WDBF_header->CFB_sector_size & 0xFF) != dot_doc_MV4_SS[0])
+        if(WDBF_header->CFB_sector_size != expected_sector_size)
         {
-            dot_doc_raise_exception(invalid_CFB_sector_size_indication, true,
-                "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe sector size indication was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0x%X`\e[0;37m.\n\t\t\t\tThe Major Version is \e[0;33m`0x%X` (%s)\e[0;37m, which requires sector size of 512 bytes.\n",
-                    WDBF_header->CFB_sector_size, merge_bytes<ut_WORD, ut_BYTE> (dot_doc_MV3_SS[1], dot_doc_MV4_SS[0]), WDBF_header->CFB_major_version,
-                    "Major Version 4")
+            dot_doc_record_flaw(invalid_CFB_sector_size_indication, true,
+                data_locations::WDBF_SS, WDBF_header->CFB_sector_size, expected_sector_size)
             
-            WDBF_header->CFB_sector_size ^= WDBF_header->CFB_sector_size;
-            WDBF_header->CFB_sector_size |= merge_bytes<ut_WORD, ut_BYTE> (dot_doc_MV4_SS[1], dot_doc_MV4_SS[0]);
+            WDBF_header->CFB_sector_size = expected_sector_size;
             fapi->rewrite<ut_WORD> (WDBF_header->CFB_sector_size);
         }
-
-        return;
     }
 
     void get_WDBF_mini_stream_size()
     {
-        WDBF_header->CFB_mini_sector_size = merge_bytes<ut_WORD, ut_BYTE> (fapi->FBWW_read_in<ut_BYTE> (1)[0], fapi->FBWW_read_in<ut_BYTE> (1)[0]);
+        WDBF_header->CFB_mini_sector_size = fapi->read_u16();
 
         /* Make sure `CFB_mini_sector_size` is `06 00`.
          * The size of the Mini Stream should always be represented by `06 00` in the binary file.
          * */
-        if((WDBF_header->CFB_mini_sector_size & 0xFF) != dot_doc_MSS[0])
+        if(WDBF_header->CFB_mini_sector_size != PDV(dot_doc_MSS))
         {
-            dot_doc_raise_exception(invalid_CFB_mini_stream_sector_size, true,
-                "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe Mini Stream sector size was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0x0600`\e[0;37m.\n",
-                    WDBF_header->CFB_mini_sector_size)
+            dot_doc_record_flaw(invalid_CFB_mini_stream_sector_size, true,
+                data_locations::WDBF_MSS, WDBF_header->CFB_mini_sector_size, PDV(dot_doc_MSS))
             
-            WDBF_header->CFB_mini_sector_size ^= WDBF_header->CFB_mini_sector_size;
-            WDBF_header->CFB_mini_sector_size |= merge_bytes<ut_WORD, ut_BYTE> (dot_doc_MSS[1], dot_doc_MSS[0]);
+            WDBF_header->CFB_mini_sector_size = PDV(dot_doc_MSS);
             fapi->rewrite<ut_WORD> (WDBF_header->CFB_mini_sector_size);
         }
 
@@ -273,92 +301,188 @@ private:
         {
             if(WDBF_header->reserved[i] != 0)
             {
-                if(!err_tracker->is_same_error(invalid_doc_file_padding))
-                    dot_doc_raise_exception(invalid_doc_file_padding, true,
-                        "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tAt index %d of the 6 bytes of reserved padding the value found was \e[0;31m`0x%X`\e[0;37m, when it is expected to be `0x00`.\n",
-                        i + 1, WDBF_header->reserved[i])
-                else
-                    dot_doc_raise_exception(invalid_doc_file_padding, true,
-                        "\t\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tException #%d: Value encountered at index %d was \e[0;31m`0x%X`\e[0;37m, expected `0x00`.\n",
-                        err_tracker->get_same_error_count() + 1,
-                        i + 1, WDBF_header->reserved[i])
+                dot_doc_record_flaw(invalid_doc_file_padding, true,
+                    (ut_LSIZE) data_locations::WDBF_PD2 + i, WDBF_header->reserved[i], 0x00)
 
                 WDBF_header->reserved[i] = 0x0;
-                fapi->rewrite<ut_BYTE> (WDBF_header->reserved[i]);
+                fapi->rewrite_at<ut_BYTE> ((ut_LSIZE) data_locations::WDBF_PD2 + i, WDBF_header->reserved[i]);
             }
         }
     }
 
     void get_WDBF_number_of_DIR_sectors()
     {
-        WDBF_header->CFB_number_of_dir_sectors = merge_bytes<ut_DWORD, ut_WORD> (fapi->FBWW_read_in<ut_WORD> (1)[0], fapi->FBWW_read_in<ut_WORD> (1)[0]);
+        WDBF_header->CFB_number_of_dir_sectors = fapi->read_u32();
 
         /* If `CFB_major_version` represents Major Version 3, this value must be zero. */
         if(WDBF_header->CFB_major_version == WDBF_header->mv3 && WDBF_header->CFB_number_of_dir_sectors != 0)
         {
-            dot_doc_raise_exception(invalid_CFB_dir_sector_count, true,
-                "\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe number of Directory sectors was found to be \e[0;31m`0x%X`\e[0;37m, when it is expected to be \e[0;33m`0x00`\e[0;37m.\n\t\t\t\tWith the WDBF using Major Version 3, this value must be zero.\n",
-                    WDBF_header->CFB_number_of_dir_sectors)
+            dot_doc_record_flaw(invalid_CFB_dir_sector_count, true,
+                data_locations::WDBF_NOD, WDBF_header->CFB_number_of_dir_sectors, 0x00)
             
-            WDBF_header->CFB_number_of_dir_sectors ^= WDBF_header->CFB_number_of_dir_sectors;
+            WDBF_header->CFB_number_of_dir_sectors = 0;
             fapi->rewrite<ut_DWORD> (WDBF_header->CFB_number_of_dir_sectors);
         }
     }
 
     void get_WDBF_number_of_FAT_sectors()
+    { WDBF_header->CFB_number_of_FAT_sectors = fapi->read_u32(); }
+
+    void get_WDBF_first_directory_sector_location()
+    { WDBF_header->CFB_first_dir_sector_loc = fapi->read_u32(); }
+
+    void get_WDBF_transaction_sig_number()
+    { WDBF_header->CFB_transaction_sig_number = fapi->read_u32(); }
+
+    void get_WDBF_mini_stream_cutoff_size()
+    { WDBF_header->CFB_mini_stream_cutoff_size = fapi->read_u32(); }
+
+    void get_WDBF_first_minifat_sector_loc()
     {
-        WDBF_header->CFB_number_of_FAT_sectors = merge_bytes<ut_DWORD, ut_WORD> (fapi->FBWW_read_in<ut_WORD> (1)[0], fapi->FBWW_read_in<ut_WORD> (1)[0]);
+        WDBF_header->CFB_first_minifat_sector_loc = fapi->read_u32();
+        WDBF_header->CFB_number_of_minifat_sectors = fapi->read_u32();
     }
 
-    void get_WDBF_first_directory_sector_location()
+    void get_WDBF_DIFAT_info()
     {
-        ut_BYTE i = 1;
-        ut_BYTE byte_read = fapi->FBWW_read_in<ut_BYTE> (1)[0];
-        WDBF_header->CFB_first_dir_sector_loc |= byte_read;
+        WDBF_header->CFB_first_DIFAT_sector_loc = fapi->read_u32();
+        WDBF_header->CFB_number_of_DIFAT_sectors = fapi->read_u32();
+    }
 
-        while(i < sizeof(ut_DWORD))
-        {
-            byte_read = fapi->FBWW_read_in<ut_BYTE> (1)[0];
-            WDBF_header->CFB_first_dir_sector_loc = (WDBF_header->CFB_first_dir_sector_loc << 8) | byte_read;
+    void get_WDBF_header_DIFAT()
+    {
+        FBWW_span header_DIFAT = fapi->read_bytes(WDBF_header_DIFAT_entries * sizeof(ut_DWORD));
 
-            i++;
-        }
-        WDBF_header->CFB_first_dir_sector_loc = convert_endian<ut_DWORD> (WDBF_header->CFB_first_dir_sector_loc);
+        for(ut_BYTE i = 0; i < WDBF_header_DIFAT_entries; i++)
+            WDBF_header->CFB_header_DIFAT[i] = header_DIFAT.get<ut_DWORD> (i * sizeof(ut_DWORD));
     }
 
-    void get_WDBF_transaction_sig_number()
+    /* Predetermined values packed the way they appear in the header, so the fast path can compare
+     * 8 bytes at a time.
+     *      PDV_mv3_block/PDV_mv4_block - bytes 0x18-0x1F; minor version, major version, byte order and sector size.
+     *      PDV_mini_block - bytes 0x20-0x27; Mini Stream sector size followed by the 6 bytes of reserved padding.
+     * */
+    ut_LSIZE PDV_block(const ut_BYTE (&w1)[2], const ut_BYTE (&w2)[2], const ut_BYTE (&w3)[2], const ut_BYTE (&w4)[2])
     {
-        WDBF_header->CFB_transaction_sig_number = fapi->FBWW_read_in<ut_DWORD> (1)[0];
+        ut_BYTE block[8] = {w1[0], w1[1], w2[0], w2[1], w3[0], w3[1], w4[0], w4[1]};
+        return load_le<ut_LSIZE> (block);
     }
 
-    void get_WDBF_mini_stream_cutoff_size()
+    const ut_LSIZE PDV_sig_block = load_le<ut_LSIZE> (dot_doc_header_sig);
+    const ut_LSIZE PDV_mv3_block = PDV_block(dot_doc_req_minor_v, dot_doc_majr_vers_3, dot_doc_byte_order, dot_doc_MV3_SS);
+    const ut_LSIZE PDV_mv4_block = PDV_block(dot_doc_req_minor_v, dot_doc_majr_vers_4, dot_doc_byte_order, dot_doc_MV4_SS);
+    const ut_LSIZE PDV_mini_block = PDV(dot_doc_MSS);
+
+    /* Fast path for a well-formed header.
+     * Loads the whole 512-byte header block (fixed header + header DIFAT) in one go and checks the signature, padding, versions,
+     * byte order, sector sizes and reserved padding with six 64-bit compares. Only if this succeeds are the fields filled in;
+     * otherwise nothing is touched and `parse_WDBF_heading` takes the per-field path, which produces the detailed diagnostics
+     * and performs the repairs.
+     * */
+    bool quick_check_WDBF_heading()
     {
-        ut_BYTE i = 1;
-        ut_BYTE byte_read = fapi->FBWW_read_in<ut_BYTE> (1)[0];
-        WDBF_header->CFB_mini_stream_cutoff_size |= byte_read;
+        if(fapi->get_size() < WDBF_header_block_size)
+            return false;
 
-        while(i < sizeof(ut_DWORD))
-        {
-            byte_read = fapi->FBWW_read_in<ut_BYTE> (1)[0];
-            WDBF_header->CFB_mini_stream_cutoff_size = (WDBF_header->CFB_mini_stream_cutoff_size << 8) | byte_read;
+        FBWW_span heading = fapi->read_bytes(WDBF_header_block_size);
+        ut_LSIZE version_block = heading.get<ut_LSIZE> ((ut_LSIZE) data_locations::WDBF_MV);
+
+        bool valid = heading.get<ut_LSIZE> ((ut_LSIZE) data_locations::WDBF_HS) == PDV_sig_block;
+        valid &= (heading.get<ut_LSIZE> ((ut_LSIZE) data_locations::WDBF_PD1) | heading.get<ut_LSIZE> ((ut_LSIZE) data_locations::WDBF_PD1 + 8)) == 0;
+        valid &= version_block == PDV_mv3_block || version_block == PDV_mv4_block;
+        valid &= heading.get<ut_LSIZE> ((ut_LSIZE) data_locations::WDBF_MSS) == PDV_mini_block;
+
+        /* Major Version 3 requires the number of Directory sectors to be zero. */
+        if(version_block == PDV_mv3_block)
+            valid &= heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NOD) == 0;
 
-            i++;
+        if(!valid)
+        {
+            fapi->FBWW_seek((ut_LSIZE) data_locations::WDBF_HS);
+            return false;
         }
-        WDBF_header->CFB_mini_stream_cutoff_size = convert_endian<ut_DWORD> (WDBF_header->CFB_mini_stream_cutoff_size);
+
+        memcpy(WDBF_header->header_sig, heading.data + (ut_LSIZE) data_locations::WDBF_HS, WDBF_header_sig_length);
+        memset(WDBF_header->padding, 0, WDBF_PL_header_sig);
+        memset(WDBF_header->reserved, 0, WDBF_RPL_header_sig);
+
+        WDBF_header->CFB_minor_version              = heading.get<ut_WORD> ((ut_LSIZE) data_locations::WDBF_MV);
+        WDBF_header->CFB_major_version              = heading.get<ut_WORD> ((ut_LSIZE) data_locations::WDBF_MJV);
+        WDBF_header->CFB_byte_order_indication      = heading.get<ut_WORD> ((ut_LSIZE) data_locations::WDBF_BO);
+        WDBF_header->CFB_sector_size                = heading.get<ut_WORD> ((ut_LSIZE) data_locations::WDBF_SS);
+        WDBF_header->CFB_mini_sector_size           = heading.get<ut_WORD> ((ut_LSIZE) data_locations::WDBF_MSS);
+        WDBF_header->CFB_number_of_dir_sectors      = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NOD);
+        WDBF_header->CFB_number_of_FAT_sectors      = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NOFS);
+        WDBF_header->CFB_first_dir_sector_loc       = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FDSL);
+        WDBF_header->CFB_transaction_sig_number     = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_TSN);
+        WDBF_header->CFB_mini_stream_cutoff_size    = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_MSCS);
+        WDBF_header->CFB_first_minifat_sector_loc   = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FMFSL);
+        WDBF_header->CFB_number_of_minifat_sectors  = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NOMFS);
+        WDBF_header->CFB_first_DIFAT_sector_loc     = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FDFSL);
+        WDBF_header->CFB_number_of_DIFAT_sectors    = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NODFS);
+
+        if constexpr(std::endian::native == std::endian::little)
+            memcpy(WDBF_header->CFB_header_DIFAT, heading.data + (ut_LSIZE) data_locations::WDBF_FSL, sizeof(WDBF_header->CFB_header_DIFAT));
+        else
+            for(ut_BYTE i = 0; i < WDBF_header_DIFAT_entries; i++)
+                WDBF_header->CFB_header_DIFAT[i] = heading.get<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FSL + i * sizeof(ut_DWORD));
+
+        return true;
     }
 
-public:
-    DotDoc_Header(ut_BYTE *filename)
+    void start_session(FileAPI *file_API, bool quiet_session)
     {
-        fapi = new FileAPI(filename);
-        WDBF_header = new struct _dot_doc_header;
+        quiet = quiet_session;
+        fapi = file_API;
+        WDBF_header = fapi->get_arena().create<struct _dot_doc_header> ();
+        err_log = fapi->get_arena().create<error_log> ();
 
-        dot_doc_assert(fapi && WDBF_header, "\n%sMemory Allocation Error:%s\n\tThere was an error initializing memory for an internal variable.\n",
+        dot_doc_assert(fapi && WDBF_header && err_log, "\n%sMemory Allocation Error:%s\n\tThere was an error initializing memory for an internal variable.\n",
             red, white)
     }
 
-    void gather_WDBF_heading()
+public:
+    /* `quiet` keeps the instance from printing anything (flaws found in the WDBF and debug messages);
+     * the flaws are still counted, see `get_flaw_count`.
+     * `backend` and `cache_budget` are passed on to `FileAPI`; `FBWW_probe` for an instance that is only going to
+     * `probe_WDBF_heading`, `FBWW_cached` to decode in a fixed amount of memory.
+     * */
+    DotDoc_Header(ut_BYTE *filename, bool quiet_session = false, FileAPI_backend backend = FileAPI_backend::FBWW_mapped,
+                  ut_LSIZE cache_budget = FBWW_default_cache_budget)
+    { start_session(new FileAPI(filename, backend, cache_budget), quiet_session); }
+
+    /* The same, for a file opened (and possibly read) ahead of time by `DotDoc_AsyncIO`. */
+    DotDoc_Header(FBWW_preloaded& preloaded, bool quiet_session = false, FileAPI_backend backend = FileAPI_backend::FBWW_mapped,
+                  ut_LSIZE cache_budget = FBWW_default_cache_budget)
+    { start_session(new FileAPI(preloaded, backend, cache_budget), quiet_session); }
+
+    const struct _dot_doc_header *get_WDBF_header()
+    { return WDBF_header; }
+
+    FileAPI *get_fapi()
+    { return fapi; }
+
+    bool is_quiet()
+    { return quiet; }
+
+    /* Number of flaws found (and, if possible, repaired) in the WDBF. */
+    ut_DWORD get_flaw_count()
+    { return err_log->get_error_count(); }
+
+    /* The flaws themselves; formatted only when printed (`print_WDBF_flaws`) or reported. */
+    error_log *get_error_log()
+    { return err_log; }
+
+    /* Read, and check, every field of the 512-byte header block (76-byte fixed header followed by the first 109 DIFAT entries).
+     * A well-formed header is validated in one go by `quick_check_WDBF_heading`; the per-field getters only run when that fails.
+     * */
+    void parse_WDBF_heading()
     {
+        fapi->FBWW_seek((ut_LSIZE) data_locations::WDBF_HS);
+
+        if(quick_check_WDBF_heading())
+            return;
+
         get_WDBF_heading_sig();
         get_WDBF_minor_and_major_version();
         get_WDBF_byte_order();
@@ -370,7 +494,85 @@ public:
         get_WDBF_transaction_sig_number();
         get_WDBF_mini_stream_cutoff_size();
         get_WDBF_first_minifat_sector_loc();
+        get_WDBF_DIFAT_info();
+        get_WDBF_header_DIFAT();
+
+        /* Make sure all errors, if any, were fixed; show what was found before giving up. */
+        if constexpr(dot_doc_logs(dot_doc_log_level::flaws))
+            if(!err_log->all_errors_fixed() && !quiet)
+                print_WDBF_flaws();
+
+        dot_doc_assert(err_log->all_errors_fixed(), "\n\e[0;31m[WDBF INTERNAL ERROR]\e[0;37m\tThere is an error inside the WDBF that could not be fixed.\n")
+    }
+
+    /* Classify the file from the header block alone; every check of `parse_WDBF_heading` runs, plus whether the FAT (and the DIFAT
+     * chain that holds the FAT sector locations past the first 109) can fit in the file. Nothing past the first 512 bytes is read,
+     * so with a `FBWW_probe` instance this costs one `pread` however large the file is. Repairs are made in memory only, as always.
+     * */
+    WDBF_probe_verdict probe_WDBF_heading()
+    {
+        auto header_timer = fapi->get_stats().time(stats_phase::header);
+
+        if(fapi->get_loaded_size() < WDBF_header_block_size)
+            return WDBF_probe_verdict::WDBF_not_CFB;
 
+        /* A damaged signature gets repaired like any other field, but one that is mostly missing is not a damaged CFB. */
+        FBWW_span signature{fapi->FBWW_view((ut_LSIZE) data_locations::WDBF_HS, WDBF_header_sig_length), WDBF_header_sig_length};
+        ut_BYTE signature_matches = 0;
+
+        for(ut_BYTE i = 0; i < WDBF_header_sig_length; i++)
+            signature_matches += signature.data[i] == dot_doc_header_sig[i];
+
+        if(signature_matches < WDBF_header_sig_length / 2)
+            return WDBF_probe_verdict::WDBF_not_CFB;
+
+        try
+        {
+            parse_WDBF_heading();
+        }
+        catch(dot_doc_fatal_error& fatal_error)
+        {
+            return WDBF_probe_verdict::WDBF_damaged;
+        }
+
+        ut_DWORD sector_count = WDBF_header->get_sector_count(fapi->get_size());
+        ut_DWORD DIFAT_entries = WDBF_header->get_sector_size() / sizeof(ut_DWORD) - 1;
+        ut_DWORD FAT_sectors = WDBF_header->CFB_number_of_FAT_sectors;
+        ut_LSIZE DIFAT_sectors_needed = FAT_sectors > WDBF_header_DIFAT_entries
+            ? ((ut_LSIZE) FAT_sectors - WDBF_header_DIFAT_entries + DIFAT_entries - 1) / DIFAT_entries : 0;
+
+        if(FAT_sectors == 0 || FAT_sectors > sector_count || WDBF_header->CFB_number_of_DIFAT_sectors < DIFAT_sectors_needed ||
+            WDBF_header->CFB_first_dir_sector_loc >= sector_count)
+            return WDBF_probe_verdict::WDBF_damaged;
+
+        return get_flaw_count() == 0 ? WDBF_probe_verdict::WDBF_valid : WDBF_probe_verdict::WDBF_repairable;
+    }
+
+    /* Parse the heading, print it (unless quiet) and gather every FAT sector location. */
+    void gather_WDBF_heading()
+    {
+        auto header_timer = fapi->get_stats().time(stats_phase::header);
+        parse_WDBF_heading();
+
+        if(!quiet)
+        {
+            if constexpr(dot_doc_logs(dot_doc_log_level::flaws))
+                print_WDBF_flaws();
+            if constexpr(dot_doc_logs(dot_doc_log_level::debug))
+                print_WDBF_heading();
+        }
+
+        WDBF_header->allocate_FAT_sector_locations_memory(*fapi);
+    }
+
+    void print_WDBF_flaws()
+    {
+        err_log->print(stdout);
+        if(err_log->get_error_count() > 0) printf("\n");
+    }
+
+    void print_WDBF_heading()
+    {
         /* Debug printing to see all the data. */
         std::cout << "\n\e[0;32m[DEBUG ➟ \e[1;35mWDBF_header->header_sig\e[0;32m]\e[0;37m WDBF Heading Signature: ";
         for(ut_BYTE i = 0; i < 8; i++)
@@ -408,9 +610,17 @@ public:
         std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_header->CFB_mini_stream_cutoff_size\e[0;32m]\e[0;37m WDBF Mini Stream Cutoff Size: ";
         printf("%X\n", WDBF_header->CFB_mini_stream_cutoff_size);
 
+        std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_header->CFB_first_minifat_sector_loc\e[0;32m]\e[0;37m WDBF First MiniFAT Sector Location: ";
+        printf("0x%X\n", WDBF_header->CFB_first_minifat_sector_loc);
 
+        std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_header->CFB_number_of_minifat_sectors\e[0;32m]\e[0;37m WDBF Number Of MiniFAT Sectors: ";
+        printf("0x%X\n", WDBF_header->CFB_number_of_minifat_sectors);
 
-        WDBF_header->allocate_FAT_sector_locations_memory(*fapi);
+        std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_header->CFB_first_DIFAT_sector_loc\e[0;32m]\e[0;37m WDBF First DIFAT Sector Location: ";
+        printf("0x%X\n", WDBF_header->CFB_first_DIFAT_sector_loc);
+
+        std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_header->CFB_number_of_DIFAT_sectors\e[0;32m]\e[0;37m WDBF Number Of DIFAT Sectors: ";
+        printf("0x%X\n", WDBF_header->CFB_number_of_DIFAT_sectors);
     }
 
     void delete_instance(DotDoc_Header *dheader)
@@ -420,15 +630,25 @@ public:
 
     ~DotDoc_Header()
     {
-        if(fapi) delete fapi;
-        if(WDBF_header) delete WDBF_header;
-        if(err_tracker) delete err_tracker;
+        /* Both live in the arena of `fapi`, which goes back to the free list with it. */
+        if(fapi)
+        {
+            fapi->get_arena().destroy(WDBF_header);
+            fapi->get_arena().destroy(err_log);
+            delete fapi;
+        }
 
         fapi = nullptr;
         WDBF_header = nullptr;
-        err_tracker = nullptr;
+        err_log = nullptr;
+
+        if(quiet) return;
 
         /* Debugging. */
+        if constexpr(!dot_doc_logs(dot_doc_log_level::debug))
+            return;
+
+        std::cout << "\n\e[0;32m[DEBUG ➟ \e[0;34mclass \e[1;35merror_log\e[0;32m]\e[0;37m\t\t`err_log` released." << std::endl;
         std::cout << "\e[0;32m[DEBUG ➟ \e[0;34mclass \e[1;35mFileAPI\e[0;32m]\e[0;37m\t\t`fapi` instance released." << std::endl;
         std::cout << "\e[0;32m[DEBUG ➟ \e[0;34mclass \e[1;35mDotDoc_Header\e[0;32m]\e[0;37m\t`DotDoc_Header` instance released." << std::endl;
     }
@@ -0,0 +1,287 @@
+#ifndef dot_doc_file
+#define dot_doc_file
+
+/* DotDoc_File - a whole WDBF; the header and every structure built from it.
+ *           `decode` runs the stages in order: header (`DotDoc_Header`), the FAT (`DotDoc_FAT`), the directory (`DotDoc_Directory`),
+ *           then the FIB (`DotDoc_FIB`) at the start of the `WordDocument` stream.
+ *           The MiniFAT (`DotDoc_MiniFAT`) only gets attached; it loads itself the first time a small stream is read.
+ *           With a sidecar index (`use_sidecar`) that matches the file, the header, the FAT and the directory come from the index.
+ *           `decode_structure` stops before the FIB; enough to open streams, and all `read_metadata` needs.
+ *
+ * Variables:
+ *      DotDoc_Header *WDBFH - The header; also owns the `FileAPI` instance everything is read through.
+ *      DotDoc_FAT *WDBF_FAT - The FAT next-sector table.
+ *      DotDoc_Directory *WDBF_directory - The directory entries and the name index over them.
+ *      DotDoc_MiniFAT *WDBF_MiniFAT - The MiniFAT and mini stream (lazily loaded).
+ *      DotDoc_Stream *WDBF_WordDocument - The `WordDocument` stream.
+ *      DotDoc_FIB *WDBF_FIB - The File Information Block.
+ *      std::string sidecar_path - The sidecar index to decode from and keep up to date (`use_sidecar`); empty for none.
+ *      DotDoc_Sidecar WDBF_sidecar - The index the FAT and directory point into, when `decode` found a usable one.
+ *      bool structure_decoded - Whether `decode_structure` ran; `decode` and `read_metadata` run it first if not.
+ *
+ *      Everything but `WDBFH` is created in the arena of the header's `FileAPI`, as are the tables they build; all of it is
+ *      given back at once when `WDBFH` is deleted.
+ */
+class DotDoc_File
+{
+private:
+    DotDoc_Header *WDBFH = nullptr;
+    DotDoc_FAT *WDBF_FAT = nullptr;
+    DotDoc_Directory *WDBF_directory = nullptr;
+    DotDoc_MiniFAT *WDBF_MiniFAT = nullptr;
+    DotDoc_Stream *WDBF_WordDocument = nullptr;
+    DotDoc_FIB *WDBF_FIB = nullptr;
+    std::string sidecar_path;
+    DotDoc_Sidecar WDBF_sidecar;
+    bool from_sidecar = false;
+    bool structure_decoded = false;
+
+    /* The header, the FAT and the directory; from the sidecar index if there is a usable one, otherwise built (and saved to the
+     * index, if there is to be one).
+     * */
+    void build_structure(DotDoc_Stats& stats)
+    {
+        struct dot_doc_sidecar_key key;
+        bool keyed = !sidecar_path.empty() && DotDoc_Sidecar::get_key(*WDBFH->get_fapi(), key);
+
+        if(keyed)
+        {
+            auto header_timer = stats.time(stats_phase::header);
+            from_sidecar = WDBF_sidecar.load(sidecar_path.c_str(), key, *WDBFH, *WDBF_FAT, *WDBF_directory);
+        }
+
+        if(from_sidecar)
+        {
+            if constexpr(dot_doc_logs(dot_doc_log_level::flaws))
+                if(!WDBFH->is_quiet()) WDBFH->print_WDBF_flaws();
+
+            return;
+        }
+
+        WDBFH->gather_WDBF_heading();
+
+        {
+            auto FAT_timer = stats.time(stats_phase::FAT);
+            WDBF_FAT->build(*WDBFH->get_fapi(), *WDBFH->get_WDBF_header());
+        }
+
+        {
+            auto directory_timer = stats.time(stats_phase::directory);
+            WDBF_directory->build(*WDBFH->get_fapi(), *WDBFH->get_WDBF_header(), *WDBF_FAT);
+        }
+
+        if(keyed) DotDoc_Sidecar::save(sidecar_path.c_str(), key, *WDBFH, *WDBF_FAT, *WDBF_directory);
+    }
+
+    void create_components()
+    {
+        DotDoc_Arena& arena = WDBFH->get_fapi()->get_arena();
+        WDBF_FAT = arena.create<DotDoc_FAT> ();
+        WDBF_directory = arena.create<DotDoc_Directory> ();
+        WDBF_MiniFAT = arena.create<DotDoc_MiniFAT> ();
+        WDBF_WordDocument = arena.create<DotDoc_Stream> ();
+        WDBF_FIB = arena.create<DotDoc_FIB> ();
+    }
+
+public:
+    /* `quiet`, `backend` and `cache_budget` are passed on to `DotDoc_Header`; quiet, nothing gets printed. */
+    DotDoc_File(ut_BYTE *filename, bool quiet = false, FileAPI_backend backend = FileAPI_backend::FBWW_mapped,
+                ut_LSIZE cache_budget = FBWW_default_cache_budget)
+    {
+        WDBFH = new DotDoc_Header(filename, quiet, backend, cache_budget);
+        create_components();
+    }
+
+    /* The same, for a file opened (and possibly read) ahead of time by `DotDoc_AsyncIO`. */
+    DotDoc_File(FBWW_preloaded& preloaded, bool quiet = false, FileAPI_backend backend = FileAPI_backend::FBWW_mapped,
+                ut_LSIZE cache_budget = FBWW_default_cache_budget)
+    {
+        WDBFH = new DotDoc_Header(preloaded, quiet, backend, cache_budget);
+        create_components();
+    }
+
+    DotDoc_File(const DotDoc_File&) = delete;
+
+    /* Decode from the sidecar index at `path` when it matches the file, and save one there when it does not (see
+     * `DotDoc_Sidecar`); before `decode`. A file decoded from its index has its flaws, but the repairs were not made again in
+     * the file data, so there is nothing for `save_repairs` to write.
+     * */
+    void use_sidecar(std::string path)
+    { sidecar_path = std::move(path); }
+
+    /* Whether `decode` took the header, the FAT and the directory from the sidecar index. */
+    bool is_from_sidecar()
+    { return from_sidecar; }
+
+    /* The header, the FAT and the directory, and the MiniFAT attached; nothing of any stream is read yet. */
+    void decode_structure()
+    {
+        DotDoc_Stats& stats = WDBFH->get_fapi()->get_stats();
+        build_structure(stats);
+
+        auto streams_timer = stats.time(stats_phase::streams);
+        WDBF_MiniFAT->attach(*WDBFH->get_fapi(), *WDBFH->get_WDBF_header(), *WDBF_FAT,
+            WDBF_directory->get_start_sector(0), WDBF_directory->get_stream_size(0));
+
+        structure_decoded = true;
+    }
+
+    void decode()
+    {
+        if(!structure_decoded)
+            decode_structure();
+
+        {
+            auto streams_timer = WDBFH->get_fapi()->get_stats().time(stats_phase::streams);
+            open_stream("WordDocument", *WDBF_WordDocument);
+            WDBF_FIB->parse(*WDBF_WordDocument);
+        }
+
+        if(WDBFH->is_quiet())
+            return;
+
+        if constexpr(dot_doc_logs(dot_doc_log_level::debug))
+            print_WDBF_structure();
+    }
+
+    /* Debug printing of the FAT, the directory and the FIB. */
+    void print_WDBF_structure()
+    {
+        std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_FAT\e[0;32m]\e[0;37m WDBF FAT Next-Sector Table: ";
+        printf("%u entries (%u sectors in file)\n", WDBF_FAT->get_table_size(), WDBF_FAT->get_file_sector_count());
+
+        for(ut_DWORD entry = 0; entry < WDBF_directory->get_entry_count(); entry++)
+        {
+            if(WDBF_directory->get_type(entry) == dir_entry_type::unallocated)
+                continue;
+
+            std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_directory\e[0;32m]\e[0;37m WDBF Directory Entry: ";
+            printf("#%u `%s` (type %d, parent #%d, start sector 0x%X, %llu bytes)\n",
+                entry, WDBF_directory->get_printable_name(entry).c_str(), (ut_BYTE) WDBF_directory->get_type(entry),
+                (nt_DWORD) WDBF_directory->get_parent(entry), WDBF_directory->get_start_sector(entry), WDBF_directory->get_stream_size(entry));
+        }
+
+        std::cout << "\e[0;32m[DEBUG ➟ \e[1;35mWDBF_FIB\e[0;32m]\e[0;37m WDBF File Information Block: ";
+        printf("nFib 0x%X, %u fc/lcb pairs, flags 0x%X, table stream `%s`, fcClx 0x%X, lcbClx %u\n",
+            WDBF_FIB->get_nFib(), WDBF_FIB->get_fc_lcb_count(), WDBF_FIB->get_FIB_base().FIB_flags, WDBF_FIB->get_table_stream_name(),
+            WDBF_FIB->get_fc(fib_fc_lcb::Clx), WDBF_FIB->get_lcb(fib_fc_lcb::Clx));
+    }
+
+    DotDoc_Header *get_header()
+    { return WDBFH; }
+
+    DotDoc_FAT *get_FAT()
+    { return WDBF_FAT; }
+
+    DotDoc_Directory *get_directory()
+    { return WDBF_directory; }
+
+    DotDoc_MiniFAT *get_MiniFAT()
+    { return WDBF_MiniFAT; }
+
+    /* Append the text of the main document (CPs `[0, ccpText)`) to `utf8`; paragraph marks become '\n'. Only valid after `decode`. */
+    void extract_text(std::string& utf8)
+    {
+        auto text_timer = WDBFH->get_fapi()->get_stats().time(stats_phase::text);
+
+        DotDoc_Stream table_stream;
+        open_stream(WDBF_FIB->get_table_stream_name(), table_stream);
+
+        DotDoc_PieceTable piece_table;
+        piece_table.build(table_stream, *WDBF_FIB);
+        piece_table.extract(*WDBF_WordDocument, 0, WDBF_FIB->get_rgLw(fib_lw::ccpText), utf8);
+    }
+
+    /* Append the properties of `\005SummaryInformation` and `\005DocumentSummaryInformation` to `metadata` (`DotDoc_PropertySet`);
+     * a file without one of them just has none of its properties. Needs no more than `decode_structure`, which is run if it
+     * was not; of the streams only those two are read, and of them only the properties that are kept.
+     * */
+    void read_metadata(struct dot_doc_metadata& metadata)
+    {
+        if(!structure_decoded)
+            decode_structure();
+
+        auto metadata_timer = WDBFH->get_fapi()->get_stats().time(stats_phase::metadata);
+        DotDoc_PropertySet property_set;
+        DotDoc_Stream stream;
+
+        const struct { const nt_BYTE *name; property_set_kind set; } property_streams[] = {
+            {"\005SummaryInformation", property_set_kind::summary},
+            {"\005DocumentSummaryInformation", property_set_kind::document_summary}
+        };
+
+        for(const auto& property_stream : property_streams)
+        {
+            ut_DWORD entry = WDBF_directory->find(property_stream.name);
+            if(entry == CFB_NOSTREAM || WDBF_directory->get_type(entry) != dir_entry_type::stream)
+                continue;
+
+            open_stream(entry, stream);
+            property_set.read(stream, property_stream.set, metadata);
+        }
+    }
+
+    /* Write the repairs made while decoding back to the file or, given `output_path`, to a repaired copy of it; only the rewritten
+     * byte ranges are written (see `FileAPI::FBWW_persist`). Returns the number of bytes written.
+     * */
+    ut_LSIZE save_repairs(const nt_BYTE *output_path = nullptr)
+    {
+        FileAPI *fapi = WDBFH->get_fapi();
+        return output_path ? fapi->FBWW_persist_to(output_path) : fapi->FBWW_persist();
+    }
+
+    DotDoc_Stream *get_WordDocument()
+    { return WDBF_WordDocument; }
+
+    DotDoc_FIB *get_FIB()
+    { return WDBF_FIB; }
+
+    /* Open the stream of directory entry `entry` (see `DotDoc_Stream`); only valid after `decode`. */
+    void open_stream(ut_DWORD entry, DotDoc_Stream& stream)
+    {
+        dot_doc_assert(entry < WDBF_directory->get_entry_count() && WDBF_directory->get_type(entry) == dir_entry_type::stream,
+            "\n%sStream Error:%s\n\tDirectory entry #%u is not a stream.\n",
+            red, white,
+            entry)
+
+        stream.open(*WDBFH->get_fapi(), *WDBFH->get_WDBF_header(), *WDBF_FAT, *WDBF_MiniFAT,
+            WDBF_directory->get_start_sector(entry), WDBF_directory->get_stream_size(entry));
+    }
+
+    /* Open the stream named `name` inside the Root Entry, e.g. `open_stream("WordDocument", stream)`. */
+    void open_stream(const nt_BYTE *name, DotDoc_Stream& stream)
+    {
+        ut_DWORD entry = WDBF_directory->find(name);
+
+        dot_doc_assert(entry != CFB_NOSTREAM,
+            "\n%sStream Error:%s\n\tThe WDBF has no `%s` stream.\n",
+            red, white,
+            name)
+
+        open_stream(entry, stream);
+    }
+
+    ~DotDoc_File()
+    {
+        if(WDBFH)
+        {
+            DotDoc_Arena& arena = WDBFH->get_fapi()->get_arena();
+            arena.destroy(WDBF_FIB);
+            arena.destroy(WDBF_WordDocument);
+            arena.destroy(WDBF_MiniFAT);
+            arena.destroy(WDBF_directory);
+            arena.destroy(WDBF_FAT);
+
+            delete WDBFH;
+        }
+
+        WDBF_FIB = nullptr;
+        WDBF_WordDocument = nullptr;
+        WDBF_MiniFAT = nullptr;
+        WDBF_directory = nullptr;
+        WDBF_FAT = nullptr;
+        WDBFH = nullptr;
+    }
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef dot_doc_file_metadata
+#define dot_doc_file_metadata
+
+/* Document metadata; the property set streams (`\005SummaryInformation`, `\005DocumentSummaryInformation`). */
+#include "dot_doc_metadata/dot_doc_property_set.hpp"
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef dot_doc_file_structure
+#define dot_doc_file_structure
+
+/* The Compound File Binary structures that follow the header; FAT, directory and streams, and the sidecar index over them. */
+#include "dot_doc_structure/dot_doc_FAT.hpp"
+#include "dot_doc_structure/dot_doc_directory.hpp"
+#include "dot_doc_structure/dot_doc_minifat.hpp"
+#include "dot_doc_structure/dot_doc_stream.hpp"
+#include "dot_doc_structure/dot_doc_sidecar.hpp"
+
+#endif
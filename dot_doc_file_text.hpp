@@ -0,0 +1,8 @@
+#ifndef dot_doc_file_text
+#define dot_doc_file_text
+
+/* Text extraction; the piece table and transcoding of piece text to UTF-8. */
+#include "dot_doc_text/dot_doc_transcode.hpp"
+#include "dot_doc_text/dot_doc_piece_table.hpp"
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef dot_doc_property_set
+#define dot_doc_property_set
+
+#define WDBF_property_set_byte_order    0xFFFE
+#define WDBF_property_set_header_size   0x1C    // Byte order, version, system identifier, CLSID, number of property sets
+#define WDBF_property_set_FMTID_size    0x14    // FMTID and offset of one property set
+#define WDBF_property_code_page         0x01    // PID of the code page of every `VT_LPSTR` in the set
+#define WDBF_code_page_UTF16LE          1200
+#define WDBF_code_page_CP1252           1252
+#define WDBF_code_page_UTF8             65001
+#define WDBF_filetime_unix_epoch        116444736000000000ULL   // 1970-01-01 in FILETIME ticks (100 ns since 1601)
+
+/* The property sets a WDBF may carry next to its `WordDocument` stream. */
+enum class property_set_kind : ut_BYTE
+{
+    summary             = 0,    // `\005SummaryInformation`; title, author, dates, counts
+    document_summary    = 1     // `\005DocumentSummaryInformation`; category, company, more counts
+};
+
+/* Types of property values ([MS-OLEPS] 2.15); only the ones metadata is stored as are decoded. */
+enum class property_type : ut_WORD
+{
+    VT_I2       = 0x0002,
+    VT_I4       = 0x0003,
+    VT_BOOL     = 0x000B,
+    VT_UI4      = 0x0013,
+    VT_I8       = 0x0014,
+    VT_UI8      = 0x0015,
+    VT_LPSTR    = 0x001E,   // u32 size in bytes, then a string in the code page of the set
+    VT_LPWSTR   = 0x001F,   // u32 size in characters, then UTF-16LE
+    VT_FILETIME = 0x0040
+};
+
+/* What a property is decoded as. */
+enum class dot_doc_property_kind : ut_BYTE
+{
+    integer = 0,
+    boolean,
+    string,
+    time,       // FILETIME; 100 ns ticks since 1601-01-01 UTC
+    duration    // FILETIME ticks, counted from zero (the total editing time)
+};
+
+/* A property name; the `id` of the property in the set `set`, and what it is decoded as. */
+struct dot_doc_property_name
+{
+    property_set_kind       set;
+    ut_DWORD                id;
+    const nt_BYTE           *name;
+    dot_doc_property_kind   kind;
+};
+
+/* Every property that is read; any other property of the sets (thumbnails, heading pairs, links, ...) is skipped. */
+inline constexpr struct dot_doc_property_name dot_doc_property_names[] = {
+    {property_set_kind::summary, 0x02, "title", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x03, "subject", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x04, "author", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x05, "keywords", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x06, "comments", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x07, "template", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x08, "last_author", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x09, "revision", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x0A, "edit_time", dot_doc_property_kind::duration},
+    {property_set_kind::summary, 0x0B, "last_printed", dot_doc_property_kind::time},
+    {property_set_kind::summary, 0x0C, "created", dot_doc_property_kind::time},
+    {property_set_kind::summary, 0x0D, "last_saved", dot_doc_property_kind::time},
+    {property_set_kind::summary, 0x0E, "page_count", dot_doc_property_kind::integer},
+    {property_set_kind::summary, 0x0F, "word_count", dot_doc_property_kind::integer},
+    {property_set_kind::summary, 0x10, "character_count", dot_doc_property_kind::integer},
+    {property_set_kind::summary, 0x12, "application", dot_doc_property_kind::string},
+    {property_set_kind::summary, 0x13, "security", dot_doc_property_kind::integer},
+    {property_set_kind::document_summary, 0x02, "category", dot_doc_property_kind::string},
+    {property_set_kind::document_summary, 0x04, "byte_count", dot_doc_property_kind::integer},
+    {property_set_kind::document_summary, 0x05, "line_count", dot_doc_property_kind::integer},
+    {property_set_kind::document_summary, 0x06, "paragraph_count", dot_doc_property_kind::integer},
+    {property_set_kind::document_summary, 0x0B, "scale", dot_doc_property_kind::boolean},
+    {property_set_kind::document_summary, 0x0E, "manager", dot_doc_property_kind::string},
+    {property_set_kind::document_summary, 0x0F, "company", dot_doc_property_kind::string},
+    {property_set_kind::document_summary, 0x10, "links_dirty", dot_doc_property_kind::boolean},
+    {property_set_kind::document_summary, 0x11, "character_count_with_spaces", dot_doc_property_kind::integer},
+    {property_set_kind::document_summary, 0x13, "shared_document", dot_doc_property_kind::boolean},
+    {property_set_kind::document_summary, 0x16, "hyperlinks_changed", dot_doc_property_kind::boolean},
+    {property_set_kind::document_summary, 0x17, "application_version", dot_doc_property_kind::integer}
+};
+
+/* One decoded property; `value` for integers (sign-extended), booleans (0 or 1), times and durations (FILETIME ticks),
+ * `text` (UTF-8) for strings.
+ * */
+struct dot_doc_property
+{
+    const nt_BYTE           *name;      // From `dot_doc_property_names`
+    dot_doc_property_kind   kind;
+    nt_LSIZE                value = 0;
+    std::string             text;
+};
+
+/* The metadata of a WDBF; its properties in the order they were found, `\005SummaryInformation` first. */
+struct dot_doc_metadata
+{
+    std::vector<dot_doc_property>   properties;
+
+    /* The property named `name` (e.g. "author"); `nullptr` if the file does not have it. */
+    const struct dot_doc_property *find(const nt_BYTE *name) const
+    {
+        for(const struct dot_doc_property& property : properties)
+            if(strcmp(property.name, name) == 0) return &property;
+
+        return nullptr;
+    }
+
+    void clear()
+    { properties.clear(); }
+};
+
+/* FILETIME `ticks` as ISO 8601 UTC (`2024-05-01T09:30:00Z`) into `out`. */
+inline void format_filetime(nt_LSIZE ticks, nt_BYTE *out, size_t out_size)
+{
+    time_t seconds = (ticks - (nt_LSIZE) WDBF_filetime_unix_epoch) / 10000000;
+    struct tm calendar;
+
+    if(!gmtime_r(&seconds, &calendar) || strftime(out, out_size, "%Y-%m-%dT%H:%M:%SZ", &calendar) == 0)
+        snprintf(out, out_size, "%lld", ticks);
+}
+
+/* DotDoc_PropertySet - decodes a property set stream ([MS-OLEPS]), `\005SummaryInformation` or
+ *           `\005DocumentSummaryInformation`, into `dot_doc_property`s.
+ *           Only what is needed is read: the stream header, the property identifier/offset pairs of the first set (the second
+ *           set of `\005DocumentSummaryInformation`, the user-defined properties, is skipped) and the values of the properties
+ *           in `dot_doc_property_names`; a thumbnail in the set is never touched. Everything is read through `DotDoc_Stream::get`
+ *           and `copy`, so nothing but the sectors holding those bytes is read.
+ *
+ *           A stream that is not a property set of the kind expected is an error. A property whose value is out of bounds, or
+ *           not of a type its name is decoded as, is left out. Empty strings and zero times ("never printed") are left out as well.
+ *           `VT_LPSTR` strings are transcoded from the code page of the set: CP1252, UTF-16LE and UTF-8 as such, any other
+ *           code page as ASCII, with every other byte U+FFFD. Line breaks (CR, LF or CRLF) become '\n'.
+ *
+ * Variables:
+ *      std::vector<ut_BYTE> raw, std::vector<ut_BYTE> UTF8 - Reused for the string values; copied out of the stream, transcoded.
+ */
+class DotDoc_PropertySet
+{
+private:
+    static constexpr ut_BYTE summary_FMTID[16] = {
+        0xE0, 0x85, 0x9F, 0xF2, 0xF9, 0x4F, 0x68, 0x10, 0xAB, 0x91, 0x08, 0x00, 0x2B, 0x27, 0xB3, 0xD9};
+    static constexpr ut_BYTE document_summary_FMTID[16] = {
+        0x02, 0xD5, 0xCD, 0xD5, 0x9C, 0x2E, 0x1B, 0x10, 0x93, 0x97, 0x08, 0x00, 0x2B, 0x2C, 0xF9, 0xAE};
+
+    std::vector<ut_BYTE> raw;
+    std::vector<ut_BYTE> UTF8;
+
+    static const struct dot_doc_property_name *find_name(property_set_kind set, ut_DWORD id)
+    {
+        for(const struct dot_doc_property_name& name : dot_doc_property_names)
+            if(name.set == set && name.id == id) return &name;
+
+        return nullptr;
+    }
+
+    /* `count` characters of `character_size` bytes (1 or 2) at `raw` as UTF-8 into `text`; up to the first null. */
+    void put_string(ut_LSIZE count, ut_BYTE character_size, ut_DWORD code_page, std::string& text)
+    {
+        UTF8.resize(count * 3);
+        ut_BYTE *out = UTF8.data();
+
+        for(ut_LSIZE i = 0; i < count;)
+        {
+            ut_DWORD unit = character_size == 2 ? load_le<ut_WORD> (raw.data() + i * 2) : raw[i];
+            if(unit == 0)
+                break;
+
+            /* CRLF is one line break; `put_UTF8` already writes a lone CR as '\n'. */
+            if(unit == 0x0D && i + 1 < count && (character_size == 2 ? load_le<ut_WORD> (raw.data() + (i + 1) * 2) : raw[i + 1]) == 0x0A)
+            {
+                i++;
+                continue;
+            }
+
+            if(character_size == 2) out = put_UTF16LE_as_UTF8(raw.data(), count, i, out);
+            else
+            {
+                if(code_page == WDBF_code_page_CP1252 || unit < 0x80) out = put_CP1252_as_UTF8(unit, out);
+                else out = put_UTF8(UTF8_replacement_character, out);
+                i++;
+            }
+        }
+
+        text.assign((const nt_BYTE *) UTF8.data(), out - UTF8.data());
+    }
+
+    /* UTF-8 bytes at `raw`, up to the first null; invalid sequences are kept as they are. */
+    void put_UTF8_string(ut_LSIZE size, std::string& text)
+    {
+        ut_LSIZE length = 0;
+        while(length < size && raw[length] != 0) length++;
+
+        text.assign((const nt_BYTE *) raw.data(), length);
+    }
+
+    /* Decode the value at `offset` (`end` being the end of the set) as `property.kind`; false if it can not be. */
+    bool read_value(DotDoc_Stream& stream, ut_LSIZE offset, ut_LSIZE end, ut_DWORD code_page, struct dot_doc_property& property)
+    {
+        if(offset > end || end - offset < 4)
+            return false;
+
+        property_type type = (property_type) stream.get<ut_WORD> (offset);
+        ut_LSIZE value_offset = offset + 4, left = end - value_offset;
+
+        switch(property.kind)
+        {
+            case dot_doc_property_kind::integer:
+                if(type == property_type::VT_I2 && left >= 2) property.value = (nt_WORD) stream.get<ut_WORD> (value_offset);
+                else if(type == property_type::VT_I4 && left >= 4) property.value = (nt_DWORD) stream.get<ut_DWORD> (value_offset);
+                else if(type == property_type::VT_UI4 && left >= 4) property.value = stream.get<ut_DWORD> (value_offset);
+                else if((type == property_type::VT_I8 || type == property_type::VT_UI8) && left >= 8)
+                    property.value = stream.get<ut_LSIZE> (value_offset);
+                else return false;
+
+                return true;
+
+            case dot_doc_property_kind::boolean:
+                if(type != property_type::VT_BOOL || left < 2) return false;
+
+                property.value = stream.get<ut_WORD> (value_offset) != 0;
+                return true;
+
+            case dot_doc_property_kind::time:
+            case dot_doc_property_kind::duration:
+                if(type != property_type::VT_FILETIME || left < 8) return false;
+
+                property.value = stream.get<ut_LSIZE> (value_offset);
+                return property.value != 0;
+
+            case dot_doc_property_kind::string:
+            {
+                if((type != property_type::VT_LPSTR && type != property_type::VT_LPWSTR) || left < 4) return false;
+
+                /* A `VT_LPSTR` of a UTF-16LE set is UTF-16LE too; its size is still in bytes. */
+                bool wide = type == property_type::VT_LPWSTR || code_page == WDBF_code_page_UTF16LE;
+                ut_LSIZE size = stream.get<ut_DWORD> (value_offset);
+                if(type == property_type::VT_LPWSTR) size *= 2;
+
+                if(size > left - 4) return false;
+
+                raw.resize(size);
+                stream.copy(value_offset + 4, size, raw.data());
+
+                if(wide) put_string(size / 2, 2, code_page, property.text);
+                else if(code_page == WDBF_code_page_UTF8) put_UTF8_string(size, property.text);
+                else put_string(size, 1, code_page, property.text);
+
+                return !property.text.empty();
+            }
+        }
+
+        return false;
+    }
+
+public:
+    DotDoc_PropertySet() = default;
+    DotDoc_PropertySet(const DotDoc_PropertySet&) = delete;
+
+    /* Decode the property set `stream`, which is a `set`, and append its properties to `metadata`. */
+    void read(DotDoc_Stream& stream, property_set_kind set, struct dot_doc_metadata& metadata)
+    {
+        const nt_BYTE *stream_name = set == property_set_kind::summary ? "\\005SummaryInformation" : "\\005DocumentSummaryInformation";
+        const ut_BYTE *FMTID = set == property_set_kind::summary ? summary_FMTID : document_summary_FMTID;
+        ut_LSIZE stream_size = stream.get_size();
+
+        dot_doc_assert(stream_size >= WDBF_property_set_header_size + WDBF_property_set_FMTID_size &&
+                       stream.get<ut_WORD> (0) == WDBF_property_set_byte_order && stream.get<ut_DWORD> (24) >= 1,
+            "\n%sProperty Set Error:%s\n\tThe %llu byte `%s` stream is not a property set.\n",
+            red, white,
+            stream_size, stream_name)
+
+        ut_BYTE found_FMTID[16];
+        stream.copy(WDBF_property_set_header_size, sizeof(found_FMTID), found_FMTID);
+
+        dot_doc_assert(memcmp(found_FMTID, FMTID, sizeof(found_FMTID)) == 0,
+            "\n%sProperty Set Error:%s\n\tThe first property set of the `%s` stream has another format ID.\n",
+            red, white,
+            stream_name)
+
+        ut_LSIZE set_offset = stream.get<ut_DWORD> (WDBF_property_set_header_size + 16);
+
+        dot_doc_assert(set_offset <= stream_size && stream_size - set_offset >= 8,
+            "\n%sProperty Set Error:%s\n\tThe property set of the `%s` stream starts at %llX, outside of its %llu bytes.\n",
+            red, white,
+            stream_name, set_offset, stream_size)
+
+        /* A set that claims more than the stream holds is read up to the end of the stream. */
+        ut_LSIZE set_size = stream.get<ut_DWORD> (set_offset);
+        ut_LSIZE set_end = set_offset + (set_size < stream_size - set_offset ? set_size : stream_size - set_offset);
+        ut_LSIZE property_count = stream.get<ut_DWORD> (set_offset + 4);
+
+        dot_doc_assert(property_count <= (set_end - set_offset - 8) / 8,
+            "\n%sProperty Set Error:%s\n\tThe property set of the `%s` stream lists %llu properties; %llu bytes do not hold them.\n",
+            red, white,
+            stream_name, property_count, set_end - set_offset)
+
+        /* Strings are in the code page of the set; CP1252 if it does not say. */
+        ut_DWORD code_page = WDBF_code_page_CP1252;
+        for(ut_LSIZE i = 0; i < property_count; i++)
+        {
+            ut_LSIZE pair_offset = set_offset + 8 + i * 8;
+            if(stream.get<ut_DWORD> (pair_offset) != WDBF_property_code_page)
+                continue;
+
+            ut_LSIZE value_offset = set_offset + stream.get<ut_DWORD> (pair_offset + 4);
+            if(value_offset < set_end && set_end - value_offset >= 6 && stream.get<ut_WORD> (value_offset) == (ut_WORD) property_type::VT_I2)
+                code_page = stream.get<ut_WORD> (value_offset + 4);
+
+            break;
+        }
+
+        for(ut_LSIZE i = 0; i < property_count; i++)
+        {
+            ut_LSIZE pair_offset = set_offset + 8 + i * 8;
+            const struct dot_doc_property_name *name = find_name(set, stream.get<ut_DWORD> (pair_offset));
+
+            if(!name)
+                continue;
+
+            struct dot_doc_property property;
+            property.name = name->name;
+            property.kind = name->kind;
+
+            if(read_value(stream, set_offset + stream.get<ut_DWORD> (pair_offset + 4), set_end, code_page, property))
+                metadata.properties.push_back(std::move(property));
+        }
+    }
+};
+
+#endif
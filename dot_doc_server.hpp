@@ -0,0 +1,244 @@
+#ifndef dot_doc_server
+#define dot_doc_server
+
+/* DotDoc_Server - a resident decoder answering on a Unix domain socket (`main.o --serve`), so a caller decoding one upload
+ *           at a time pays neither process start-up nor cold caches for each. The workers, their arenas (`DotDoc_Arena`)
+ *           and everything else stay warm between jobs.
+ *
+ *           Protocol; one job per line, answered by one record (of `dot_doc_sink_format`) as soon as it is done:
+ *               format json|binary|human   - Format of the records; only as the first line. JSON lines by default.
+ *               info <path>                - Decode the file; the record `--batch` writes for it.
+ *               text <path>                - The same, with the text of the document (`dot_doc_file_result::text`).
+ *               probe <path>               - Probe the file from its header block (`--batch --probe`).
+ *               metadata <path>            - Only read the properties of the file (`--batch --metadata`).
+ *           Once the client is done sending (it closes the connection, or shuts down its writing side), the summary record
+ *           follows and the connection is closed. Every connection is served by one worker, its jobs in order; connections
+ *           past the number of workers wait for one.
+ *
+ * Variables:
+ *      std::string socket_path - Where the socket is; removed when the server stops.
+ *      nt_DWORD listen_fd - The listening socket.
+ *      ut_LSIZE cache_budget - As for `DotDoc_Batch::use_sector_cache`; zero maps every file.
+ *      std::string sidecar_directory - As for `DotDoc_Batch::use_sidecars`; empty for no sidecar indexes.
+ *      std::string snapshot_directory - Where `text` jobs keep a snapshot of every file (`DotDoc_Snapshot`), so a file sent
+ *                                       again after an edit only has the changed part of its text extracted; empty for none.
+ *      std::vector<nt_DWORD> connections - Connections being served; shut down for reading on `stop`, so that a worker
+ *                                          waiting on an idle client finishes up.
+ */
+#define dot_doc_server_backlog      64
+
+/* Set by `SIGINT`/`SIGTERM` (see `DotDoc_Server::run`). */
+inline volatile sig_atomic_t dot_doc_server_stop = 0;
+
+class DotDoc_Server
+{
+private:
+    std::string socket_path;
+    nt_DWORD listen_fd = -1;
+    ut_LSIZE cache_budget = 0;
+    std::string sidecar_directory;
+    std::string snapshot_directory;
+    std::mutex connections_lock;
+    std::vector<nt_DWORD> connections;
+    DotDoc_ThreadPool<nt_DWORD> pool;
+
+    static void on_stop_signal(int)
+    { dot_doc_server_stop = 1; }
+
+    /* Run the job on `line` and write its record. */
+    void run_job(nt_BYTE *line, DotDoc_Sink *sink, ut_LSIZE& decoded_count, ut_LSIZE& failed_count)
+    {
+        struct dot_doc_file_result result;
+        nt_BYTE *path = strchr(line, ' ');
+
+        if(path) *path++ = '\0';
+
+        bool with_text = strcmp(line, "text") == 0, probe = strcmp(line, "probe") == 0, metadata = strcmp(line, "metadata") == 0;
+        if(!path || !*path || (!with_text && !probe && !metadata && strcmp(line, "info") != 0))
+        {
+            result.path = path ? path : "";
+            result.message = strcmp(line, "format") == 0 ? std::string("`format` is only taken as the first line.")
+                : std::string("Unknown job `") + line + "`; expected `info`, `text`, `probe` or `metadata` and a path.";
+        }
+        else
+        {
+            FBWW_preloaded file;
+            file.path = path;
+
+            DotDoc_Batch::decode_into(file, result, probe, cache_budget, with_text, nullptr,
+                sidecar_directory.empty() ? nullptr : sidecar_directory.c_str(),
+                snapshot_directory.empty() ? nullptr : snapshot_directory.c_str(), metadata);
+        }
+
+        (result.decoded ? decoded_count : failed_count)++;
+
+        sink->write_result(result);
+        sink->flush();
+    }
+
+    void serve_connection(nt_DWORD connection)
+    {
+        FILE *requests = fdopen(connection, "r");
+        nt_DWORD response_fd = dup(connection);
+        FILE *responses = response_fd >= 0 ? fdopen(response_fd, "w") : NULL;
+
+        if(!requests || !responses)
+        {
+            if(responses) fclose(responses);
+            else if(response_fd >= 0) close(response_fd);
+
+            if(requests) fclose(requests);
+            else close(connection);
+
+            return;
+        }
+
+        DotDoc_Sink *sink = nullptr;
+        ut_LSIZE decoded_count = 0, failed_count = 0;
+        nt_BYTE *line = nullptr;
+        size_t line_capacity = 0;
+        ssize_t line_length;
+
+        while((line_length = getline(&line, &line_capacity, requests)) != -1)
+        {
+            while(line_length > 0 && (line[line_length - 1] == '\n' || line[line_length - 1] == '\r'))
+                line[--line_length] = '\0';
+
+            if(line_length == 0)
+                continue;
+
+            if(!sink && strncmp(line, "format ", 7) == 0)
+            {
+                const nt_BYTE *format = line + 7;
+                sink = DotDoc_Sink::get_sink(strcmp(format, "binary") == 0 ? dot_doc_sink_format::binary
+                    : strcmp(format, "human") == 0 ? dot_doc_sink_format::human : dot_doc_sink_format::JSON_lines, responses);
+                continue;
+            }
+
+            if(!sink) sink = DotDoc_Sink::get_sink(dot_doc_sink_format::JSON_lines, responses);
+            run_job(line, sink, decoded_count, failed_count);
+        }
+
+        free(line);
+
+        if(sink)
+        {
+            sink->write_summary(decoded_count, failed_count);
+            delete sink;
+        }
+
+        {
+            std::lock_guard<std::mutex> connections_guard(connections_lock);
+            connections.erase(std::find(connections.begin(), connections.end(), connection));
+        }
+
+        fclose(responses);
+        fclose(requests);
+    }
+
+public:
+    /* Listen on `path`; a stale socket left there by a server that is gone is replaced. `jobs` of zero means one worker per core. */
+    DotDoc_Server(const nt_BYTE *path, ut_DWORD jobs = 0, ut_LSIZE budget = 0, const nt_BYTE *sidecars = nullptr,
+                  const nt_BYTE *snapshots = nullptr)
+        : socket_path(path), cache_budget(budget), sidecar_directory(sidecars ? sidecars : ""),
+          snapshot_directory(snapshots ? snapshots : ""),
+          pool(jobs > 0 ? jobs : std::max(1u, std::thread::hardware_concurrency()),
+            [this](nt_DWORD& connection, ut_DWORD) { serve_connection(connection); })
+    {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        dot_doc_assert(socket_path.size() < sizeof(address.sun_path),
+            "\n%sServer Error:%s\n\tThe socket path `%s` is longer than the %zu bytes a Unix socket path may have.\n",
+            red, white,
+            path, sizeof(address.sun_path) - 1)
+
+        memcpy(address.sun_path, path, socket_path.size());
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        dot_doc_assert(listen_fd >= 0, "\n%sServer Error:%s\n\tCould not create a socket: %s.\n",
+            red, white,
+            strerror(errno))
+
+        /* Only a socket nobody answers on is in the way; a running server is left alone. */
+        struct stat socket_stat;
+        if(stat(path, &socket_stat) == 0 && S_ISSOCK(socket_stat.st_mode) &&
+           connect(listen_fd, (struct sockaddr *) &address, sizeof(address)) != 0 && errno == ECONNREFUSED)
+            unlink(path);
+
+        if(bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listen_fd, dot_doc_server_backlog) != 0)
+        {
+            nt_DWORD bind_errno = errno;
+            close(listen_fd);
+            listen_fd = -1;
+
+            dot_doc_error("\n%sServer Error:%s\n\tCould not listen on `%s`: %s.\n",
+                red, white,
+                path, strerror(bind_errno))
+        }
+    }
+
+    DotDoc_Server(const DotDoc_Server&) = delete;
+
+    /* Accept connections until `SIGINT` or `SIGTERM`; then let every connection finish its current job and return. */
+    nt_DWORD run()
+    {
+        struct sigaction stop_action;
+        memset(&stop_action, 0, sizeof(stop_action));
+        stop_action.sa_handler = on_stop_signal;
+
+        /* No `SA_RESTART`; the signal has to interrupt `accept`. */
+        sigaction(SIGINT, &stop_action, NULL);
+        sigaction(SIGTERM, &stop_action, NULL);
+
+        /* A client that goes away before its answer is a write error for that connection, not the end of the server. */
+        signal(SIGPIPE, SIG_IGN);
+
+        while(!dot_doc_server_stop)
+        {
+            nt_DWORD connection = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+            if(connection < 0)
+            {
+                if(errno == EINTR || errno == ECONNABORTED) continue;
+
+                fprintf(stderr, "\n%sServer Error:%s\n\tCould not accept a connection: %s.\n", red, white, strerror(errno));
+                break;
+            }
+
+            {
+                std::lock_guard<std::mutex> connections_guard(connections_lock);
+                connections.push_back(connection);
+            }
+
+            pool.submit(connection);
+        }
+
+        stop();
+        return EXIT_SUCCESS;
+    }
+
+    /* Stop taking connections, and have the open ones finish once their current job is done. */
+    void stop()
+    {
+        if(listen_fd >= 0)
+        {
+            close(listen_fd);
+            unlink(socket_path.c_str());
+            listen_fd = -1;
+        }
+
+        {
+            std::lock_guard<std::mutex> connections_guard(connections_lock);
+            for(nt_DWORD connection : connections) shutdown(connection, SHUT_RD);
+        }
+
+        pool.finish();
+    }
+
+    ~DotDoc_Server()
+    { stop(); }
+};
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef dot_doc_session
+#define dot_doc_session
+
+/* DotDoc_Session - a decoder to embed and keep: `open` a file, `decode` it (or only `read_metadata`), read what is needed
+ *           through `get_file`/`get_text`, `close` it, and open the next one with the same session. Meant to be held for as
+ *           long as the caller lives, e.g. one per worker thread of a service.
+ *
+ *           What the session keeps between files: its arena (`DotDoc_Arena`, lent to every `FileAPI` it opens; the header, the
+ *           error log, the tables and the decode objects all go in it and are cleared in one step on `close`), the storage
+ *           of the `DotDoc_File` itself and the text buffer. After the first few files, opening and decoding another one hardly
+ *           allocates at all.
+ *
+ *           Errors are thrown as everywhere else (`dot_doc_fatal_error`); the session stays usable after one, the next `open`
+ *           closes the file that failed. A session is not thread-safe; use one per thread.
+ *
+ * Variables:
+ *      DotDoc_Arena *arena - The session's arena; given back to the free list of whichever thread destroys the session.
+ *      DotDoc_File *WDBF - The open file, constructed in `file_storage`; `nullptr` when closed.
+ *      bool decoded - Whether `decode` got through for the open file.
+ *      FileAPI_backend backend, ut_LSIZE cache_budget, bool quiet - How files are opened; see `DotDoc_File`.
+ *      std::string text - What `get_text` fills; cleared, not freed, between files.
+ *      FBWW_preloaded opening - What `open` by name opens; only its path is ever set, which keeps its buffer from file to file.
+ *      std::string sidecar_directory - Where the sidecar indexes of the files opened are kept (`set_sidecar_directory`).
+ *      std::string snapshot_directory - Where the snapshots of the files opened are kept (`set_snapshot_directory`).
+ *      DotDoc_Snapshot snapshot, std::string snapshot_path - The snapshot of the open file, once its text was extracted.
+ */
+class DotDoc_Session
+{
+private:
+    DotDoc_Arena *arena = nullptr;
+    alignas(DotDoc_File) ut_BYTE file_storage[sizeof(DotDoc_File)];
+    DotDoc_File *WDBF = nullptr;
+    bool decoded = false;
+    FileAPI_backend backend = FileAPI_backend::FBWW_mapped;
+    ut_LSIZE cache_budget = FBWW_default_cache_budget;
+    bool quiet = true;
+    std::string text;
+    FBWW_preloaded opening;
+    std::string sidecar_directory;
+    std::string snapshot_directory;
+    DotDoc_Snapshot snapshot;
+    std::string snapshot_path;
+
+public:
+    /* Quiet by default; an embedded decoder has no business printing. */
+    DotDoc_Session(FileAPI_backend preferred_backend = FileAPI_backend::FBWW_mapped, ut_LSIZE budget = FBWW_default_cache_budget,
+                   bool quiet_session = true)
+        : arena(DotDoc_Arena::acquire()), backend(preferred_backend), cache_budget(budget), quiet(quiet_session)
+    {}
+
+    DotDoc_Session(const DotDoc_Session&) = delete;
+
+    /* How the next files are opened; the open file, if any, is not affected. */
+    void set_backend(FileAPI_backend preferred_backend, ut_LSIZE budget = FBWW_default_cache_budget)
+    {
+        backend = preferred_backend;
+        cache_budget = budget;
+    }
+
+    /* Keep a sidecar index of every file opened from now on in `directory` (`DotDoc_Sidecar`), and decode from it when it
+     * matches the file; `nullptr` for none.
+     * */
+    void set_sidecar_directory(const nt_BYTE *directory)
+    {
+        if(directory) sidecar_directory.assign(directory);
+        else sidecar_directory.clear();
+    }
+
+    /* Keep a snapshot of every file whose text is extracted from now on in `directory` (`DotDoc_Snapshot`), and extract it
+     * again only where the file changed since; `nullptr` for none.
+     * */
+    void set_snapshot_directory(const nt_BYTE *directory)
+    {
+        if(directory) snapshot_directory.assign(directory);
+        else snapshot_directory.clear();
+    }
+
+    void open(const nt_BYTE *filename)
+    {
+        opening.path.assign(filename);
+        open(opening);
+    }
+
+    /* The same, for a file opened (and possibly read) ahead of time by `DotDoc_AsyncIO`. */
+    void open(FBWW_preloaded& file)
+    {
+        close();
+
+        file.arena = arena;
+
+        try
+        {
+            WDBF = new(file_storage) DotDoc_File(file, quiet, backend, cache_budget);
+        }
+        catch(...)
+        {
+            file.arena = nullptr;
+            throw;
+        }
+
+        file.arena = nullptr;
+
+        if(!sidecar_directory.empty())
+            WDBF->use_sidecar(DotDoc_Sidecar::get_path(sidecar_directory.c_str(), WDBF->get_header()->get_fapi()->get_path()));
+    }
+
+    void decode()
+    {
+        dot_doc_assert(WDBF, "\n%sSession Error:%s\n\tThere is no file open to decode.\n",
+            red, white)
+
+        WDBF->decode();
+        decoded = true;
+    }
+
+    /* Append the metadata of the open file to `metadata` (see `DotDoc_File::read_metadata`); it need not be decoded, and
+     * nothing past its structure and the two property set streams is read if it was not.
+     * */
+    void read_metadata(struct dot_doc_metadata& metadata)
+    {
+        dot_doc_assert(WDBF, "\n%sSession Error:%s\n\tThere is no file open to read the metadata of.\n",
+            red, white)
+
+        WDBF->read_metadata(metadata);
+    }
+
+    /* The text of the main document (see `DotDoc_File::extract_text`); valid until the next `get_text` or `close`. */
+    const std::string& get_text()
+    {
+        text.clear();
+        append_text(text);
+
+        return text;
+    }
+
+    /* The same, appended to `utf8`. With a snapshot directory, the file is compared against its snapshot first, and the
+     * snapshot saved again after (see `get_snapshot` for what changed).
+     * */
+    void append_text(std::string& utf8)
+    {
+        dot_doc_assert(decoded, "\n%sSession Error:%s\n\tThe text can only be extracted from a decoded file.\n",
+            red, white)
+
+        if(snapshot_directory.empty())
+        {
+            WDBF->extract_text(utf8);
+            return;
+        }
+
+        snapshot_path = DotDoc_Sidecar::get_path(snapshot_directory.c_str(), WDBF->get_header()->get_fapi()->get_path(),
+            dot_doc_snapshot_suffix);
+
+        snapshot.load(snapshot_path.c_str());
+        snapshot.compare(*WDBF);
+        snapshot.extract_text(*WDBF, utf8);
+        snapshot.save(snapshot_path.c_str(), utf8);
+    }
+
+    /* What the last `get_text`/`append_text` found changed, with a snapshot directory. */
+    DotDoc_Snapshot& get_snapshot()
+    { return snapshot; }
+
+    /* The open file; `nullptr` when closed. */
+    DotDoc_File *get_file()
+    { return WDBF; }
+
+    bool is_open()
+    { return WDBF != nullptr; }
+
+    bool is_decoded()
+    { return decoded; }
+
+    /* Close the open file and clear the arena; everything the session holds is kept for the next `open`. Named `close` for
+     * `reset` being one of the color macros in `common.hpp`.
+     * */
+    void close()
+    {
+        if(WDBF) WDBF->~DotDoc_File();
+
+        WDBF = nullptr;
+        decoded = false;
+        text.clear();
+    }
+
+    ~DotDoc_Session()
+    {
+        close();
+        DotDoc_Arena::release(arena);
+    }
+};
+
+#endif
@@ -0,0 +1,409 @@
+#ifndef dot_doc_sink
+#define dot_doc_sink
+
+/* The outcome of decoding one WDBF; what a `DotDoc_Sink` writes out as one record.
+ *
+ * Variables:
+ *      bool decoded - False if the file could not be decoded; `message` says why, and the header fields are zero.
+ *      ut_DWORD flaw_count - Every flaw found, including any that did not fit in the session's `error_log`.
+ *      std::vector<error_record> flaws - The flaws that could be read back from the `error_log`.
+ *      std::string text - The text of the document, as UTF-8, when it was asked for (`has_text`); never in batches.
+ *      dot_doc_metadata metadata - The properties of the document, when only they were asked for (`has_metadata`); the file
+ *                                  was then decoded no further than its directory, and `flaws` are those of its header.
+ */
+struct dot_doc_file_result
+{
+    std::string                 path;
+    bool                        decoded = false;
+    ut_WORD                     major_version = 0;
+    ut_LSIZE                    sector_size = 0;
+    ut_DWORD                    FAT_entries = 0;
+    ut_DWORD                    directory_entries = 0;
+    ut_DWORD                    flaw_count = 0;
+    std::vector<error_record>   flaws;
+    std::string                 message;
+    bool                        has_text = false;
+    std::string                 text;
+    bool                        has_metadata = false;
+    struct dot_doc_metadata     metadata;
+};
+
+enum class dot_doc_sink_format : ut_BYTE
+{
+    human = 0,
+    JSON_lines = 1,
+    binary = 2
+};
+
+/* DotDoc_Sink - where batch results go; one record per file, then one summary.
+ *           The sink writes through a `FILE` of its own, on a duplicate of the descriptor of the stream it is given, with a
+ *           large buffer so a record costs a `memcpy` rather than a write to the terminal; the caller's stream is flushed
+ *           first and its buffer is never touched. Callers serialize `write_result`/`write_summary` (`DotDoc_Batch` does,
+ *           under its report lock).
+ *           `get_sink` picks the implementation:
+ *               human      - One plain line per file (no color), the first few flaws formatted inline; for people.
+ *               JSON_lines - One JSON object per line, every flaw as a structured object; for scripts.
+ *               binary     - Length-prefixed little-endian records; for tools that never want to parse text (see below).
+ *
+ * Variables:
+ *      FILE *output - Stream the records are written to; the sink's own, on the descriptor of `stdout` unless told otherwise.
+ *                     The stream it was given itself when the descriptor can not be duplicated.
+ *      ut_BYTE *output_buffer - The buffer of `output` when it is the sink's own; flushed when full, on `flush` and when the
+ *                               sink is released, and freed only once `output` is closed.
+ */
+#define dot_doc_sink_buffer_size    (1 << 16)
+
+class DotDoc_Sink
+{
+protected:
+    FILE *output;
+    ut_BYTE *output_buffer;
+
+public:
+    DotDoc_Sink(FILE *output_stream)
+        : output(output_stream), output_buffer(nullptr)
+    {
+        fflush(output_stream);
+
+        nt_DWORD descriptor = dup(fileno(output_stream));
+        FILE *own_output = descriptor >= 0 ? fdopen(descriptor, "w") : nullptr;
+
+        if(!own_output)
+        {
+            if(descriptor >= 0) close(descriptor);
+            return;
+        }
+
+        output = own_output;
+        output_buffer = new ut_BYTE[dot_doc_sink_buffer_size];
+        setvbuf(output, (nt_BYTE *) output_buffer, _IOFBF, dot_doc_sink_buffer_size);
+    }
+
+    DotDoc_Sink(const DotDoc_Sink&) = delete;
+
+    virtual void write_result(const struct dot_doc_file_result& result) = 0;
+    virtual void write_summary(ut_LSIZE decoded_count, ut_LSIZE failed_count) = 0;
+
+    void flush()
+    { fflush(output); }
+
+    static DotDoc_Sink *get_sink(dot_doc_sink_format format, FILE *output_stream = stdout);
+
+    virtual ~DotDoc_Sink()
+    {
+        if(!output_buffer)
+        {
+            fflush(output);
+            return;
+        }
+
+        fclose(output);
+        delete[] output_buffer;
+    }
+};
+
+/* `OK path\tv3, 512-byte sectors, ...: <flaw>; <flaw>; <flaw>; ...` or `FAILED path\t<message>`. */
+#define dot_doc_human_sink_flaws    3
+
+class DotDoc_HumanSink : public DotDoc_Sink
+{
+public:
+    DotDoc_HumanSink(FILE *output_stream)
+        : DotDoc_Sink(output_stream)
+    {}
+
+    void write_result(const struct dot_doc_file_result& result) override
+    {
+        if(!result.decoded)
+        {
+            fprintf(output, "%-7s %s\t%s\n", "FAILED", result.path.c_str(), result.message.c_str());
+            return;
+        }
+
+        fprintf(output, "%-7s %s\tv%d, %llu-byte sectors, %u FAT entries, %u directory entries, %u flaw(s) repaired",
+            "OK", result.path.c_str(), result.major_version, result.sector_size, result.FAT_entries, result.directory_entries,
+            result.flaw_count);
+
+        nt_BYTE flaw[128];
+        for(ut_DWORD index = 0; index < result.flaws.size() && index < dot_doc_human_sink_flaws; index++)
+        {
+            error_log::format_record_compact(result.flaws[index], flaw, sizeof(flaw));
+            fprintf(output, "%s%s", index == 0 ? ": " : "; ", flaw);
+        }
+
+        fputs(result.flaw_count > dot_doc_human_sink_flaws ? "; ...\n" : "\n", output);
+
+        /* Every property on a line of its own, indented under the file; strings cut at their first line break. */
+        for(const struct dot_doc_property& property : result.metadata.properties)
+        {
+            nt_BYTE time[32];
+            fprintf(output, "    %s: ", property.name);
+
+            switch(property.kind)
+            {
+                case dot_doc_property_kind::string:
+                    fprintf(output, "%.*s\n", (nt_DWORD) std::min(property.text.find('\n'), property.text.size()), property.text.c_str());
+                    break;
+                case dot_doc_property_kind::boolean: fputs(property.value ? "yes\n" : "no\n", output); break;
+                case dot_doc_property_kind::time:
+                    format_filetime(property.value, time, sizeof(time));
+                    fprintf(output, "%s\n", time);
+                    break;
+                case dot_doc_property_kind::duration: fprintf(output, "%lld s\n", property.value / 10000000); break;
+                default: fprintf(output, "%lld\n", property.value); break;
+            }
+        }
+
+        /* The text follows its line as it is, ending in a newline. */
+        if(result.has_text)
+        {
+            fwrite(result.text.data(), 1, result.text.size(), output);
+            if(result.text.empty() || result.text.back() != '\n') fputc('\n', output);
+        }
+    }
+
+    void write_summary(ut_LSIZE decoded_count, ut_LSIZE failed_count) override
+    {
+        fprintf(output, "\n%llu file(s): %llu decoded, %llu failed.\n",
+            decoded_count + failed_count, decoded_count, failed_count);
+    }
+};
+
+/* {"path":"a.doc","status":"ok","major_version":3,"sector_size":512,"FAT_entries":128,"directory_entries":8,
+ *  "flaw_count":1,"flaws":[{"error":"Invalid CFB Minor Version","code":226,"offset":24,"size":2,"found":21822,"expected":62,"fixed":true}]}
+ *  (with `"text":"..."` after the flaws when the text was asked for, and `"metadata":{"title":"...","created":"2024-05-01T09:30:00Z",
+ *  "edit_time":600,"page_count":3,"scale":false,...}` when the metadata was; times in UTC, `edit_time` in seconds)
+ * {"path":"b.doc","status":"failed","message":"..."}
+ * {"summary":{"files":2,"decoded":1,"failed":1}}
+ * */
+class DotDoc_JSONLinesSink : public DotDoc_Sink
+{
+private:
+    /* `value` as a JSON string; paths are not guaranteed to be valid UTF-8, bytes above 0x7F are passed through as is. */
+    void put_string(const std::string& value)
+    {
+        fputc('"', output);
+
+        for(ut_BYTE c : value)
+        {
+            if(c == '"' || c == '\\') fprintf(output, "\\%c", c);
+            else if(c < 0x20) fprintf(output, "\\u%04X", c);
+            else fputc(c, output);
+        }
+
+        fputc('"', output);
+    }
+
+public:
+    DotDoc_JSONLinesSink(FILE *output_stream)
+        : DotDoc_Sink(output_stream)
+    {}
+
+    void write_result(const struct dot_doc_file_result& result) override
+    {
+        fputs("{\"path\":", output);
+        put_string(result.path);
+
+        if(!result.decoded)
+        {
+            fputs(",\"status\":\"failed\",\"message\":", output);
+            put_string(result.message);
+            fputs("}\n", output);
+            return;
+        }
+
+        fprintf(output, ",\"status\":\"ok\",\"major_version\":%d,\"sector_size\":%llu,\"FAT_entries\":%u,\"directory_entries\":%u,\"flaw_count\":%u,\"flaws\":[",
+            result.major_version, result.sector_size, result.FAT_entries, result.directory_entries, result.flaw_count);
+
+        for(ut_DWORD index = 0; index < result.flaws.size(); index++)
+        {
+            const struct error_record& flaw = result.flaws[index];
+
+            fprintf(output, "%s{\"error\":\"%s\",\"code\":%d,\"offset\":%llu,\"size\":%d,\"found\":%llu,\"expected\":%llu,\"fixed\":%s}",
+                index == 0 ? "" : ",", error_log::get_error_name(flaw.error), (ut_DWORD) flaw.error, flaw.offset, flaw.size,
+                flaw.found, flaw.expected, flaw.fixed ? "true" : "false");
+        }
+
+        fputc(']', output);
+
+        if(result.has_text)
+        {
+            fputs(",\"text\":", output);
+            put_string(result.text);
+        }
+
+        if(result.has_metadata)
+        {
+            fputs(",\"metadata\":{", output);
+
+            for(ut_DWORD index = 0; index < result.metadata.properties.size(); index++)
+            {
+                const struct dot_doc_property& property = result.metadata.properties[index];
+                fprintf(output, "%s\"%s\":", index == 0 ? "" : ",", property.name);
+
+                nt_BYTE time[32];
+                switch(property.kind)
+                {
+                    case dot_doc_property_kind::string: put_string(property.text); break;
+                    case dot_doc_property_kind::boolean: fputs(property.value ? "true" : "false", output); break;
+                    case dot_doc_property_kind::time:
+                        format_filetime(property.value, time, sizeof(time));
+                        fprintf(output, "\"%s\"", time);
+                        break;
+                    case dot_doc_property_kind::duration: fprintf(output, "%lld", property.value / 10000000); break;
+                    default: fprintf(output, "%lld", property.value); break;
+                }
+            }
+
+            fputc('}', output);
+        }
+
+        fputs("}\n", output);
+    }
+
+    void write_summary(ut_LSIZE decoded_count, ut_LSIZE failed_count) override
+    {
+        fprintf(output, "{\"summary\":{\"files\":%llu,\"decoded\":%llu,\"failed\":%llu}}\n",
+            decoded_count + failed_count, decoded_count, failed_count);
+    }
+};
+
+/* Binary records; every integer is little-endian.
+ *      Stream header: the 8 bytes `WDBFRES1`.
+ *      Record:        u8 kind, u32 payload size, payload.
+ *      Kind 'R' (one file):
+ *          u8 decoded, u8 major version, u16 flaws in this record (n), u32 sector size, u32 FAT entries,
+ *          u32 directory entries, u32 flaw count (every flaw found; may be above n),
+ *          u16 path size, path, u16 message size, message (empty when decoded),
+ *          n x (u8 error code, u8 field size, u8 fixed, u64 offset, u64 found, u64 expected),
+ *          then, only when the text was asked for (the payload size says whether it is there), u32 text size, text (UTF-8).
+ *      Kind 'M' (the metadata of the file of the 'R' record right before it; only when it was asked for):
+ *          u16 property count, then for every property: u8 kind (`dot_doc_property_kind`), u16 name size, name,
+ *          then u64 value (integers, booleans; FILETIME ticks for times and durations) or u32 size, UTF-8 (strings).
+ *      Kind 'S' (summary, last record): u64 decoded, u64 failed.
+ * */
+#define WDBF_result_magic           "WDBFRES1"
+#define WDBF_result_kind_file       'R'
+#define WDBF_result_kind_summary    'S'
+#define WDBF_result_kind_metadata   'M'
+
+class DotDoc_BinarySink : public DotDoc_Sink
+{
+private:
+    std::vector<ut_BYTE> record;
+
+    template<typename T>
+        requires std::integral<T>
+    void put(T value)
+    {
+        ut_BYTE bytes[sizeof(T)];
+        store_le<T> (bytes, value);
+        record.insert(record.end(), bytes, bytes + sizeof(T));
+    }
+
+    /* u16 size, then the bytes; anything past 0xFFFF bytes is cut off. */
+    void put_string(const std::string& value)
+    {
+        ut_WORD size = value.size() < 0xFFFF ? value.size() : 0xFFFF;
+
+        put<ut_WORD> (size);
+        record.insert(record.end(), value.begin(), value.begin() + size);
+    }
+
+    void write_record(ut_BYTE kind)
+    {
+        ut_BYTE prefix[5] = {kind};
+        store_le<ut_DWORD> (prefix + 1, record.size());
+
+        fwrite(prefix, 1, sizeof(prefix), output);
+        fwrite(record.data(), 1, record.size(), output);
+        record.clear();
+    }
+
+public:
+    DotDoc_BinarySink(FILE *output_stream)
+        : DotDoc_Sink(output_stream)
+    { fwrite(WDBF_result_magic, 1, 8, output); }
+
+    void write_result(const struct dot_doc_file_result& result) override
+    {
+        ut_WORD flaws = result.flaws.size() < 0xFFFF ? result.flaws.size() : 0xFFFF;
+
+        put<ut_BYTE> (result.decoded);
+        put<ut_BYTE> (result.major_version);
+        put<ut_WORD> (flaws);
+        put<ut_DWORD> (result.sector_size);
+        put<ut_DWORD> (result.FAT_entries);
+        put<ut_DWORD> (result.directory_entries);
+        put<ut_DWORD> (result.flaw_count);
+        put_string(result.path);
+        put_string(result.message);
+
+        for(ut_WORD index = 0; index < flaws; index++)
+        {
+            const struct error_record& flaw = result.flaws[index];
+
+            put<ut_BYTE> (flaw.error);
+            put<ut_BYTE> (flaw.size);
+            put<ut_BYTE> (flaw.fixed);
+            put<ut_LSIZE> (flaw.offset);
+            put<ut_LSIZE> (flaw.found);
+            put<ut_LSIZE> (flaw.expected);
+        }
+
+        if(result.has_text)
+        {
+            put<ut_DWORD> (result.text.size());
+            record.insert(record.end(), result.text.begin(), result.text.end());
+        }
+
+        write_record(WDBF_result_kind_file);
+
+        if(!result.has_metadata)
+            return;
+
+        ut_WORD properties = result.metadata.properties.size() < 0xFFFF ? result.metadata.properties.size() : 0xFFFF;
+        put<ut_WORD> (properties);
+
+        for(ut_WORD index = 0; index < properties; index++)
+        {
+            const struct dot_doc_property& property = result.metadata.properties[index];
+
+            put<ut_BYTE> ((ut_BYTE) property.kind);
+            put_string(property.name);
+
+            if(property.kind != dot_doc_property_kind::string)
+            {
+                put<ut_LSIZE> (property.value);
+                continue;
+            }
+
+            put<ut_DWORD> (property.text.size());
+            record.insert(record.end(), property.text.begin(), property.text.end());
+        }
+
+        write_record(WDBF_result_kind_metadata);
+    }
+
+    void write_summary(ut_LSIZE decoded_count, ut_LSIZE failed_count) override
+    {
+        put<ut_LSIZE> (decoded_count);
+        put<ut_LSIZE> (failed_count);
+
+        write_record(WDBF_result_kind_summary);
+    }
+};
+
+inline DotDoc_Sink *DotDoc_Sink::get_sink(dot_doc_sink_format format, FILE *output_stream)
+{
+    switch(format)
+    {
+        case dot_doc_sink_format::JSON_lines: return new DotDoc_JSONLinesSink(output_stream);
+        case dot_doc_sink_format::binary: return new DotDoc_BinarySink(output_stream);
+        default: break;
+    }
+
+    return new DotDoc_HumanSink(output_stream);
+}
+
+#endif
@@ -0,0 +1,756 @@
+#ifndef dot_doc_snapshot
+#define dot_doc_snapshot
+
+/* DotDoc_Snapshot - what a decode saw of a file, kept so that the next decode of it, after the file was edited in place, only
+ *           redoes what the edit touched.
+ *
+ *           A snapshot holds a hash of every sector of the file, the FAT next-sector table, `CFB_transaction_sig_number`, a
+ *           signature of every stream, and the text of the document cut into runs of the `WordDocument` stream (at most
+ *           `dot_doc_snapshot_run_size` bytes each), with the UTF-8 every run became. A signature is a hash over where the bytes
+ *           of a stream, or of a run, are in the file and over the hashes of the sectors they are in; the same signature means
+ *           the same bytes, at the same places.
+ *
+ *           `compare` hashes every sector of the file as it is now and works out what changed since the snapshot: sectors, FAT
+ *           entries and streams. `extract_text` then reuses what it can: every run, without building the piece table, if neither
+ *           the `WordDocument` nor the table stream changed; otherwise the UTF-8 of every run that still has its signature. Only
+ *           the other runs are transcoded. `save` keeps what was seen this time for the next.
+ *
+ *           The UTF-8 is kept apart, in the text file of the snapshot (`dot_doc_snapshot_text_suffix`), which is only appended
+ *           to: a save after an edit adds the runs that were transcoded, and the runs that were reused keep pointing where they
+ *           were. Once more of the text file is left over from earlier edits than is still used, it is written anew. Every run
+ *           carries a hash of its UTF-8 that is checked before it is reused, so a damaged or replaced text file only costs
+ *           transcoding those runs again.
+ *
+ *           Hashing reads the whole file, so what an edit saves is the transcoding, not the reading; the most on large documents
+ *           with small edits. A snapshot that does not load (missing, another version, damaged) is no snapshot; everything is
+ *           new, and `compare` reports it all as changed.
+ *
+ *           Layout (version 1), in native byte order; every section is 8-byte aligned:
+ *               snapshot_head                                  - Counts, the generation of the text file and a checksum of the rest.
+ *               sector hashes                                  - `sector_count` 8-byte hashes.
+ *               streams                                        - `stream_count` `snapshot_stream`s.
+ *               runs                                           - `run_count` `snapshot_run`s, in text order.
+ *               FAT                                            - `FAT_table_size` next-sector entries.
+ *           Text file: a `snapshot_text_head`, then UTF-8 wherever the runs point.
+ *
+ * Variables:
+ *      ut_BYTE *mapping, ut_LSIZE mapping_size - The snapshot `load` mapped; the `previous_*` pointers point into it.
+ *      ut_BYTE *text_mapping, ut_LSIZE text_mapping_size - Its text file; `nullptr` if there was none of its generation.
+ *      dev_t text_device, ino_t text_inode - Which file that was; `save` only appends to that one.
+ *      std::string previous_path - Where the snapshot was mapped from.
+ *      std::unordered_map<ut_LSIZE, ut_DWORD> previous_runs_at - Index of the previous run starting at each offset (and
+ *                                                                compressed bit; `get_run_key`).
+ *      snapshot_head current, std::vector<...> sector_hashes, FAT, streams, runs - What `compare` and `extract_text` saw this
+ *                                                                                  time; what `save` writes.
+ *      std::vector<ut_LSIZE> run_positions - Where the text of each of `runs` is in the string `extract_text` appended to,
+ *                                            counted from `text_start`.
+ *      std::vector<ut_DWORD> stream_entries - Directory entry of every stream in `streams`.
+ *      std::vector<ut_DWORD> changed_streams - Directory entries of the streams that changed, or are new.
+ */
+#define dot_doc_snapshot_version        1
+#define dot_doc_snapshot_suffix         ".wdbfsnap"
+#define dot_doc_snapshot_text_suffix    ".text"
+#define dot_doc_snapshot_run_size       0x10000     // Bytes of the `WordDocument` stream per text run, at most
+
+class DotDoc_Snapshot
+{
+private:
+    static constexpr ut_BYTE snapshot_magic[8] = {'W', 'D', 'B', 'F', 'S', 'N', 'A', 'P'};
+    static constexpr ut_BYTE snapshot_text_magic[8] = {'W', 'D', 'B', 'F', 'T', 'E', 'X', 'T'};
+    static constexpr ut_LSIZE hash_seed = 0x9E3779B97F4A7C15ULL;
+    static constexpr ut_LSIZE text_pending = ~0ULL;     // `text_offset` of a run that is not in the text file yet
+
+    struct snapshot_head
+    {
+        ut_BYTE     magic[8];
+        ut_DWORD    version;
+        ut_DWORD    head_size;
+        ut_LSIZE    snapshot_size;
+        ut_LSIZE    file_size;
+        ut_LSIZE    text_size;          // UTF-8 bytes of all runs together
+        ut_LSIZE    text_generation;    // Of the text file the runs point into
+        ut_DWORD    transaction_sig_number;
+        ut_DWORD    sector_shift;
+        ut_DWORD    sector_count;
+        ut_DWORD    FAT_table_size;
+        ut_DWORD    stream_count;
+        ut_DWORD    run_count;
+        ut_DWORD    has_text;
+        ut_DWORD    unused;
+        ut_LSIZE    checksum;           // `get_checksum` of the sections
+    };
+
+    struct snapshot_text_head
+    {
+        ut_BYTE     magic[8];
+        ut_LSIZE    generation;         // New every time the text file is written anew
+    };
+
+    struct snapshot_stream
+    {
+        ut_LSIZE    key;                // `get_stream_key`
+        ut_LSIZE    signature;          // Zero for a stream whose chain could not be followed
+    };
+
+    struct snapshot_run
+    {
+        ut_LSIZE    offset;             // In the `WordDocument` stream
+        ut_LSIZE    signature;
+        ut_LSIZE    text_offset;        // In the text file
+        ut_LSIZE    text_hash;
+        ut_DWORD    length;
+        ut_DWORD    text_length;
+        ut_BYTE     compressed;
+        ut_BYTE     unused[7];
+    };
+
+    ut_BYTE *mapping = nullptr;
+    ut_LSIZE mapping_size = 0;
+    ut_BYTE *text_mapping = nullptr;
+    ut_LSIZE text_mapping_size = 0;
+    dev_t text_device = 0;
+    ino_t text_inode = 0;
+    std::string previous_path;
+    const snapshot_head *previous_head = nullptr;
+    const ut_LSIZE *previous_sector_hashes = nullptr;
+    const snapshot_stream *previous_streams = nullptr;
+    const snapshot_run *previous_runs = nullptr;
+    const ut_DWORD *previous_FAT = nullptr;
+    std::unordered_map<ut_LSIZE, ut_DWORD> previous_runs_at;
+
+    snapshot_head current;
+    std::vector<ut_LSIZE> sector_hashes;
+    std::vector<ut_DWORD> FAT;
+    std::vector<snapshot_stream> streams;
+    std::vector<ut_DWORD> stream_entries;
+    std::vector<snapshot_run> runs;
+    std::vector<ut_LSIZE> run_positions;
+    ut_LSIZE text_start = 0;
+    bool compared = false;
+
+    std::vector<ut_DWORD> changed_streams;
+    ut_DWORD changed_sectors = 0, changed_FAT_entries = 0, removed_streams = 0;
+    ut_LSIZE reused_bytes = 0, transcoded_bytes = 0;
+
+    DotDoc_Stream scratch_stream;
+    DotDoc_PieceTable piece_table;
+
+    static ut_LSIZE mix(ut_LSIZE hash, ut_LSIZE value)
+    {
+        hash = (hash ^ value) * 0xFF51AFD7ED558CCDULL;
+        return hash ^ (hash >> 32);
+    }
+
+    /* Four independent lanes of 8 bytes; a sector is hashed at about the speed it is read. */
+    static ut_LSIZE hash_bytes(const ut_BYTE *data, ut_LSIZE size)
+    {
+        ut_LSIZE lanes[4] = {hash_seed, hash_seed + 1, hash_seed + 2, hash_seed + 3}, i = 0;
+
+        for(; i + 32 <= size; i += 32)
+            for(ut_BYTE lane = 0; lane < 4; lane++)
+            {
+                ut_LSIZE word;
+                memcpy(&word, data + i + lane * 8, sizeof(word));
+                lanes[lane] = mix(lanes[lane], word);
+            }
+
+        ut_LSIZE hash = mix(mix(mix(mix(size, lanes[0]), lanes[1]), lanes[2]), lanes[3]);
+        for(; i < size; i++)
+            hash = mix(hash, data[i]);
+
+        return hash;
+    }
+
+    /* Hash of the names from `entry` up to the Root Entry; what a stream is known by from one snapshot to the next. */
+    static ut_LSIZE get_stream_key(DotDoc_Directory& directory, ut_DWORD entry)
+    {
+        ut_LSIZE key = hash_seed;
+
+        for(ut_DWORD steps = 0; entry < directory.get_entry_count() && steps < directory.get_entry_count(); steps++)
+        {
+            const ut_WORD *name = directory.get_name(entry);
+            for(ut_BYTE i = 0; i < directory.get_name_length(entry); i++)
+                key = mix(key, name[i]);
+
+            key = mix(key, '/');
+            if(entry == 0) break;
+
+            entry = directory.get_parent(entry);
+        }
+
+        return key;
+    }
+
+    static ut_LSIZE get_run_key(ut_LSIZE offset, bool compressed)
+    { return offset << 1 | compressed; }
+
+    /* Signature of the `length` bytes at `offset` of `stream`; never zero. */
+    ut_LSIZE get_range_signature(DotDoc_Stream& stream, ut_LSIZE offset, ut_LSIZE length)
+    {
+        ut_LSIZE signature = mix(hash_seed, length);
+
+        while(length > 0)
+        {
+            ut_LSIZE contiguous;
+            ut_LSIZE file_offset = stream.get_file_offset(offset, contiguous);
+            ut_LSIZE amount = length < contiguous ? length : contiguous;
+
+            signature = mix(signature, file_offset);
+
+            /* Sector `n` is block `n + 1`; the header block is never part of a stream. */
+            for(ut_LSIZE block = file_offset >> current.sector_shift; block <= (file_offset + amount - 1) >> current.sector_shift; block++)
+                signature = mix(signature, block > 0 && block <= sector_hashes.size() ? sector_hashes[block - 1] : 0);
+
+            offset += amount;
+            length -= amount;
+        }
+
+        return signature ? signature : 1;
+    }
+
+    const snapshot_stream *find_previous_stream(ut_LSIZE key)
+    {
+        for(ut_DWORD i = 0; previous_head && i < previous_head->stream_count; i++)
+            if(previous_streams[i].key == key) return &previous_streams[i];
+
+        return nullptr;
+    }
+
+    /* Whether directory entry `entry` is a stream that `compare` found unchanged. */
+    bool is_unchanged(ut_DWORD entry)
+    {
+        return previous_head && entry != CFB_NOSTREAM &&
+               std::find(stream_entries.begin(), stream_entries.end(), entry) != stream_entries.end() &&
+               std::find(changed_streams.begin(), changed_streams.end(), entry) == changed_streams.end();
+    }
+
+    /* Append the UTF-8 of the previous run `before` to `utf8` and keep the run; false, with nothing appended, if the text file
+     * does not hold it as it was saved.
+     * */
+    bool reuse_run(const snapshot_run& before, std::string& utf8)
+    {
+        if(!text_mapping || before.text_offset < sizeof(snapshot_text_head) || before.text_offset > text_mapping_size ||
+           before.text_length > text_mapping_size - before.text_offset)
+            return false;
+
+        const ut_BYTE *text = text_mapping + before.text_offset;
+        if(hash_bytes(text, before.text_length) != before.text_hash)
+            return false;
+
+        run_positions.push_back(utf8.size() - text_start);
+        runs.push_back(before);
+
+        utf8.append((const nt_BYTE *) text, before.text_length);
+        reused_bytes += before.text_length;
+
+        return true;
+    }
+
+    /* Append the text of the `characters` characters at `offset` of `WordDocument` as one run; the previous UTF-8 of the run
+     * if its signature is the same, transcoded otherwise.
+     * */
+    void append_run(DotDoc_Stream& WordDocument, ut_LSIZE offset, ut_LSIZE characters, bool compressed, std::string& utf8)
+    {
+        ut_LSIZE length = characters * (compressed ? 1 : 2);
+        ut_LSIZE signature = get_range_signature(WordDocument, offset, length);
+
+        auto found = previous_head ? previous_runs_at.find(get_run_key(offset, compressed)) : previous_runs_at.end();
+        const snapshot_run *before = found != previous_runs_at.end() ? &previous_runs[found->second] : nullptr;
+
+        if(before && before->length == length && before->signature == signature && reuse_run(*before, utf8))
+            return;
+
+        ut_LSIZE position = utf8.size();
+        piece_table.transcode(WordDocument, offset, characters, compressed, utf8);
+
+        ut_LSIZE text_length = utf8.size() - position;
+        transcoded_bytes += text_length;
+
+        run_positions.push_back(position - text_start);
+        runs.push_back(snapshot_run{offset, signature, text_pending, hash_bytes(ut_BYTE_CPTR utf8.data() + position, text_length),
+                                    (ut_DWORD) length, (ut_DWORD) text_length, compressed, {}});
+    }
+
+    /* Hash of every section after the head, as `save` writes them (`parts`, past the head). */
+    static ut_LSIZE get_checksum(const struct iovec *parts, ut_DWORD part_count)
+    {
+        ut_LSIZE checksum = hash_seed;
+        for(ut_DWORD part = 0; part < part_count; part++)
+            checksum = mix(checksum, hash_bytes((const ut_BYTE *) parts[part].iov_base, parts[part].iov_len));
+
+        return checksum;
+    }
+
+    /* Offsets of the sections of a snapshot with the counts of `head`, and (last) its size. */
+    static void layout(const snapshot_head& head, ut_LSIZE (&offsets)[5])
+    {
+        offsets[0] = sizeof(snapshot_head);
+        offsets[1] = offsets[0] + (ut_LSIZE) head.sector_count * sizeof(ut_LSIZE);
+        offsets[2] = offsets[1] + (ut_LSIZE) head.stream_count * sizeof(snapshot_stream);
+        offsets[3] = offsets[2] + (ut_LSIZE) head.run_count * sizeof(snapshot_run);
+        offsets[4] = offsets[3] + (ut_LSIZE) head.FAT_table_size * sizeof(ut_DWORD);
+    }
+
+    void forget_previous()
+    {
+        if(mapping) munmap(mapping, mapping_size);
+        if(text_mapping) munmap(text_mapping, text_mapping_size);
+
+        mapping = text_mapping = nullptr;
+        mapping_size = text_mapping_size = 0;
+        previous_path.clear();
+        previous_runs_at.clear();
+        previous_head = nullptr;
+        previous_sector_hashes = nullptr;
+        previous_streams = nullptr;
+        previous_runs = nullptr;
+        previous_FAT = nullptr;
+    }
+
+    /* Whether the snapshot `head` at `data` is whole and of this version; its size is `size`. */
+    static bool is_usable(const snapshot_head& head, const ut_BYTE *data, ut_LSIZE size)
+    {
+        ut_LSIZE offsets[5];
+        layout(head, offsets);
+
+        if(memcmp(head.magic, snapshot_magic, sizeof(snapshot_magic)) != 0 || head.version != dot_doc_snapshot_version ||
+           head.head_size != sizeof(snapshot_head) || head.snapshot_size != size || offsets[4] != size ||
+           (head.sector_shift != 9 && head.sector_shift != 12))
+            return false;
+
+        struct iovec sections[4];
+        for(ut_BYTE section = 0; section < 4; section++)
+            sections[section] = {(void *) (data + offsets[section]), offsets[section + 1] - offsets[section]};
+
+        return get_checksum(sections, 4) == head.checksum;
+    }
+
+    /* Map the text file at `path`, if it is of generation `generation`. */
+    void map_text(const nt_BYTE *path, ut_LSIZE generation)
+    {
+        nt_DWORD input = open(path, O_RDONLY | O_CLOEXEC);
+        if(input < 0)
+            return;
+
+        struct stat text_stat;
+        void *text = MAP_FAILED;
+
+        if(fstat(input, &text_stat) == 0 && (ut_LSIZE) text_stat.st_size >= sizeof(snapshot_text_head))
+            text = mmap(NULL, text_stat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, input, 0);
+
+        close(input);
+
+        if(text == MAP_FAILED)
+            return;
+
+        const snapshot_text_head *head = (const snapshot_text_head *) text;
+        if(memcmp(head->magic, snapshot_text_magic, sizeof(snapshot_text_magic)) != 0 || head->generation != generation)
+        {
+            munmap(text, text_stat.st_size);
+            return;
+        }
+
+        text_mapping = ut_BYTE_PTR text;
+        text_mapping_size = text_stat.st_size;
+        text_device = text_stat.st_dev;
+        text_inode = text_stat.st_ino;
+    }
+
+    /* Append the runs that are not in the text file yet to the one `load` mapped, at `path`; false if that is no longer the
+     * file there, if it would be more left-over than used, or if the append did not go through whole.
+     * */
+    bool append_text(const nt_BYTE *path, const std::string& utf8)
+    {
+        if(!text_mapping)
+            return false;
+
+        std::vector<struct iovec> pending;
+        ut_LSIZE pending_size = 0;
+
+        for(ut_DWORD run = 0; run < runs.size(); run++)
+            if(runs[run].text_offset == text_pending)
+            {
+                pending.push_back({(void *) (utf8.data() + text_start + run_positions[run]), runs[run].text_length});
+                pending_size += runs[run].text_length;
+            }
+
+        if(pending.size() > IOV_MAX)
+            return false;
+
+        nt_DWORD output = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+        if(output < 0)
+            return false;
+
+        /* One `writev` on an `O_APPEND` file; whatever else appends to it goes before or after, not in between. */
+        struct stat text_stat;
+        bool appended = fstat(output, &text_stat) == 0 && text_stat.st_dev == text_device && text_stat.st_ino == text_inode &&
+                        (ut_LSIZE) text_stat.st_size - sizeof(snapshot_text_head) + pending_size <= 2 * current.text_size &&
+                        (pending_size == 0 || writev(output, pending.data(), pending.size()) == (ssize_t) pending_size);
+
+        off_t end = appended ? lseek(output, 0, SEEK_CUR) : -1;
+        close(output);
+
+        if(end < 0)
+            return false;
+
+        ut_LSIZE text_offset = end - pending_size;
+        for(snapshot_run& run : runs)
+            if(run.text_offset == text_pending)
+            {
+                run.text_offset = text_offset;
+                text_offset += run.text_length;
+            }
+
+        current.text_generation = ((const snapshot_text_head *) text_mapping)->generation;
+        return true;
+    }
+
+    /* Write the text file at `path` anew under a new generation; the text of every run, in order. */
+    bool write_text(const nt_BYTE *path, const std::string& utf8)
+    {
+        snapshot_text_head head;
+        memcpy(head.magic, snapshot_text_magic, sizeof(snapshot_text_magic));
+        head.generation = mix(mix(mix(hash_seed, std::chrono::system_clock::now().time_since_epoch().count()), getpid()),
+                              syscall(SYS_gettid));
+
+        struct iovec parts[] = {
+            {&head, sizeof(head)},
+            {(void *) (utf8.data() + text_start), current.text_size}
+        };
+
+        if(!FBWW_replace_file(path, parts, 2))
+            return false;
+
+        for(ut_DWORD run = 0; run < runs.size(); run++)
+            runs[run].text_offset = sizeof(snapshot_text_head) + run_positions[run];
+
+        current.text_generation = head.generation;
+        return true;
+    }
+
+public:
+    DotDoc_Snapshot() = default;
+    DotDoc_Snapshot(const DotDoc_Snapshot&) = delete;
+
+    /* Map the snapshot at `path`, and its text file, to compare the next file against; false, and no snapshot to compare
+     * against, if there is no usable one there.
+     * */
+    bool load(const nt_BYTE *path)
+    {
+        forget_previous();
+
+        if constexpr(std::endian::native != std::endian::little)
+            return false;
+
+        nt_DWORD input = open(path, O_RDONLY | O_CLOEXEC);
+        if(input < 0)
+            return false;
+
+        struct stat snapshot_stat;
+        void *snapshot_mapping = MAP_FAILED;
+
+        /* Populated up front; the checksum reads every byte of it anyway. */
+        if(fstat(input, &snapshot_stat) == 0 && (ut_LSIZE) snapshot_stat.st_size >= sizeof(snapshot_head))
+            snapshot_mapping = mmap(NULL, snapshot_stat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, input, 0);
+
+        close(input);
+
+        if(snapshot_mapping == MAP_FAILED)
+            return false;
+
+        mapping = ut_BYTE_PTR snapshot_mapping;
+        mapping_size = snapshot_stat.st_size;
+
+        const snapshot_head *head = (const snapshot_head *) mapping;
+        if(!is_usable(*head, mapping, mapping_size))
+        {
+            forget_previous();
+            return false;
+        }
+
+        ut_LSIZE offsets[5];
+        layout(*head, offsets);
+
+        previous_path.assign(path);
+        previous_head = head;
+        previous_sector_hashes = (const ut_LSIZE *) (mapping + offsets[0]);
+        previous_streams = (const snapshot_stream *) (mapping + offsets[1]);
+        previous_runs = (const snapshot_run *) (mapping + offsets[2]);
+        previous_FAT = (const ut_DWORD *) (mapping + offsets[3]);
+
+        previous_runs_at.reserve(head->run_count);
+        for(ut_DWORD i = 0; i < head->run_count; i++)
+            previous_runs_at.emplace(get_run_key(previous_runs[i].offset, previous_runs[i].compressed), i);
+
+        if(head->has_text)
+            map_text((previous_path + dot_doc_snapshot_text_suffix).c_str(), head->text_generation);
+
+        return true;
+    }
+
+    /* Hash the sectors of `WDBF` (decoded) and work out what changed since the snapshot `load` mapped. */
+    void compare(DotDoc_File& WDBF)
+    {
+        FileAPI& fapi = *WDBF.get_header()->get_fapi();
+        const struct _dot_doc_header& heading = *WDBF.get_header()->get_WDBF_header();
+        DotDoc_Directory& directory = *WDBF.get_directory();
+        auto text_timer = fapi.get_stats().time(stats_phase::text);
+
+        memset(&current, 0, sizeof(current));
+        current.file_size = fapi.get_size();
+        current.transaction_sig_number = heading.CFB_transaction_sig_number;
+        current.sector_shift = heading.CFB_sector_size;
+        current.sector_count = heading.get_sector_count(current.file_size);
+        current.FAT_table_size = WDBF.get_FAT()->get_table_size();
+
+        ut_LSIZE sector_size = heading.get_sector_size();
+        sector_hashes.resize(current.sector_count);
+
+        for(ut_DWORD sector = 0; sector < current.sector_count; sector++)
+        {
+            ut_LSIZE offset = heading.get_sector_offset(sector);
+            ut_LSIZE length = current.file_size - offset < sector_size ? current.file_size - offset : sector_size;
+
+            sector_hashes[sector] = hash_bytes(fapi.FBWW_view(offset, length), length);
+        }
+
+        /* Sectors of another size hash differently; all of them changed. */
+        bool comparable = previous_head && previous_head->sector_shift == current.sector_shift;
+
+        changed_sectors = 0;
+        for(ut_DWORD sector = 0; sector < current.sector_count; sector++)
+            changed_sectors += !comparable || sector >= previous_head->sector_count || previous_sector_hashes[sector] != sector_hashes[sector];
+
+        const ut_DWORD *table = WDBF.get_FAT()->get_table();
+        FAT.assign(table, table + current.FAT_table_size);
+
+        ut_DWORD previous_FAT_size = previous_head ? previous_head->FAT_table_size : 0;
+        changed_FAT_entries = current.FAT_table_size > previous_FAT_size ? current.FAT_table_size - previous_FAT_size
+                                                                         : previous_FAT_size - current.FAT_table_size;
+        for(ut_DWORD entry = 0; entry < current.FAT_table_size && entry < previous_FAT_size; entry++)
+            changed_FAT_entries += FAT[entry] != previous_FAT[entry];
+
+        streams.clear();
+        stream_entries.clear();
+        changed_streams.clear();
+
+        for(ut_DWORD entry = 0; entry < directory.get_entry_count(); entry++)
+        {
+            if(directory.get_type(entry) != dir_entry_type::stream)
+                continue;
+
+            snapshot_stream stream{get_stream_key(directory, entry), 0};
+
+            /* A stream that can not be opened is still listed; as changed, every time. */
+            try
+            {
+                WDBF.open_stream(entry, scratch_stream);
+                stream.signature = get_range_signature(scratch_stream, 0, scratch_stream.get_size());
+            }
+            catch(dot_doc_fatal_error&) {}
+
+            const snapshot_stream *before = comparable ? find_previous_stream(stream.key) : nullptr;
+            if(!before || before->signature != stream.signature || stream.signature == 0)
+                changed_streams.push_back(entry);
+
+            streams.push_back(stream);
+            stream_entries.push_back(entry);
+        }
+
+        removed_streams = 0;
+        for(ut_DWORD i = 0; previous_head && i < previous_head->stream_count; i++)
+            removed_streams += std::none_of(streams.begin(), streams.end(),
+                [&](const snapshot_stream& stream) { return stream.key == previous_streams[i].key; });
+
+        runs.clear();
+        run_positions.clear();
+        reused_bytes = transcoded_bytes = 0;
+        compared = true;
+    }
+
+    /* Append the text of the main document to `utf8`, as `DotDoc_File::extract_text` does; reusing the text of the snapshot
+     * wherever `compare` found its bytes unchanged.
+     * */
+    void extract_text(DotDoc_File& WDBF, std::string& utf8)
+    {
+        dot_doc_assert(compared, "\n%sSnapshot Error:%s\n\tThe file has to be compared against the snapshot before its text is extracted.\n",
+            red, white)
+
+        auto text_timer = WDBF.get_header()->get_fapi()->get_stats().time(stats_phase::text);
+
+        DotDoc_FIB& WDBF_FIB = *WDBF.get_FIB();
+        DotDoc_Directory& directory = *WDBF.get_directory();
+
+        text_start = utf8.size();
+        runs.clear();
+        run_positions.clear();
+        reused_bytes = transcoded_bytes = 0;
+
+        /* An edit hardly changes the size of the text; growing the string as runs are added would copy it over and over. */
+        if(previous_head) utf8.reserve(text_start + previous_head->text_size + previous_head->text_size / 8);
+
+        /* The FIB is in the `WordDocument` stream and the piece table in the table stream; neither changed, nor did the runs.
+         * Should the text file not hold one of them, the text is extracted as if they had changed.
+         * */
+        if(previous_head && previous_head->has_text &&
+           is_unchanged(directory.find("WordDocument")) && is_unchanged(directory.find(WDBF_FIB.get_table_stream_name())))
+        {
+            ut_DWORD run = 0;
+            while(run < previous_head->run_count && reuse_run(previous_runs[run], utf8))
+                run++;
+
+            current.has_text = run == previous_head->run_count;
+            if(current.has_text)
+                return;
+
+            utf8.resize(text_start);
+            runs.clear();
+            run_positions.clear();
+            reused_bytes = 0;
+        }
+
+        DotDoc_Stream table_stream;
+        WDBF.open_stream(WDBF_FIB.get_table_stream_name(), table_stream);
+        piece_table.build(table_stream, WDBF_FIB);
+
+        DotDoc_Stream& WordDocument = *WDBF.get_WordDocument();
+        ut_DWORD last_CP = WDBF_FIB.get_rgLw(fib_lw::ccpText);
+
+        for(ut_DWORD piece = 0; piece < piece_table.get_piece_count(); piece++)
+        {
+            ut_LSIZE offset = 0;
+            ut_LSIZE characters_left = piece_table.get_piece_range(WordDocument, piece, 0, last_CP, offset);
+            bool compressed = piece_table.is_compressed(piece);
+            ut_LSIZE character_size = compressed ? 1 : 2;
+
+            /* Runs end at multiples of `dot_doc_snapshot_run_size` in the stream, wherever the piece starts, so the same bytes
+             * make the same runs from one edit to the next.
+             * */
+            while(characters_left > 0)
+            {
+                ut_LSIZE boundary = (offset / dot_doc_snapshot_run_size + 1) * dot_doc_snapshot_run_size;
+                ut_LSIZE characters = (boundary - offset) / character_size;
+
+                if(characters == 0) characters = 1;
+
+                if(characters >= characters_left)
+                    characters = characters_left;
+                else if(!compressed)
+                {
+                    /* Keep a surrogate pair together in the run of its high surrogate. */
+                    ut_WORD last_unit = WordDocument.get<ut_WORD> (offset + (characters - 1) * 2);
+                    if(last_unit >= 0xD800 && last_unit <= 0xDBFF) characters++;
+                }
+
+                append_run(WordDocument, offset, characters, compressed, utf8);
+
+                offset += characters * character_size;
+                characters_left -= characters;
+            }
+        }
+
+        current.has_text = true;
+    }
+
+    /* Save what `compare` saw (and `extract_text`, with `utf8` as it left it) to `path`, for the next time the file changes.
+     * The transcoded runs are appended to the text file saved there before, when there is one. Returns whether it got saved.
+     * */
+    bool save(const nt_BYTE *path, const std::string& utf8 = std::string())
+    {
+        if constexpr(std::endian::native != std::endian::little)
+            return false;
+
+        if(!compared)
+            return false;
+
+        if(!current.has_text)
+        {
+            runs.clear();
+            run_positions.clear();
+        }
+
+        bool pending = false;
+        current.text_size = 0;
+
+        for(const snapshot_run& run : runs)
+        {
+            current.text_size += run.text_length;
+            pending |= run.text_offset == text_pending;
+        }
+
+        /* The same file, and every run already in the text file; the snapshot would be written as it is. */
+        if(previous_head && previous_path == path && !pending && changed_sectors == 0 && changed_FAT_entries == 0 &&
+           previous_head->sector_count == current.sector_count && previous_head->file_size == current.file_size &&
+           previous_head->sector_shift == current.sector_shift && previous_head->has_text >= current.has_text)
+            return true;
+
+        if(current.has_text)
+        {
+            std::string text_path = std::string(path) + dot_doc_snapshot_text_suffix;
+
+            /* Reused runs point into the text file that was loaded; saved anywhere else, all of it is written there. */
+            if(!(previous_path == path && append_text(text_path.c_str(), utf8)) && !write_text(text_path.c_str(), utf8))
+                return false;
+        }
+
+        snapshot_head head = current;
+        memcpy(head.magic, snapshot_magic, sizeof(snapshot_magic));
+        head.version = dot_doc_snapshot_version;
+        head.head_size = sizeof(snapshot_head);
+        head.stream_count = streams.size();
+        head.run_count = runs.size();
+
+        ut_LSIZE offsets[5];
+        layout(head, offsets);
+        head.snapshot_size = offsets[4];
+
+        struct iovec parts[] = {
+            {&head, sizeof(head)},
+            {sector_hashes.data(), sector_hashes.size() * sizeof(ut_LSIZE)},
+            {streams.data(), streams.size() * sizeof(snapshot_stream)},
+            {runs.data(), runs.size() * sizeof(snapshot_run)},
+            {FAT.data(), FAT.size() * sizeof(ut_DWORD)}
+        };
+
+        head.checksum = get_checksum(parts + 1, sizeof(parts) / sizeof(parts[0]) - 1);
+        return FBWW_replace_file(path, parts, sizeof(parts) / sizeof(parts[0]));
+    }
+
+    ~DotDoc_Snapshot()
+    { forget_previous(); }
+
+    /* Whether `load` found a snapshot; without one, everything is new. */
+    bool is_loaded()
+    { return previous_head != nullptr; }
+
+    ut_DWORD get_sector_count()
+    { return current.sector_count; }
+
+    ut_DWORD get_changed_sector_count()
+    { return changed_sectors; }
+
+    /* FAT entries that differ from the snapshot, counting every entry the table grew or shrank by. */
+    ut_DWORD get_changed_FAT_entries()
+    { return changed_FAT_entries; }
+
+    /* Directory entries of the streams that are new or changed since the snapshot. */
+    const std::vector<ut_DWORD>& get_changed_streams()
+    { return changed_streams; }
+
+    /* Streams of the snapshot that are no longer in the file. */
+    ut_DWORD get_removed_stream_count()
+    { return removed_streams; }
+
+    /* Whether `CFB_transaction_sig_number` changed; most writers leave it at 0, so that it did not says nothing. */
+    bool is_transaction_changed()
+    { return previous_head && previous_head->transaction_sig_number != current.transaction_sig_number; }
+
+    /* UTF-8 bytes of the last `extract_text` taken from the snapshot, and transcoded anew. */
+    ut_LSIZE get_reused_bytes()
+    { return reused_bytes; }
+
+    ut_LSIZE get_transcoded_bytes()
+    { return transcoded_bytes; }
+};
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef dot_doc_stats
+#define dot_doc_stats
+
+/* Instrumentation; built in unless compiled with `-DDOT_DOC_STATS=0`, in which case every counter and timer below is an empty
+ * `if constexpr` and costs nothing. Enabled, a counter is one add to a session-local array and a phase a pair of clock reads.
+ * */
+#ifndef DOT_DOC_STATS
+#define DOT_DOC_STATS   1
+#endif
+
+constexpr bool dot_doc_stats_enabled = DOT_DOC_STATS;
+
+/* Phases of a decode; wall time is kept per phase. */
+enum class stats_phase : ut_BYTE
+{
+    open = 0,           // Opening the file; `mmap`, or reading it into memory
+    header,             // `gather_WDBF_heading`
+    FAT,                // `DotDoc_FAT::build`
+    directory,          // `DotDoc_Directory::build`
+    streams,            // Opening streams (MiniFAT included) and parsing the FIB
+    text,               // `extract_text`
+    metadata,           // `read_metadata`; the property set streams
+    count
+};
+
+enum class stats_counter : ut_BYTE
+{
+    bytes_read = 0,     // Bytes handed out by `FileAPI` (views and cursor reads)
+    syscalls,           // File syscalls made by `FileAPI`: fstat, mmap, madvise, read, pread, fadvise
+    allocations,        // Heap allocations during the phases; needs the program to count them (`dot_doc_thread_allocations`)
+    sectors_visited,    // Sectors (and mini sectors) followed through the FAT/MiniFAT
+    in_place_views,     // Stream views served straight from the file data
+    copied_views,       // Stream views that straddled two extents (or cache slots) and had to be copied
+    cache_hits,         // Sector cache lookups served from a slot (`FileAPI_backend::FBWW_cached` only)
+    cache_misses,       // Sector cache lookups that had to `pread` the block
+    count
+};
+
+/* Heap allocations made by the current thread. The library never changes it; a program that wants allocation counts replaces
+ * `operator new` and increments it there (main.cpp does, unless built with `DOT_DOC_STATS=0`).
+ * */
+inline thread_local ut_LSIZE dot_doc_thread_allocations = 0;
+
+/* Nanoseconds since the first call in the process; shared by every session, so trace events of different files line up. */
+inline ut_LSIZE dot_doc_now_ns()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now() - epoch).count();
+}
+
+/* Small, stable ID of the current thread; what trace events use as `tid`. */
+inline ut_DWORD dot_doc_thread_ID()
+{
+    static std::atomic<ut_DWORD> next_ID{1};
+    static thread_local ut_DWORD ID = next_ID.fetch_add(1, std::memory_order_relaxed);
+
+    return ID;
+}
+
+inline const nt_BYTE *get_phase_name(stats_phase phase)
+{
+    static const nt_BYTE *names[] = {"open", "header", "FAT", "directory", "streams", "text", "metadata"};
+    return names[(ut_BYTE) phase];
+}
+
+inline const nt_BYTE *get_counter_name(stats_counter counter)
+{
+    static const nt_BYTE *names[] = {"bytes_read", "syscalls", "allocations", "sectors_visited", "in_place_views", "copied_views", "cache_hits", "cache_misses"};
+    return names[(ut_BYTE) counter];
+}
+
+/* DotDoc_Stats - counters and phase timings of one decode session; owned by the session's `FileAPI`.
+ *           Phases are timed with `time(phase)`, which returns a scope guard; every timed phase is also kept as a trace
+ *           event (up to `stats_max_events`) for `write_trace`.
+ *
+ * Variables:
+ *      ut_LSIZE counters[] - One per `stats_counter`.
+ *      ut_LSIZE phase_ns[] - Wall time spent in each phase, summed over every time it ran.
+ *      trace_event events[] - Start and duration of each timed phase, in the order they ended.
+ */
+#define stats_max_events    64
+
+class DotDoc_Stats
+{
+private:
+    struct trace_event
+    {
+        stats_phase phase;
+        ut_DWORD    thread_ID;
+        ut_LSIZE    start_ns;
+        ut_LSIZE    duration_ns;
+    };
+
+    ut_LSIZE counters[(ut_BYTE) stats_counter::count] = {};
+    ut_LSIZE phase_ns[(ut_BYTE) stats_phase::count] = {};
+    trace_event events[stats_max_events];
+    ut_DWORD event_count = 0;
+
+public:
+    class phase_timer
+    {
+    private:
+        DotDoc_Stats *stats;
+        stats_phase phase;
+        ut_LSIZE start_ns, start_allocations;
+
+    public:
+        phase_timer(DotDoc_Stats *session_stats, stats_phase timed_phase)
+            : stats(session_stats), phase(timed_phase)
+        {
+            if constexpr(dot_doc_stats_enabled)
+            {
+                start_ns = dot_doc_now_ns();
+                start_allocations = dot_doc_thread_allocations;
+            }
+        }
+
+        phase_timer(const phase_timer&) = delete;
+
+        ~phase_timer()
+        {
+            if constexpr(dot_doc_stats_enabled)
+                stats->end_phase(phase, start_ns, dot_doc_now_ns() - start_ns, dot_doc_thread_allocations - start_allocations);
+        }
+    };
+
+    void add(stats_counter counter, ut_LSIZE amount = 1)
+    {
+        if constexpr(dot_doc_stats_enabled)
+            counters[(ut_BYTE) counter] += amount;
+    }
+
+    /* `auto timer = stats.time(stats_phase::FAT);` times the rest of the scope. */
+    [[nodiscard]] phase_timer time(stats_phase phase)
+    { return phase_timer(this, phase); }
+
+    void end_phase(stats_phase phase, ut_LSIZE start_ns, ut_LSIZE duration_ns, ut_LSIZE allocations)
+    {
+        phase_ns[(ut_BYTE) phase] += duration_ns;
+        counters[(ut_BYTE) stats_counter::allocations] += allocations;
+
+        if(event_count < stats_max_events)
+            events[event_count++] = trace_event{phase, dot_doc_thread_ID(), start_ns, duration_ns};
+    }
+
+    ut_LSIZE get_counter(stats_counter counter)
+    { return counters[(ut_BYTE) counter]; }
+
+    ut_LSIZE get_phase_ns(stats_phase phase)
+    { return phase_ns[(ut_BYTE) phase]; }
+
+    ut_LSIZE get_total_ns()
+    {
+        ut_LSIZE total = 0;
+        for(ut_LSIZE ns : phase_ns) total += ns;
+
+        return total;
+    }
+
+    void print(FILE *output)
+    {
+        if constexpr(!dot_doc_stats_enabled)
+        {
+            fprintf(output, "Statistics were compiled out (DOT_DOC_STATS=0).\n");
+            return;
+        }
+
+        fprintf(output, "%-16s %12s\n", "phase", "us");
+        for(ut_BYTE phase = 0; phase < (ut_BYTE) stats_phase::count; phase++)
+            fprintf(output, "%-16s %12.1f\n", get_phase_name((stats_phase) phase), phase_ns[phase] / 1e3);
+        fprintf(output, "%-16s %12.1f\n\n", "total", get_total_ns() / 1e3);
+
+        fprintf(output, "%-16s %12s\n", "counter", "value");
+        for(ut_BYTE counter = 0; counter < (ut_BYTE) stats_counter::count; counter++)
+            fprintf(output, "%-16s %12llu\n", get_counter_name((stats_counter) counter), counters[counter]);
+    }
+
+    /* The session's phases as Chrome trace events ("X" complete events, microseconds), each preceded by a comma unless `first`. */
+    void write_trace(FILE *output, const std::string& path, bool& first)
+    {
+        for(ut_DWORD event = 0; event < event_count; event++)
+        {
+            fprintf(output, "%s{\"name\":\"%s\",\"cat\":\"decode\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"file\":\"",
+                first ? "" : ",\n", get_phase_name(events[event].phase), events[event].start_ns / 1e3, events[event].duration_ns / 1e3,
+                events[event].thread_ID);
+
+            for(ut_BYTE c : path)
+            {
+                if(c == '"' || c == '\\') fprintf(output, "\\%c", c);
+                else if(c < 0x20) fprintf(output, "\\u%04X", c);
+                else fputc(c, output);
+            }
+
+            fputs("\"}}", output);
+            first = false;
+        }
+    }
+};
+
+/* DotDoc_Histogram - log-linear histogram for percentiles over any number of values in constant memory.
+ *           Values below 16 get a bucket each; above that, every power of two is split into 8 buckets, so a percentile is
+ *           off by at most 1/8th (12.5%) of the value. `min`, `max` and the sum are exact.
+ */
+#define histogram_linear_buckets    16
+#define histogram_sub_buckets       8
+#define histogram_buckets           (histogram_linear_buckets + (64 - 4) * histogram_sub_buckets)
+
+class DotDoc_Histogram
+{
+private:
+    ut_LSIZE buckets[histogram_buckets] = {};
+    ut_LSIZE count = 0, sum = 0, min = ~0ULL, max = 0;
+
+    static ut_DWORD get_bucket(ut_LSIZE value)
+    {
+        if(value < histogram_linear_buckets) return value;
+
+        ut_DWORD exponent = std::bit_width(value) - 1;
+        return histogram_linear_buckets + (exponent - 4) * histogram_sub_buckets + ((value >> (exponent - 3)) & (histogram_sub_buckets - 1));
+    }
+
+    /* Middle of the range of values `bucket` holds. */
+    static ut_LSIZE get_bucket_value(ut_DWORD bucket)
+    {
+        if(bucket < histogram_linear_buckets) return bucket;
+
+        ut_DWORD exponent = (bucket - histogram_linear_buckets) / histogram_sub_buckets + 4;
+        ut_LSIZE sub_bucket = (bucket - histogram_linear_buckets) % histogram_sub_buckets;
+        ut_LSIZE low = (1ULL << exponent) + (sub_bucket << (exponent - 3));
+
+        return low + (1ULL << (exponent - 4));
+    }
+
+public:
+    void add(ut_LSIZE value)
+    {
+        buckets[get_bucket(value)]++;
+        count++;
+        sum += value;
+        if(value < min) min = value;
+        if(value > max) max = value;
+    }
+
+    ut_LSIZE get_count()
+    { return count; }
+
+    ut_LSIZE get_max()
+    { return max; }
+
+    double get_mean()
+    { return count ? (double) sum / count : 0; }
+
+    /* `fraction` from 0 to 1, e.g. 0.99 for p99. */
+    ut_LSIZE get_percentile(double fraction)
+    {
+        if(count == 0) return 0;
+
+        /* Nearest rank: the smallest value at least `fraction` of all values are at or below. */
+        ut_LSIZE rank = std::max<ut_LSIZE> (1, (ut_LSIZE) std::ceil(fraction * count)), seen = 0;
+        for(ut_DWORD bucket = 0; bucket < histogram_buckets; bucket++)
+        {
+            seen += buckets[bucket];
+            if(seen >= rank) return std::clamp(get_bucket_value(bucket), min, max);
+        }
+
+        return max;
+    }
+};
+
+/* DotDoc_StatsSummary - the sessions of a batch, summed up as a histogram per phase and per counter. */
+class DotDoc_StatsSummary
+{
+private:
+    DotDoc_Histogram phases[(ut_BYTE) stats_phase::count];
+    DotDoc_Histogram total;
+    DotDoc_Histogram counters[(ut_BYTE) stats_counter::count];
+
+public:
+    void add(DotDoc_Stats& stats)
+    {
+        for(ut_BYTE phase = 0; phase < (ut_BYTE) stats_phase::count; phase++)
+            phases[phase].add(stats.get_phase_ns((stats_phase) phase));
+
+        for(ut_BYTE counter = 0; counter < (ut_BYTE) stats_counter::count; counter++)
+            counters[counter].add(stats.get_counter((stats_counter) counter));
+
+        total.add(stats.get_total_ns());
+    }
+
+    void print(FILE *output)
+    {
+        if constexpr(!dot_doc_stats_enabled)
+        {
+            fprintf(output, "Statistics were compiled out (DOT_DOC_STATS=0).\n");
+            return;
+        }
+
+        fprintf(output, "\nPer file, over %llu file(s):\n%-16s %12s %12s %12s %12s %12s\n", total.get_count(),
+            "phase (us)", "mean", "p50", "p90", "p99", "max");
+
+        auto print_row = [output](const nt_BYTE *name, DotDoc_Histogram& histogram, double scale) {
+            fprintf(output, "%-16s %12.1f %12.1f %12.1f %12.1f %12.1f\n", name, histogram.get_mean() / scale,
+                histogram.get_percentile(0.5) / scale, histogram.get_percentile(0.9) / scale, histogram.get_percentile(0.99) / scale,
+                histogram.get_max() / scale);
+        };
+
+        for(ut_BYTE phase = 0; phase < (ut_BYTE) stats_phase::count; phase++)
+            print_row(get_phase_name((stats_phase) phase), phases[phase], 1e3);
+        print_row("total", total, 1e3);
+
+        fprintf(output, "%-16s\n", "counter");
+        for(ut_BYTE counter = 0; counter < (ut_BYTE) stats_counter::count; counter++)
+            print_row(get_counter_name((stats_counter) counter), counters[counter], 1);
+    }
+};
+
+#endif
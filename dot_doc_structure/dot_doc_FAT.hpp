@@ -0,0 +1,150 @@
+#ifndef dot_doc_FAT
+#define dot_doc_FAT
+
+/* DotDoc_FAT - the File Allocation Table of the WDBF, as one contiguous next-sector table.
+ *           The FAT sectors listed in `_dot_doc_header::FAT_sector_locations` are concatenated, in order, into `next_sector`,
+ *           so the sector following sector `n` in a chain is simply `next_sector[n]`.
+ *           Works for both Major Version 3 (512-byte sectors, 128 entries per FAT sector) and Major Version 4
+ *           (4096-byte sectors, 1024 entries per FAT sector).
+ *
+ * Variables:
+ *      ut_DWORD *next_sector - The next-sector table; in the arena of the `FileAPI` it was built from, so it lasts as long as that does.
+ *      ut_DWORD table_size - Number of entries in `next_sector`; FAT sectors * entries per FAT sector.
+ *      ut_DWORD table_capacity - Entries `next_sector` has room for; building again reuses it when the table fits.
+ *      ut_DWORD file_sector_count - Number of sectors actually in the file; entries past this can never be part of a valid chain.
+ */
+class DotDoc_FAT
+{
+    /* `DotDoc_Sidecar` saves the table, and on a hit points `next_sector` into its mapping instead of building. */
+    friend class DotDoc_Sidecar;
+
+private:
+    ut_DWORD *next_sector = nullptr;
+    ut_DWORD table_size = 0;
+    ut_DWORD table_capacity = 0;
+    DotDoc_Arena *table_arena = nullptr;
+    ut_DWORD file_sector_count = 0;
+
+public:
+    DotDoc_FAT() = default;
+    DotDoc_FAT(const DotDoc_FAT&) = delete;
+
+    void build(FileAPI& fapi, const struct _dot_doc_header& WDBF_header)
+    {
+        ut_LSIZE sector_size = WDBF_header.get_sector_size();
+        ut_DWORD entries_per_sector = sector_size / sizeof(ut_DWORD);
+        ut_DWORD FAT_sector_count = WDBF_header.CFB_number_of_FAT_sectors;
+
+        dot_doc_assert(WDBF_header.FAT_sector_locations || FAT_sector_count == 0,
+            "\n%sFAT Error:%s\n\tThe FAT sector locations have not been gathered; call `gather_WDBF_heading` first.\n",
+            red, white)
+
+        file_sector_count = WDBF_header.get_sector_count(fapi.get_size());
+        fapi.get_stats().add(stats_counter::sectors_visited, FAT_sector_count);
+
+        table_size = FAT_sector_count * entries_per_sector;
+        if(table_arena != &fapi.get_arena() || table_capacity < table_size)
+        {
+            table_arena = &fapi.get_arena();
+            next_sector = table_arena->allocate<ut_DWORD> (table_size);
+            table_capacity = table_size;
+        }
+
+        /* FAT sectors are usually allocated next to each other; copy every run of adjacent FAT sectors in one go. */
+        for(ut_DWORD i = 0; i < FAT_sector_count;)
+        {
+            ut_DWORD run_start = WDBF_header.FAT_sector_locations[i];
+            ut_DWORD run_length = 1;
+
+            while(i + run_length < FAT_sector_count &&
+                  WDBF_header.FAT_sector_locations[i + run_length] == run_start + run_length)
+                run_length++;
+
+            dot_doc_assert(run_start < file_sector_count && run_length <= file_sector_count - run_start,
+                "\n%sFAT Error:%s\n\tFAT sector #%u is at sector `0x%X`, but the WDBF only has %u sectors.\n",
+                red, white,
+                i, run_start, file_sector_count)
+
+            /* With the sector cache, a view ends at the end of a cache block. */
+            ut_LSIZE viewable_sectors = fapi.FBWW_view_limit(WDBF_header.get_sector_offset(run_start)) / sector_size;
+            if(viewable_sectors > 0 && run_length > viewable_sectors) run_length = viewable_sectors;
+
+            FBWW_span FAT_run{fapi.FBWW_view(WDBF_header.get_sector_offset(run_start), run_length * sector_size), run_length * sector_size};
+
+            if constexpr(std::endian::native == std::endian::little)
+                memcpy(next_sector + (ut_LSIZE) i * entries_per_sector, FAT_run.data, FAT_run.size);
+            else
+                for(ut_LSIZE entry = 0; entry < (ut_LSIZE) run_length * entries_per_sector; entry++)
+                    next_sector[(ut_LSIZE) i * entries_per_sector + entry] = FAT_run.get<ut_DWORD> (entry * sizeof(ut_DWORD));
+
+            i += run_length;
+        }
+    }
+
+    /* The sector following `sector` in its chain. Sectors outside of the table are reported as free. */
+    ut_DWORD next(ut_DWORD sector) const
+    { return sector < table_size ? next_sector[sector] : CFB_FREESECT; }
+
+    /* Whether `sector` is a regular sector that exists in the file. */
+    bool is_valid_sector(ut_DWORD sector) const
+    { return sector < file_sector_count && sector < table_size; }
+
+    /* With the sector cache, ask for the chain starting at `start_sector` to be read ahead; one request per run of adjacent
+     * sectors, and no more than the cache holds. A chain that goes wrong is left for whoever follows it to report.
+     * */
+    void readahead(FileAPI& fapi, const struct _dot_doc_header& WDBF_header, ut_DWORD start_sector) const
+    {
+        if(!fapi.FBWW_is_cached())
+            return;
+
+        ut_LSIZE left = fapi.get_cache_budget() >> WDBF_header.CFB_sector_size;
+        ut_DWORD run_start = start_sector, run_length = 0;
+
+        for(ut_DWORD sector = start_sector, steps = 0; is_valid_sector(sector) && steps < left; sector = next(sector), steps++)
+        {
+            if(run_length > 0 && sector != run_start + run_length)
+            {
+                fapi.FBWW_readahead(WDBF_header.get_sector_offset(run_start), (ut_LSIZE) run_length << WDBF_header.CFB_sector_size);
+                run_start = sector;
+                run_length = 0;
+            }
+
+            if(run_length == 0) run_start = sector;
+            run_length++;
+        }
+
+        if(run_length > 0)
+            fapi.FBWW_readahead(WDBF_header.get_sector_offset(run_start), (ut_LSIZE) run_length << WDBF_header.CFB_sector_size);
+    }
+
+    /* Number of sectors in the chain starting at `start_sector`.
+     * Fails on a chain that leaves the file or loops (a chain can never be longer than the number of sectors in the file).
+     * */
+    ut_DWORD chain_length(ut_DWORD start_sector) const
+    {
+        ut_DWORD length = 0;
+
+        for(ut_DWORD sector = start_sector; sector != CFB_ENDOFCHAIN; sector = next(sector))
+        {
+            dot_doc_assert(is_valid_sector(sector) && length < file_sector_count,
+                "\n%sFAT Error:%s\n\tThe sector chain starting at `0x%X` is broken at sector `0x%X` (after %u sectors).\n",
+                red, white,
+                start_sector, sector, length)
+
+            length++;
+        }
+
+        return length;
+    }
+
+    ut_DWORD get_table_size() const
+    { return table_size; }
+
+    ut_DWORD get_file_sector_count() const
+    { return file_sector_count; }
+
+    const ut_DWORD *get_table() const
+    { return next_sector; }
+};
+
+#endif
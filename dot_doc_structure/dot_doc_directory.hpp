@@ -0,0 +1,349 @@
+#ifndef dot_doc_directory
+#define dot_doc_directory
+
+/* Directory entry layout (128 bytes per entry). */
+#define CFB_dir_entry_size          0x80
+#define CFB_dir_name_max            0x20 // 32 UTF-16 code units, including the terminating null
+#define CFB_dir_name_length         0x40 // Name length in bytes, including the terminating null
+#define CFB_dir_type                0x42
+#define CFB_dir_color               0x43
+#define CFB_dir_left_sibling        0x44
+#define CFB_dir_right_sibling       0x48
+#define CFB_dir_child               0x4C
+#define CFB_dir_start_sector        0x74
+#define CFB_dir_stream_size         0x78
+
+/* No sibling/child; also what lookups return when nothing was found. */
+#define CFB_NOSTREAM                0xFFFFFFFF
+
+enum class dir_entry_type: ut_BYTE
+{
+    unallocated = 0x0,
+    storage     = 0x1,
+    stream      = 0x2,
+    root        = 0x5
+};
+
+/* DotDoc_Directory - the directory stream of the WDBF, decoded into a struct-of-arrays (entry ID = array index).
+ *           Next to the raw red-black tree links, every entry gets the ID of the storage it lives in (`parents`), and a hash
+ *           index keyed by (parent, case-insensitive name) makes looking up a stream by name O(1) instead of a tree walk.
+ *
+ * Variables:
+ *      ut_WORD *names - `CFB_dir_name_max` UTF-16 code units per entry; `name_lengths` holds the number used (without the null).
+ *      ut_BYTE *types/colors - Entry type (`dir_entry_type`) and red-black color.
+ *      ut_DWORD *left_siblings/right_siblings/children - Red-black tree links; `CFB_NOSTREAM` if there is none.
+ *      ut_DWORD *parents - Storage that contains the entry; `CFB_NOSTREAM` for the root and for unreachable entries.
+ *      ut_DWORD *start_sectors, ut_LSIZE *stream_sizes - Where the stream data starts and how big it is.
+ *      ut_DWORD *hash_slots - Open-addressed hash index; entry ID + 1 per slot, zero for an empty slot.
+ *
+ *      The arrays are in the arena of the `FileAPI` the directory was built from; building again reuses them when the new
+ *      directory fits (`entry_capacity`, `slot_capacity`).
+ */
+class DotDoc_Directory
+{
+    /* `DotDoc_Sidecar` writes the arrays out as they are, and reads them back in place. */
+    friend class DotDoc_Sidecar;
+
+private:
+    ut_DWORD entry_count = 0;
+
+    ut_WORD *names = nullptr;
+    ut_BYTE *name_lengths = nullptr;
+    ut_BYTE *types = nullptr;
+    ut_BYTE *colors = nullptr;
+    ut_DWORD *left_siblings = nullptr;
+    ut_DWORD *right_siblings = nullptr;
+    ut_DWORD *children = nullptr;
+    ut_DWORD *parents = nullptr;
+    ut_DWORD *start_sectors = nullptr;
+    ut_LSIZE *stream_sizes = nullptr;
+
+    ut_DWORD *hash_slots = nullptr;
+    ut_DWORD hash_mask = 0;
+
+    DotDoc_Arena *arena = nullptr;
+    ut_DWORD entry_capacity = 0;
+    ut_DWORD slot_capacity = 0;
+
+    /* Names compare case-insensitively (the CFB upper-cases names before comparing them); only ASCII letters are folded. */
+    static ut_WORD fold(ut_WORD code_unit)
+    { return (code_unit >= 'a' && code_unit <= 'z') ? code_unit - ('a' - 'A') : code_unit; }
+
+    /* FNV-1a over the parent ID and the folded name. */
+    template<typename CT>
+    static ut_DWORD hash_name(ut_DWORD parent, const CT *name, ut_BYTE length)
+    {
+        ut_DWORD hash = 0x811C9DC5;
+
+        hash = (hash ^ parent) * 0x01000193;
+        for(ut_BYTE i = 0; i < length; i++)
+            hash = (hash ^ fold((ut_WORD) (std::make_unsigned_t<CT>) name[i])) * 0x01000193;
+
+        return hash;
+    }
+
+    template<typename CT>
+    bool name_matches(ut_DWORD entry, const CT *name, ut_BYTE length)
+    {
+        if(name_lengths[entry] != length)
+            return false;
+
+        for(ut_BYTE i = 0; i < length; i++)
+            if(fold(names[entry * CFB_dir_name_max + i]) != fold((ut_WORD) (std::make_unsigned_t<CT>) name[i]))
+                return false;
+
+        return true;
+    }
+
+    void release()
+    {
+        entry_count = hash_mask = 0;
+    }
+
+    /* Arrays for `entry_count` entries; the ones from the last build if they fit and are in the same arena. */
+    void allocate_entries(DotDoc_Arena& file_arena)
+    {
+        if(arena != &file_arena)
+        {
+            arena = &file_arena;
+            entry_capacity = slot_capacity = 0;
+        }
+
+        if(entry_capacity >= entry_count)
+            return;
+
+        names           = arena->allocate<ut_WORD> ((ut_LSIZE) entry_count * CFB_dir_name_max);
+        name_lengths    = arena->allocate<ut_BYTE> (entry_count);
+        types           = arena->allocate<ut_BYTE> (entry_count);
+        colors          = arena->allocate<ut_BYTE> (entry_count);
+        left_siblings   = arena->allocate<ut_DWORD> (entry_count);
+        right_siblings  = arena->allocate<ut_DWORD> (entry_count);
+        children        = arena->allocate<ut_DWORD> (entry_count);
+        parents         = arena->allocate<ut_DWORD> (entry_count);
+        start_sectors   = arena->allocate<ut_DWORD> (entry_count);
+        stream_sizes    = arena->allocate<ut_LSIZE> (entry_count);
+        entry_capacity  = entry_count;
+    }
+
+    /* A link is followed only if it points at an entry that exists; anything else is treated as no link. */
+    ut_DWORD checked_link(ut_DWORD link)
+    { return link < entry_count ? link : CFB_NOSTREAM; }
+
+    void decode_entry(ut_DWORD entry, FBWW_span raw_entry, bool is_mv3)
+    {
+        ut_WORD name_length = raw_entry.get<ut_WORD> (CFB_dir_name_length);
+
+        /* The length includes the terminating null; anything past 64 bytes, or odd, is a flaw - clamp it. */
+        name_length = name_length >= 2 ? (name_length / 2) - 1 : 0;
+        if(name_length > CFB_dir_name_max - 1) name_length = CFB_dir_name_max - 1;
+
+        for(ut_BYTE i = 0; i < name_length; i++)
+            names[entry * CFB_dir_name_max + i] = raw_entry.get<ut_WORD> (i * sizeof(ut_WORD));
+
+        name_lengths[entry]     = name_length;
+        types[entry]            = raw_entry.get<ut_BYTE> (CFB_dir_type);
+        colors[entry]           = raw_entry.get<ut_BYTE> (CFB_dir_color);
+        left_siblings[entry]    = raw_entry.get<ut_DWORD> (CFB_dir_left_sibling);
+        right_siblings[entry]   = raw_entry.get<ut_DWORD> (CFB_dir_right_sibling);
+        children[entry]         = raw_entry.get<ut_DWORD> (CFB_dir_child);
+        start_sectors[entry]    = raw_entry.get<ut_DWORD> (CFB_dir_start_sector);
+        stream_sizes[entry]     = raw_entry.get<ut_LSIZE> (CFB_dir_stream_size);
+        parents[entry]          = CFB_NOSTREAM;
+
+        /* Major Version 3 files only use the low 32 bits of the size; the high 32 bits may hold garbage. */
+        if(is_mv3) stream_sizes[entry] &= 0xFFFFFFFF;
+    }
+
+    /* Give every entry the storage it lives in, walking each storage's red-black tree of children once.
+     * `parents` doubles as the visited marker, so a corrupted tree that loops can not make this run forever.
+     * */
+    void link_parents()
+    {
+        /* Scratch; given back to the arena once every entry has its parent. */
+        DotDoc_Arena::arena_mark scratch = arena->get_mark();
+
+        ut_DWORD *pending = arena->allocate<ut_DWORD> (entry_count);
+        ut_DWORD pending_count = 0;
+
+        /* Both stacks can hold at most every entry once, since an entry is pushed only when it first gets a parent. */
+        ut_DWORD *storages = arena->allocate<ut_DWORD> (entry_count);
+        ut_DWORD storage_count = 0;
+
+        if(entry_count > 0 && types[0] == (ut_BYTE) dir_entry_type::root)
+            storages[storage_count++] = 0;
+
+        while(storage_count > 0)
+        {
+            ut_DWORD storage = storages[--storage_count];
+            ut_DWORD child = checked_link(children[storage]);
+
+            if(child == CFB_NOSTREAM || child == 0 || parents[child] != CFB_NOSTREAM)
+                continue;
+
+            parents[child] = storage;
+            pending[pending_count++] = child;
+
+            while(pending_count > 0)
+            {
+                ut_DWORD entry = pending[--pending_count];
+
+                if(types[entry] == (ut_BYTE) dir_entry_type::storage)
+                    storages[storage_count++] = entry;
+
+                ut_DWORD siblings[2] = {checked_link(left_siblings[entry]), checked_link(right_siblings[entry])};
+                for(ut_DWORD sibling : siblings)
+                {
+                    if(sibling == CFB_NOSTREAM || sibling == 0 || parents[sibling] != CFB_NOSTREAM)
+                        continue;
+
+                    parents[sibling] = storage;
+                    pending[pending_count++] = sibling;
+                }
+            }
+        }
+
+        arena->rewind(scratch);
+    }
+
+    void build_hash_index()
+    {
+        /* At most half full, so probe sequences stay short. */
+        ut_DWORD slot_count = 16;
+        while(slot_count < entry_count * 2) slot_count <<= 1;
+
+        if(slot_capacity < slot_count)
+        {
+            hash_slots = arena->allocate<ut_DWORD> (slot_count);
+            slot_capacity = slot_count;
+        }
+
+        memset(hash_slots, 0, slot_count * sizeof(ut_DWORD));
+        hash_mask = slot_count - 1;
+
+        for(ut_DWORD entry = 0; entry < entry_count; entry++)
+        {
+            if(types[entry] == (ut_BYTE) dir_entry_type::unallocated || (parents[entry] == CFB_NOSTREAM && entry != 0))
+                continue;
+
+            ut_DWORD slot = hash_name(parents[entry], names + entry * CFB_dir_name_max, name_lengths[entry]) & hash_mask;
+            while(hash_slots[slot] != 0) slot = (slot + 1) & hash_mask;
+
+            hash_slots[slot] = entry + 1;
+        }
+    }
+
+public:
+    DotDoc_Directory() = default;
+    DotDoc_Directory(const DotDoc_Directory&) = delete;
+
+    void build(FileAPI& fapi, const struct _dot_doc_header& WDBF_header, const DotDoc_FAT& WDBF_FAT)
+    {
+        release();
+
+        ut_LSIZE sector_size = WDBF_header.get_sector_size();
+        ut_DWORD entries_per_sector = sector_size / CFB_dir_entry_size;
+        ut_DWORD sector_count = WDBF_FAT.chain_length(WDBF_header.CFB_first_dir_sector_loc);
+        WDBF_FAT.readahead(fapi, WDBF_header, WDBF_header.CFB_first_dir_sector_loc);
+        bool is_mv3 = WDBF_header.CFB_major_version == WDBF_header.mv3;
+
+        entry_count = sector_count * entries_per_sector;
+
+        allocate_entries(fapi.get_arena());
+
+        ut_DWORD entry = 0;
+        for(ut_DWORD sector = WDBF_header.CFB_first_dir_sector_loc; sector != CFB_ENDOFCHAIN; sector = WDBF_FAT.next(sector))
+        {
+            FBWW_span dir_sector{fapi.FBWW_view(WDBF_header.get_sector_offset(sector), sector_size), sector_size};
+            fapi.get_stats().add(stats_counter::sectors_visited);
+
+            for(ut_DWORD i = 0; i < entries_per_sector; i++, entry++)
+                decode_entry(entry, dir_sector.sub(i * CFB_dir_entry_size, CFB_dir_entry_size), is_mv3);
+        }
+
+        dot_doc_assert(entry_count > 0 && types[0] == (ut_BYTE) dir_entry_type::root,
+            "\n%sDirectory Error:%s\n\tThe first directory entry is not the Root Entry.\n",
+            red, white)
+
+        link_parents();
+        build_hash_index();
+    }
+
+    /* Find the entry called `name` inside the storage `parent` (the Root Entry by default).
+     * `name` can be ASCII (`const nt_BYTE *`, e.g. "\005SummaryInformation") or UTF-16 (`const ut_WORD *`), without the null.
+     * Returns `CFB_NOSTREAM` if there is no such entry.
+     * */
+    template<typename CT>
+    ut_DWORD find(const CT *name, ut_BYTE length, ut_DWORD parent = 0)
+    {
+        if(!hash_slots)
+            return CFB_NOSTREAM;
+
+        for(ut_DWORD slot = hash_name(parent, name, length) & hash_mask; hash_slots[slot] != 0; slot = (slot + 1) & hash_mask)
+        {
+            ut_DWORD entry = hash_slots[slot] - 1;
+
+            if(parents[entry] == parent && name_matches(entry, name, length))
+                return entry;
+        }
+
+        return CFB_NOSTREAM;
+    }
+
+    ut_DWORD find(const nt_BYTE *name, ut_DWORD parent = 0)
+    { return find<nt_BYTE> (name, strlen(name), parent); }
+
+    ut_DWORD get_entry_count()
+    { return entry_count; }
+
+    dir_entry_type get_type(ut_DWORD entry)
+    { return (dir_entry_type) types[entry]; }
+
+    ut_DWORD get_parent(ut_DWORD entry)
+    { return parents[entry]; }
+
+    ut_DWORD get_child(ut_DWORD entry)
+    { return children[entry]; }
+
+    ut_DWORD get_left_sibling(ut_DWORD entry)
+    { return left_siblings[entry]; }
+
+    ut_DWORD get_right_sibling(ut_DWORD entry)
+    { return right_siblings[entry]; }
+
+    ut_DWORD get_start_sector(ut_DWORD entry)
+    { return start_sectors[entry]; }
+
+    ut_LSIZE get_stream_size(ut_DWORD entry)
+    { return stream_sizes[entry]; }
+
+    const ut_WORD *get_name(ut_DWORD entry)
+    { return names + entry * CFB_dir_name_max; }
+
+    ut_BYTE get_name_length(ut_DWORD entry)
+    { return name_lengths[entry]; }
+
+    /* Name as printable ASCII; code units outside of printable ASCII become `\ooo` octal escapes (e.g. `\005`). */
+    std::string get_printable_name(ut_DWORD entry)
+    {
+        std::string printable;
+
+        for(ut_BYTE i = 0; i < name_lengths[entry]; i++)
+        {
+            ut_WORD code_unit = names[entry * CFB_dir_name_max + i];
+
+            if(code_unit >= 0x20 && code_unit < 0x7F)
+            {
+                printable.push_back((nt_BYTE) code_unit);
+                continue;
+            }
+
+            nt_BYTE escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\%03o", code_unit & 0x1FF);
+            printable += escaped;
+        }
+
+        return printable;
+    }
+};
+
+#endif
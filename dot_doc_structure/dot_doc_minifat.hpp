@@ -0,0 +1,197 @@
+#ifndef dot_doc_minifat
+#define dot_doc_minifat
+
+/* DotDoc_MiniFAT - the MiniFAT and the mini stream; where every stream smaller than `CFB_mini_stream_cutoff_size` lives.
+ *           Nothing is read until the first call that needs it (`next`, `get_mini_sector_offset`, `view`); a decode that never
+ *           touches a small stream never reads the MiniFAT or walks the Root Entry's chain.
+ *
+ *           The mini stream is the Root Entry's stream, cut into 64-byte mini sectors. Rather than copying it into one buffer,
+ *           the regular sectors of its chain are remembered (`mini_stream_sectors`), so mini sector `n` is found at
+ *           `mini_stream_sectors[n * 64 / sector size]` and every view of it points straight into the file data.
+ *
+ * Variables:
+ *      ut_DWORD *next_mini_sector - MiniFAT next-sector table; like `DotDoc_FAT`, but for mini sectors.
+ *      ut_DWORD *mini_stream_sectors - Regular sectors of the mini stream, in chain order.
+ *          Both are in the arena of the attached `FileAPI`, and reused when the MiniFAT is loaded again and they fit.
+ *      ut_DWORD mini_sector_count - Number of mini sectors in the mini stream.
+ */
+class DotDoc_MiniFAT
+{
+private:
+    FileAPI *fapi = nullptr;
+    const struct _dot_doc_header *WDBF_header = nullptr;
+    const DotDoc_FAT *WDBF_FAT = nullptr;
+    ut_DWORD root_start_sector = CFB_ENDOFCHAIN;
+    ut_LSIZE root_stream_size = 0;
+
+    bool loaded = false;
+    ut_DWORD *next_mini_sector = nullptr;
+    ut_DWORD table_size = 0;
+    ut_DWORD table_capacity = 0;
+    ut_DWORD *mini_stream_sectors = nullptr;
+    ut_DWORD mini_stream_sector_count = 0;
+    ut_DWORD mini_stream_capacity = 0;
+    DotDoc_Arena *table_arena = nullptr;
+    ut_DWORD mini_sector_count = 0;
+
+    /* Mini sectors per regular sector, as a shift; 3 for Major Version 3 (512 / 64), 6 for Major Version 4 (4096 / 64). */
+    ut_BYTE mini_per_sector_shift = 0;
+
+    void release()
+    {
+        table_size = mini_stream_sector_count = mini_sector_count = 0;
+        loaded = false;
+    }
+
+    /* Room for `count` entries in `table` (`capacity` of them so far); the arena is only asked when it does not fit. */
+    ut_DWORD *reserve(ut_DWORD *table, ut_DWORD& capacity, ut_DWORD count)
+    {
+        if(table && capacity >= count)
+            return table;
+
+        capacity = count;
+        return table_arena->allocate<ut_DWORD> (count);
+    }
+
+    void load()
+    {
+        dot_doc_assert(fapi && WDBF_header && WDBF_FAT,
+            "\n%sMiniFAT Error:%s\n\tThe MiniFAT was used before the FAT and directory were decoded.\n",
+            red, white)
+
+        ut_LSIZE sector_size = WDBF_header->get_sector_size();
+        ut_DWORD entries_per_sector = sector_size / sizeof(ut_DWORD);
+        mini_per_sector_shift = WDBF_header->CFB_sector_size - WDBF_header->CFB_mini_sector_size;
+
+        /* MiniFAT; a regular sector chain holding `ut_DWORD` next-mini-sector entries. */
+        ut_DWORD MiniFAT_sectors = WDBF_header->CFB_first_minifat_sector_loc == CFB_ENDOFCHAIN
+            ? 0 : WDBF_FAT->chain_length(WDBF_header->CFB_first_minifat_sector_loc);
+
+        if(MiniFAT_sectors > 0) WDBF_FAT->readahead(*fapi, *WDBF_header, WDBF_header->CFB_first_minifat_sector_loc);
+
+        table_size = MiniFAT_sectors * entries_per_sector;
+        next_mini_sector = reserve(next_mini_sector, table_capacity, table_size);
+
+        ut_DWORD i = 0;
+        for(ut_DWORD sector = WDBF_header->CFB_first_minifat_sector_loc; i < MiniFAT_sectors; sector = WDBF_FAT->next(sector), i++)
+        {
+            FBWW_span MiniFAT_sector{fapi->FBWW_view(WDBF_header->get_sector_offset(sector), sector_size), sector_size};
+
+            if constexpr(std::endian::native == std::endian::little)
+                memcpy(next_mini_sector + (ut_LSIZE) i * entries_per_sector, MiniFAT_sector.data, sector_size);
+            else
+                for(ut_DWORD entry = 0; entry < entries_per_sector; entry++)
+                    next_mini_sector[(ut_LSIZE) i * entries_per_sector + entry] = MiniFAT_sector.get<ut_DWORD> (entry * sizeof(ut_DWORD));
+        }
+
+        /* Mini stream; the Root Entry's regular sector chain. */
+        mini_stream_sector_count = root_start_sector == CFB_ENDOFCHAIN ? 0 : WDBF_FAT->chain_length(root_start_sector);
+        mini_stream_sectors = reserve(mini_stream_sectors, mini_stream_capacity, mini_stream_sector_count);
+        fapi->get_stats().add(stats_counter::sectors_visited, MiniFAT_sectors + mini_stream_sector_count);
+
+        i = 0;
+        for(ut_DWORD sector = root_start_sector; i < mini_stream_sector_count; sector = WDBF_FAT->next(sector), i++)
+            mini_stream_sectors[i] = sector;
+
+        /* The Root Entry's size can not claim more than its chain holds. */
+        ut_LSIZE chain_bytes = (ut_LSIZE) mini_stream_sector_count << WDBF_header->CFB_sector_size;
+        mini_sector_count = (root_stream_size < chain_bytes ? root_stream_size : chain_bytes) >> WDBF_header->CFB_mini_sector_size;
+
+        loaded = true;
+    }
+
+public:
+    DotDoc_MiniFAT() = default;
+    DotDoc_MiniFAT(const DotDoc_MiniFAT&) = delete;
+
+    /* Remember where everything is; nothing is read yet. `root_entry_*` are the Root Entry's start sector and stream size. */
+    void attach(FileAPI& file_API, const struct _dot_doc_header& header, const DotDoc_FAT& FAT,
+                ut_DWORD root_entry_start_sector, ut_LSIZE root_entry_stream_size)
+    {
+        release();
+
+        /* Tables from another file's arena are gone with it. */
+        if(table_arena != &file_API.get_arena())
+        {
+            table_arena = &file_API.get_arena();
+            next_mini_sector = mini_stream_sectors = nullptr;
+            table_capacity = mini_stream_capacity = 0;
+        }
+
+        fapi = &file_API;
+        WDBF_header = &header;
+        WDBF_FAT = &FAT;
+        root_start_sector = root_entry_start_sector;
+        root_stream_size = root_entry_stream_size;
+    }
+
+    bool is_loaded() const
+    { return loaded; }
+
+    /* Streams smaller than the cutoff (4096 bytes) are stored in the mini stream. */
+    bool is_small_stream(ut_LSIZE stream_size) const
+    { return WDBF_header && stream_size < WDBF_header->CFB_mini_stream_cutoff_size; }
+
+    ut_LSIZE get_mini_sector_size() const
+    { return WDBF_header ? 1ULL << WDBF_header->CFB_mini_sector_size : 0; }
+
+    /* The mini sector following `mini_sector` in its chain. Mini sectors outside of the MiniFAT are reported as free. */
+    ut_DWORD next(ut_DWORD mini_sector)
+    {
+        if(!loaded) load();
+        return mini_sector < table_size ? next_mini_sector[mini_sector] : CFB_FREESECT;
+    }
+
+    bool is_valid_mini_sector(ut_DWORD mini_sector)
+    {
+        if(!loaded) load();
+        return mini_sector < mini_sector_count && mini_sector < table_size;
+    }
+
+    /* File offset of the first byte of `mini_sector`. */
+    ut_LSIZE get_mini_sector_offset(ut_DWORD mini_sector)
+    {
+        dot_doc_assert(is_valid_mini_sector(mini_sector),
+            "\n%sMiniFAT Error:%s\n\tMini sector `0x%X` is outside of the mini stream (%u mini sectors).\n",
+            red, white,
+            mini_sector, mini_sector_count)
+
+        ut_DWORD sector = mini_stream_sectors[mini_sector >> mini_per_sector_shift];
+        ut_LSIZE within_sector = ((ut_LSIZE) mini_sector & ((1U << mini_per_sector_shift) - 1)) << WDBF_header->CFB_mini_sector_size;
+
+        return WDBF_header->get_sector_offset(sector) + within_sector;
+    }
+
+    /* View of the 64 bytes of `mini_sector`; points into the file data, nothing is copied. */
+    FBWW_span view(ut_DWORD mini_sector)
+    {
+        ut_LSIZE mini_sector_size = get_mini_sector_size();
+        return FBWW_span{fapi->FBWW_view(get_mini_sector_offset(mini_sector), mini_sector_size), mini_sector_size};
+    }
+
+    /* Number of mini sectors in the chain starting at `start_mini_sector`; fails on chains that leave the mini stream or loop. */
+    ut_DWORD chain_length(ut_DWORD start_mini_sector)
+    {
+        ut_DWORD length = 0;
+
+        for(ut_DWORD mini_sector = start_mini_sector; mini_sector != CFB_ENDOFCHAIN; mini_sector = next(mini_sector))
+        {
+            dot_doc_assert(is_valid_mini_sector(mini_sector) && length < mini_sector_count,
+                "\n%sMiniFAT Error:%s\n\tThe mini sector chain starting at `0x%X` is broken at mini sector `0x%X` (after %u mini sectors).\n",
+                red, white,
+                start_mini_sector, mini_sector, length)
+
+            length++;
+        }
+
+        return length;
+    }
+
+    ut_DWORD get_mini_sector_count()
+    {
+        if(!loaded) load();
+        return mini_sector_count;
+    }
+};
+
+#endif
@@ -0,0 +1,508 @@
+#ifndef dot_doc_sidecar
+#define dot_doc_sidecar
+
+/* DotDoc_Sidecar - a sidecar index; what `DotDoc_File::decode` builds before it gets to the streams (the repaired heading, the
+ *           flaws found in it, the FAT next-sector table and the directory arrays), saved to a file of its own so that a later
+ *           decode of the same file maps it and goes straight to the streams.
+ *
+ *           The index is keyed by the size and mtime of the file and by a hash (FNV-1a) of its header block, DIFAT, FAT and
+ *           directory sectors as found (the sectors of the streams are not hashed); a key that does not match is a miss, and
+ *           the index is built, and saved again, as usual. Everything is laid out as it is held in memory (native byte order,
+ *           `dot_doc_sidecar_alignment`-aligned sections), so on a hit the FAT and the directory point straight into the
+ *           mapping; nothing is copied or parsed. Everything the decode relies on (bounds, the hash index and that it can not
+ *           fill up) is checked before the index is used, so a damaged index is a miss as well, never a crash.
+ *
+ *           Indexes are written to a temporary file and renamed into place, so two workers saving the same index never leave a
+ *           torn one behind. Failing to save one is not an error; the next decode just builds everything again.
+ *
+ *           Layout (version 1):
+ *               sidecar_head                                    - Key, repaired heading, counts and section offsets.
+ *               FAT                                             - `FAT_table_size` next-sector entries.
+ *               directory                                       - The arrays of `DotDoc_Directory`, in `directory_layout` order.
+ *               flaws                                           - `record_count` `sidecar_record`s.
+ *
+ * Variables:
+ *      ut_BYTE *mapping, ut_LSIZE mapping_size - The index the open file's FAT and directory point into; unmapped with the file.
+ */
+#define dot_doc_sidecar_version     1
+#define dot_doc_sidecar_suffix      ".wdbfidx"
+#define dot_doc_sidecar_alignment   16
+
+/* What an index has to match to be used for a file (`DotDoc_Sidecar::get_key`). */
+struct dot_doc_sidecar_key
+{
+    ut_LSIZE file_size;
+    ut_LSIZE file_mtime_ns;
+    ut_LSIZE content_hash;
+};
+
+class DotDoc_Sidecar
+{
+private:
+    static constexpr ut_BYTE sidecar_magic[8] = {'W', 'D', 'B', 'F', 'I', 'D', 'X', 0};
+
+    struct sidecar_head
+    {
+        ut_BYTE     magic[8];
+        ut_DWORD    version;
+        ut_DWORD    head_size;
+        ut_LSIZE    sidecar_size;
+        ut_LSIZE    file_size;
+        ut_LSIZE    file_mtime_ns;
+        ut_LSIZE    content_hash;
+
+        /* The heading, as repaired. */
+        ut_BYTE     header_sig[WDBF_header_sig_length];
+        ut_BYTE     padding[WDBF_PL_header_sig];
+        ut_BYTE     reserved[WDBF_RPL_header_sig];
+        ut_WORD     CFB_minor_version;
+        ut_WORD     CFB_major_version;
+        ut_WORD     CFB_byte_order_indication;
+        ut_WORD     CFB_sector_size;
+        ut_WORD     CFB_mini_sector_size;
+        ut_DWORD    CFB_number_of_dir_sectors;
+        ut_DWORD    CFB_number_of_FAT_sectors;
+        ut_DWORD    CFB_first_dir_sector_loc;
+        ut_DWORD    CFB_transaction_sig_number;
+        ut_DWORD    CFB_mini_stream_cutoff_size;
+        ut_DWORD    CFB_first_minifat_sector_loc;
+        ut_DWORD    CFB_number_of_minifat_sectors;
+        ut_DWORD    CFB_first_DIFAT_sector_loc;
+        ut_DWORD    CFB_number_of_DIFAT_sectors;
+        ut_DWORD    CFB_header_DIFAT[WDBF_header_DIFAT_entries];
+
+        ut_DWORD    FAT_table_size;
+        ut_DWORD    file_sector_count;
+        ut_DWORD    entry_count;
+        ut_DWORD    hash_slot_count;
+        ut_DWORD    record_count;
+        ut_DWORD    unused;
+
+        ut_LSIZE    FAT_offset;
+        ut_LSIZE    directory_offset;
+        ut_LSIZE    records_offset;
+    };
+
+    struct sidecar_record
+    {
+        ut_LSIZE    offset;
+        ut_LSIZE    found;
+        ut_LSIZE    expected;
+        ut_DWORD    error;
+        ut_BYTE     size;
+        ut_BYTE     fixed;
+        ut_BYTE     unused[2];
+    };
+
+    /* Offsets of the directory arrays, relative to the start of the section, and (last) the size of the section. */
+    enum directory_array : ut_BYTE
+    {
+        names = 0, name_lengths, types, colors, left_siblings, right_siblings, children, parents, start_sectors, stream_sizes,
+        hash_slots, section_size
+    };
+
+    ut_BYTE *mapping = nullptr;
+    ut_LSIZE mapping_size = 0;
+
+    static ut_LSIZE align(ut_LSIZE size)
+    { return (size + dot_doc_sidecar_alignment - 1) & ~(ut_LSIZE) (dot_doc_sidecar_alignment - 1); }
+
+    static void directory_layout(ut_LSIZE entry_count, ut_LSIZE slot_count, ut_LSIZE (&offsets)[directory_array::section_size + 1])
+    {
+        const ut_LSIZE sizes[directory_array::section_size] = {
+            entry_count * CFB_dir_name_max * sizeof(ut_WORD), entry_count, entry_count, entry_count,
+            entry_count * sizeof(ut_DWORD), entry_count * sizeof(ut_DWORD), entry_count * sizeof(ut_DWORD),
+            entry_count * sizeof(ut_DWORD), entry_count * sizeof(ut_DWORD), entry_count * sizeof(ut_LSIZE),
+            slot_count * sizeof(ut_DWORD)
+        };
+
+        offsets[0] = 0;
+        for(ut_BYTE array = 0; array < directory_array::section_size; array++)
+            offsets[array + 1] = offsets[array] + align(sizes[array]);
+    }
+
+    static ut_LSIZE hash_bytes(const ut_BYTE *data, ut_LSIZE size, ut_LSIZE hash = 0xCBF29CE484222325ULL)
+    {
+        for(ut_LSIZE i = 0; i < size; i++)
+            hash = (hash ^ data[i]) * 0x100000001B3ULL;
+
+        return hash;
+    }
+
+    /* Whether `offset` starts an aligned section of `size` bytes inside an index of `sidecar_size` bytes. */
+    static bool fits(ut_LSIZE offset, ut_LSIZE size, ut_LSIZE sidecar_size)
+    { return offset % dot_doc_sidecar_alignment == 0 && offset <= sidecar_size && size <= sidecar_size - offset; }
+
+    /* Everything `adopt` relies on; any of it off, and the index is not used. */
+    static bool is_usable(const sidecar_head& head, const ut_BYTE *data, const struct dot_doc_sidecar_key& key)
+    {
+        if(memcmp(head.magic, sidecar_magic, sizeof(sidecar_magic)) != 0 || head.version != dot_doc_sidecar_version ||
+           head.head_size != sizeof(sidecar_head))
+            return false;
+
+        if(head.file_size != key.file_size || head.file_mtime_ns != key.file_mtime_ns || head.content_hash != key.content_hash)
+            return false;
+
+        if(head.CFB_sector_size != 9 && head.CFB_sector_size != 12)
+            return false;
+
+        ut_LSIZE sector_size = 1ULL << head.CFB_sector_size;
+        ut_LSIZE file_sectors = head.file_size <= sector_size ? 0 : (head.file_size - 1) >> head.CFB_sector_size;
+
+        if((ut_LSIZE) head.CFB_number_of_FAT_sectors * (sector_size / sizeof(ut_DWORD)) != head.FAT_table_size ||
+           head.file_sector_count != file_sectors)
+            return false;
+
+        /* The hash index has to keep an empty slot, or a lookup that finds nothing would never stop. */
+        if(head.entry_count == 0 || head.hash_slot_count < 16 || (head.hash_slot_count & (head.hash_slot_count - 1)) != 0 ||
+           head.hash_slot_count < (ut_LSIZE) head.entry_count * 2)
+            return false;
+
+        ut_LSIZE layout[directory_array::section_size + 1];
+        directory_layout(head.entry_count, head.hash_slot_count, layout);
+
+        if(!fits(head.FAT_offset, (ut_LSIZE) head.FAT_table_size * sizeof(ut_DWORD), head.sidecar_size) ||
+           !fits(head.directory_offset, layout[directory_array::section_size], head.sidecar_size) ||
+           !fits(head.records_offset, (ut_LSIZE) head.record_count * sizeof(sidecar_record), head.sidecar_size) ||
+           head.record_count > error_log_chunk_size * error_log_max_chunks)
+            return false;
+
+        const ut_BYTE *directory = data + head.directory_offset;
+        const ut_BYTE *name_lengths = directory + layout[directory_array::name_lengths];
+        const ut_DWORD *parents = (const ut_DWORD *) (directory + layout[directory_array::parents]);
+        const ut_DWORD *slots = (const ut_DWORD *) (directory + layout[directory_array::hash_slots]);
+
+        if(directory[layout[directory_array::types]] != (ut_BYTE) dir_entry_type::root)
+            return false;
+
+        for(ut_DWORD entry = 0; entry < head.entry_count; entry++)
+            if(name_lengths[entry] >= CFB_dir_name_max || (parents[entry] >= head.entry_count && parents[entry] != CFB_NOSTREAM))
+                return false;
+
+        for(ut_DWORD slot = 0; slot < head.hash_slot_count; slot++)
+            if(slots[slot] > head.entry_count)
+                return false;
+
+        return true;
+    }
+
+    void unmap()
+    {
+        if(mapping) munmap(mapping, mapping_size);
+
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+
+    /* Point everything at the mapping; `is_usable` has checked all of it. */
+    void adopt(const sidecar_head& head, DotDoc_Header& WDBFH, DotDoc_FAT& WDBF_FAT, DotDoc_Directory& WDBF_directory)
+    {
+        struct _dot_doc_header& heading = *WDBFH.WDBF_header;
+
+        memcpy(heading.header_sig, head.header_sig, sizeof(head.header_sig));
+        memcpy(heading.padding, head.padding, sizeof(head.padding));
+        memcpy(heading.reserved, head.reserved, sizeof(head.reserved));
+        heading.CFB_minor_version               = head.CFB_minor_version;
+        heading.CFB_major_version               = head.CFB_major_version;
+        heading.CFB_byte_order_indication       = head.CFB_byte_order_indication;
+        heading.CFB_sector_size                 = head.CFB_sector_size;
+        heading.CFB_mini_sector_size            = head.CFB_mini_sector_size;
+        heading.CFB_number_of_dir_sectors       = head.CFB_number_of_dir_sectors;
+        heading.CFB_number_of_FAT_sectors       = head.CFB_number_of_FAT_sectors;
+        heading.CFB_first_dir_sector_loc        = head.CFB_first_dir_sector_loc;
+        heading.CFB_transaction_sig_number      = head.CFB_transaction_sig_number;
+        heading.CFB_mini_stream_cutoff_size     = head.CFB_mini_stream_cutoff_size;
+        heading.CFB_first_minifat_sector_loc    = head.CFB_first_minifat_sector_loc;
+        heading.CFB_number_of_minifat_sectors   = head.CFB_number_of_minifat_sectors;
+        heading.CFB_first_DIFAT_sector_loc      = head.CFB_first_DIFAT_sector_loc;
+        heading.CFB_number_of_DIFAT_sectors     = head.CFB_number_of_DIFAT_sectors;
+        memcpy(heading.CFB_header_DIFAT, head.CFB_header_DIFAT, sizeof(head.CFB_header_DIFAT));
+
+        const sidecar_record *records = (const sidecar_record *) (mapping + head.records_offset);
+        for(ut_DWORD i = 0; i < head.record_count; i++)
+            WDBFH.err_log->record((enum error_type) records[i].error, records[i].offset, records[i].size, records[i].found,
+                records[i].expected, records[i].fixed);
+
+        /* Not in an arena; building either of them again allocates anew. */
+        WDBF_FAT.next_sector = (ut_DWORD *) (mapping + head.FAT_offset);
+        WDBF_FAT.table_size = head.FAT_table_size;
+        WDBF_FAT.file_sector_count = head.file_sector_count;
+        WDBF_FAT.table_capacity = 0;
+        WDBF_FAT.table_arena = nullptr;
+
+        ut_LSIZE layout[directory_array::section_size + 1];
+        directory_layout(head.entry_count, head.hash_slot_count, layout);
+        ut_BYTE *directory = mapping + head.directory_offset;
+
+        WDBF_directory.entry_count      = head.entry_count;
+        WDBF_directory.names            = (ut_WORD *) (directory + layout[directory_array::names]);
+        WDBF_directory.name_lengths     = directory + layout[directory_array::name_lengths];
+        WDBF_directory.types            = directory + layout[directory_array::types];
+        WDBF_directory.colors           = directory + layout[directory_array::colors];
+        WDBF_directory.left_siblings    = (ut_DWORD *) (directory + layout[directory_array::left_siblings]);
+        WDBF_directory.right_siblings   = (ut_DWORD *) (directory + layout[directory_array::right_siblings]);
+        WDBF_directory.children         = (ut_DWORD *) (directory + layout[directory_array::children]);
+        WDBF_directory.parents          = (ut_DWORD *) (directory + layout[directory_array::parents]);
+        WDBF_directory.start_sectors    = (ut_DWORD *) (directory + layout[directory_array::start_sectors]);
+        WDBF_directory.stream_sizes     = (ut_LSIZE *) (directory + layout[directory_array::stream_sizes]);
+        WDBF_directory.hash_slots       = (ut_DWORD *) (directory + layout[directory_array::hash_slots]);
+        WDBF_directory.hash_mask        = head.hash_slot_count - 1;
+        WDBF_directory.arena            = nullptr;
+        WDBF_directory.entry_capacity   = WDBF_directory.slot_capacity = 0;
+    }
+
+public:
+    DotDoc_Sidecar() = default;
+    DotDoc_Sidecar(const DotDoc_Sidecar&) = delete;
+
+    /* Fold the DIFAT sectors, the FAT sectors and the directory sectors of the file into `hash`, as they are in the file; the
+     * heading is not parsed yet, so they are found from the header block as it is. Locations past the end of the file end a
+     * chain, and no chain is followed for more steps than the file has sectors. A sector size other than 512 or 4096 leaves
+     * the hash as it is; such a file gets its header repaired, which the header block already tells apart.
+     * */
+    static ut_LSIZE hash_structure(FileAPI& fapi, ut_LSIZE hash)
+    {
+        ut_WORD sector_shift = fapi.read_le_at<ut_WORD> ((ut_LSIZE) data_locations::WDBF_SS);
+        if(sector_shift != 9 && sector_shift != 12)
+            return hash;
+
+        ut_LSIZE loaded_size = fapi.get_loaded_size();
+        ut_DWORD sector_size = 1U << sector_shift;
+        ut_DWORD sector_count = loaded_size > sector_size ? (ut_DWORD) ((loaded_size - 1) >> sector_shift) : 0;
+        ut_DWORD entries_per_sector = sector_size / sizeof(ut_DWORD);
+
+        /* Hashes `sector` (the part of it in the file, when it is the last one); returns its length, 0 for a sector not in
+         * the file.
+         * */
+        auto hash_sector = [&](ut_DWORD sector) -> ut_LSIZE
+        {
+            if(sector >= sector_count) return 0;
+
+            ut_LSIZE offset = ((ut_LSIZE) sector + 1) << sector_shift;
+            ut_LSIZE length = loaded_size - offset < sector_size ? loaded_size - offset : sector_size;
+            hash = hash_bytes(fapi.FBWW_view(offset, length), length, hash);
+            return length;
+        };
+
+        /* The FAT sector locations; the first 109 in the header block, the rest in the DIFAT chain. */
+        ut_DWORD FAT_sector_total = fapi.read_le_at<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NOFS);
+        if(FAT_sector_total > sector_count) FAT_sector_total = sector_count;
+
+        std::vector<ut_DWORD> FAT_sectors;
+        FAT_sectors.reserve(FAT_sector_total);
+
+        for(ut_DWORD i = 0; i < FAT_sector_total && i < WDBF_header_DIFAT_entries; i++)
+            FAT_sectors.push_back(fapi.read_le_at<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FSL + i * sizeof(ut_DWORD)));
+
+        ut_DWORD DIFAT_sector = fapi.read_le_at<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FDFSL);
+        ut_DWORD DIFAT_sector_total = fapi.read_le_at<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_NODFS);
+
+        for(ut_DWORD DIFAT_sectors_read = 0; FAT_sectors.size() < FAT_sector_total && DIFAT_sectors_read < DIFAT_sector_total
+            && DIFAT_sectors_read < sector_count; DIFAT_sectors_read++)
+        {
+            if(hash_sector(DIFAT_sector) != sector_size)
+                break;
+
+            /* Views with the sector cache only last until the next view; the entries are read positionally. */
+            ut_LSIZE DIFAT_offset = ((ut_LSIZE) DIFAT_sector + 1) << sector_shift;
+            for(ut_DWORD i = 0; i < entries_per_sector - 1 && FAT_sectors.size() < FAT_sector_total; i++)
+                FAT_sectors.push_back(fapi.read_le_at<ut_DWORD> (DIFAT_offset + i * sizeof(ut_DWORD)));
+
+            DIFAT_sector = fapi.read_le_at<ut_DWORD> (DIFAT_offset + (entries_per_sector - 1) * sizeof(ut_DWORD));
+        }
+
+        for(ut_DWORD FAT_sector : FAT_sectors)
+            hash_sector(FAT_sector);
+
+        /* The directory chain, followed through the FAT as it is in the file. */
+        ut_DWORD dir_sector = fapi.read_le_at<ut_DWORD> ((ut_LSIZE) data_locations::WDBF_FDSL);
+
+        for(ut_DWORD steps = 0; steps < sector_count && hash_sector(dir_sector); steps++)
+        {
+            ut_DWORD FAT_index = dir_sector / entries_per_sector;
+            if(FAT_index >= FAT_sectors.size() || FAT_sectors[FAT_index] >= sector_count)
+                break;
+
+            ut_LSIZE entry_offset = (((ut_LSIZE) FAT_sectors[FAT_index] + 1) << sector_shift)
+                + (dir_sector % entries_per_sector) * sizeof(ut_DWORD);
+            if(entry_offset + sizeof(ut_DWORD) > loaded_size)
+                break;
+
+            dir_sector = fapi.read_le_at<ut_DWORD> (entry_offset);
+        }
+
+        return hash;
+    }
+
+    /* The key of the file `fapi` has open; false for a file too small to have a header block, or one that can not be `fstat`ed.
+     * Call it before the heading is parsed; the hash is of the header block, the DIFAT, the FAT and the directory sectors as
+     * they are in the file, before any repair (`hash_structure`), so an edit that rewrites any of them is a miss even when it
+     * keeps the size and the mtime of the file. Any other sector is not part of the key.
+     * */
+    static bool get_key(FileAPI& fapi, struct dot_doc_sidecar_key& key)
+    {
+        struct stat file_stat;
+
+        if(fapi.get_loaded_size() < WDBF_header_block_size || !fapi.FBWW_get_stat(file_stat))
+            return false;
+
+        key.file_size = fapi.get_size();
+        key.file_mtime_ns = (ut_LSIZE) file_stat.st_mtim.tv_sec * 1000000000ULL + file_stat.st_mtim.tv_nsec;
+        key.content_hash = hash_structure(fapi, hash_bytes(fapi.FBWW_view(0, WDBF_header_block_size), WDBF_header_block_size));
+
+        return true;
+    }
+
+    /* Where the index of `file_path` goes in `directory`; named after a hash of the absolute path, so any number of files can
+     * share the directory. Snapshots (`DotDoc_Snapshot`) are named the same way, with their own `suffix`.
+     * */
+    static std::string get_path(const nt_BYTE *directory, const std::string& file_path, const nt_BYTE *suffix = dot_doc_sidecar_suffix)
+    {
+        std::error_code absolute_error;
+        std::string absolute_path = std::filesystem::absolute(file_path, absolute_error).string();
+        if(absolute_error) absolute_path = file_path;
+
+        nt_BYTE name[24];
+        snprintf(name, sizeof(name), "%016llx", hash_bytes(ut_BYTE_CPTR absolute_path.c_str(), absolute_path.size()));
+
+        return std::string(directory) + "/" + name + suffix;
+    }
+
+    /* Map the index at `path` and, if it matches `key`, fill in the heading and the flaws of `WDBFH`, `WDBF_FAT` and
+     * `WDBF_directory` from it. Returns false, with nothing touched, when there is no usable index.
+     * */
+    bool load(const nt_BYTE *path, const struct dot_doc_sidecar_key& key, DotDoc_Header& WDBFH, DotDoc_FAT& WDBF_FAT, DotDoc_Directory& WDBF_directory)
+    {
+        if constexpr(std::endian::native != std::endian::little)
+            return false;
+
+        unmap();
+
+        nt_DWORD sidecar = open(path, O_RDONLY | O_CLOEXEC);
+        if(sidecar < 0)
+            return false;
+
+        struct stat sidecar_stat;
+        if(fstat(sidecar, &sidecar_stat) != 0 || (ut_LSIZE) sidecar_stat.st_size < sizeof(sidecar_head))
+        {
+            close(sidecar);
+            return false;
+        }
+
+        /* Populated up front; every stream opened next walks the FAT, and faulting it in a page at a time costs more. */
+        void *sidecar_mapping = mmap(NULL, sidecar_stat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, sidecar, 0);
+        close(sidecar);
+
+        if(sidecar_mapping == MAP_FAILED)
+            return false;
+
+        mapping = ut_BYTE_PTR sidecar_mapping;
+        mapping_size = sidecar_stat.st_size;
+
+        const sidecar_head& head = *(const sidecar_head *) mapping;
+        if(head.sidecar_size != mapping_size || !is_usable(head, mapping, key))
+        {
+            unmap();
+            return false;
+        }
+
+        adopt(head, WDBFH, WDBF_FAT, WDBF_directory);
+        return true;
+    }
+
+    /* Save what `WDBFH`, `WDBF_FAT` and `WDBF_directory` built for the file of `key` to `path`. Returns whether it got saved. */
+    static bool save(const nt_BYTE *path, const struct dot_doc_sidecar_key& key, DotDoc_Header& WDBFH, DotDoc_FAT& WDBF_FAT,
+                     DotDoc_Directory& WDBF_directory)
+    {
+        if constexpr(std::endian::native != std::endian::little)
+            return false;
+
+        const struct _dot_doc_header& heading = *WDBFH.WDBF_header;
+        error_log& err_log = *WDBFH.err_log;
+        ut_DWORD slot_count = WDBF_directory.hash_mask + 1;
+
+        if(!WDBF_directory.hash_slots || WDBF_directory.entry_count == 0)
+            return false;
+
+        ut_LSIZE layout[directory_array::section_size + 1];
+        directory_layout(WDBF_directory.entry_count, slot_count, layout);
+
+        sidecar_head head;
+        memset(&head, 0, sizeof(head));
+        memcpy(head.magic, sidecar_magic, sizeof(sidecar_magic));
+        head.version = dot_doc_sidecar_version;
+        head.head_size = sizeof(sidecar_head);
+        head.file_size = key.file_size;
+        head.file_mtime_ns = key.file_mtime_ns;
+        head.content_hash = key.content_hash;
+
+        memcpy(head.header_sig, heading.header_sig, sizeof(head.header_sig));
+        memcpy(head.padding, heading.padding, sizeof(head.padding));
+        memcpy(head.reserved, heading.reserved, sizeof(head.reserved));
+        head.CFB_minor_version              = heading.CFB_minor_version;
+        head.CFB_major_version              = heading.CFB_major_version;
+        head.CFB_byte_order_indication      = heading.CFB_byte_order_indication;
+        head.CFB_sector_size                = heading.CFB_sector_size;
+        head.CFB_mini_sector_size           = heading.CFB_mini_sector_size;
+        head.CFB_number_of_dir_sectors      = heading.CFB_number_of_dir_sectors;
+        head.CFB_number_of_FAT_sectors      = heading.CFB_number_of_FAT_sectors;
+        head.CFB_first_dir_sector_loc       = heading.CFB_first_dir_sector_loc;
+        head.CFB_transaction_sig_number     = heading.CFB_transaction_sig_number;
+        head.CFB_mini_stream_cutoff_size    = heading.CFB_mini_stream_cutoff_size;
+        head.CFB_first_minifat_sector_loc   = heading.CFB_first_minifat_sector_loc;
+        head.CFB_number_of_minifat_sectors  = heading.CFB_number_of_minifat_sectors;
+        head.CFB_first_DIFAT_sector_loc     = heading.CFB_first_DIFAT_sector_loc;
+        head.CFB_number_of_DIFAT_sectors    = heading.CFB_number_of_DIFAT_sectors;
+        memcpy(head.CFB_header_DIFAT, heading.CFB_header_DIFAT, sizeof(head.CFB_header_DIFAT));
+
+        head.FAT_table_size = WDBF_FAT.table_size;
+        head.file_sector_count = WDBF_FAT.file_sector_count;
+        head.entry_count = WDBF_directory.entry_count;
+        head.hash_slot_count = slot_count;
+        head.record_count = err_log.get_record_count();
+
+        head.FAT_offset = align(sizeof(sidecar_head));
+        head.directory_offset = head.FAT_offset + align((ut_LSIZE) head.FAT_table_size * sizeof(ut_DWORD));
+        head.records_offset = head.directory_offset + layout[directory_array::section_size];
+        head.sidecar_size = head.records_offset + (ut_LSIZE) head.record_count * sizeof(sidecar_record);
+
+        ut_BYTE *index = new ut_BYTE[head.sidecar_size]();
+        memcpy(index, &head, sizeof(head));
+        memcpy(index + head.FAT_offset, WDBF_FAT.next_sector, (ut_LSIZE) head.FAT_table_size * sizeof(ut_DWORD));
+
+        ut_BYTE *directory = index + head.directory_offset;
+        ut_LSIZE entries = WDBF_directory.entry_count;
+        memcpy(directory + layout[directory_array::names], WDBF_directory.names, entries * CFB_dir_name_max * sizeof(ut_WORD));
+        memcpy(directory + layout[directory_array::name_lengths], WDBF_directory.name_lengths, entries);
+        memcpy(directory + layout[directory_array::types], WDBF_directory.types, entries);
+        memcpy(directory + layout[directory_array::colors], WDBF_directory.colors, entries);
+        memcpy(directory + layout[directory_array::left_siblings], WDBF_directory.left_siblings, entries * sizeof(ut_DWORD));
+        memcpy(directory + layout[directory_array::right_siblings], WDBF_directory.right_siblings, entries * sizeof(ut_DWORD));
+        memcpy(directory + layout[directory_array::children], WDBF_directory.children, entries * sizeof(ut_DWORD));
+        memcpy(directory + layout[directory_array::parents], WDBF_directory.parents, entries * sizeof(ut_DWORD));
+        memcpy(directory + layout[directory_array::start_sectors], WDBF_directory.start_sectors, entries * sizeof(ut_DWORD));
+        memcpy(directory + layout[directory_array::stream_sizes], WDBF_directory.stream_sizes, entries * sizeof(ut_LSIZE));
+        memcpy(directory + layout[directory_array::hash_slots], WDBF_directory.hash_slots, (ut_LSIZE) slot_count * sizeof(ut_DWORD));
+
+        sidecar_record *records = (sidecar_record *) (index + head.records_offset);
+        for(ut_DWORD i = 0; i < head.record_count; i++)
+        {
+            struct error_record record;
+            while(!err_log.get_record(i, record)) std::this_thread::yield();
+
+            records[i] = sidecar_record{record.offset, record.found, record.expected, (ut_DWORD) record.error, record.size, record.fixed, {0, 0}};
+        }
+
+        /* Whoever maps `path` sees a whole index or none. */
+        struct iovec whole_index{index, head.sidecar_size};
+        bool saved = FBWW_replace_file(path, &whole_index, 1);
+
+        delete[] index;
+        return saved;
+    }
+
+    ~DotDoc_Sidecar()
+    { unmap(); }
+};
+
+#endif
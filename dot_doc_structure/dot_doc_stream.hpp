@@ -0,0 +1,269 @@
+#ifndef dot_doc_stream
+#define dot_doc_stream
+
+/* A run of a stream that is contiguous in the file. */
+struct stream_extent
+{
+    ut_LSIZE    file_offset = 0;
+    ut_LSIZE    size = 0;
+};
+
+/* DotDoc_Stream - a stream of the WDBF (e.g. `WordDocument`), as a list of contiguous extents.
+ *           Opening a stream follows its chain once (through the FAT, or the MiniFAT for streams smaller than the cutoff)
+ *           and merges every run of sectors that are adjacent in the file into one extent. Views of an extent point straight
+ *           into the file data, so consumers can work on the stream in place; the only time stream data gets copied is when a
+ *           caller asks for it (`copy`), or a `view` straddles two extents (or, with the sector cache, two cache blocks).
+ *
+ * Variables:
+ *      std::vector<stream_extent> extents - The extents, in stream order; together they are exactly `stream_size` bytes.
+ *      std::vector<ut_LSIZE> extent_offsets - Stream offset of the first byte of each extent.
+ */
+class DotDoc_Stream
+{
+private:
+    FileAPI *fapi = nullptr;
+    std::vector<stream_extent> extents;
+    std::vector<ut_LSIZE> extent_offsets;
+    ut_LSIZE stream_size = 0;
+
+    void add_extent(ut_LSIZE file_offset, ut_LSIZE length)
+    {
+        dot_doc_assert(file_offset <= fapi->get_loaded_size() && length <= fapi->get_loaded_size() - file_offset,
+            "\n%sStream Error:%s\n\tAn extent of %llX bytes at offset %llX is outside of the %llX byte WDBF.\n",
+            red, white,
+            length, file_offset, fapi->get_loaded_size())
+
+        /* Adjacent in the file to the last extent; grow it instead of starting a new one. */
+        if(!extents.empty() && extents.back().file_offset + extents.back().size == file_offset)
+        {
+            extents.back().size += length;
+            return;
+        }
+
+        extent_offsets.push_back(extents.empty() ? 0 : extent_offsets.back() + extents.back().size);
+        extents.push_back(stream_extent{file_offset, length});
+    }
+
+    /* Index of the extent holding stream offset `offset`. */
+    ut_DWORD find_extent(ut_LSIZE offset)
+    {
+        ut_DWORD low = 0, high = extents.size();
+
+        while(high - low > 1)
+        {
+            ut_DWORD middle = (low + high) / 2;
+
+            if(extent_offsets[middle] <= offset) low = middle;
+            else high = middle;
+        }
+
+        return low;
+    }
+
+public:
+    DotDoc_Stream() = default;
+
+    /* Follow the chain starting at `start_sector` for `size` bytes. Small streams (`MiniFAT.is_small_stream`) are followed
+     * through the MiniFAT, which gets loaded if this is the first small stream opened.
+     * */
+    void open(FileAPI& file_API, const struct _dot_doc_header& WDBF_header, const DotDoc_FAT& WDBF_FAT, DotDoc_MiniFAT& WDBF_MiniFAT,
+              ut_DWORD start_sector, ut_LSIZE size)
+    {
+        fapi = &file_API;
+        extents.clear();
+        extent_offsets.clear();
+        stream_size = size;
+
+        ut_LSIZE left = size;
+
+        if(WDBF_MiniFAT.is_small_stream(size))
+        {
+            ut_LSIZE mini_sector_size = WDBF_MiniFAT.get_mini_sector_size();
+            ut_DWORD steps = 0;
+
+            for(ut_DWORD mini_sector = start_sector; left > 0; mini_sector = WDBF_MiniFAT.next(mini_sector), steps++)
+            {
+                dot_doc_assert(WDBF_MiniFAT.is_valid_mini_sector(mini_sector) && steps < WDBF_MiniFAT.get_mini_sector_count(),
+                    "\n%sStream Error:%s\n\tThe mini sector chain starting at `0x%X` ended at `0x%X` with %llu of %llu bytes left to read.\n",
+                    red, white,
+                    start_sector, mini_sector, left, size)
+
+                ut_LSIZE length = left < mini_sector_size ? left : mini_sector_size;
+                add_extent(WDBF_MiniFAT.get_mini_sector_offset(mini_sector), length);
+                left -= length;
+            }
+
+            fapi->get_stats().add(stats_counter::sectors_visited, steps);
+            prefetch();
+            return;
+        }
+
+        ut_LSIZE sector_size = WDBF_header.get_sector_size();
+        ut_DWORD steps = 0;
+
+        for(ut_DWORD sector = start_sector; left > 0; sector = WDBF_FAT.next(sector), steps++)
+        {
+            dot_doc_assert(WDBF_FAT.is_valid_sector(sector) && steps < WDBF_FAT.get_file_sector_count(),
+                "\n%sStream Error:%s\n\tThe sector chain starting at `0x%X` ended at `0x%X` with %llu of %llu bytes left to read.\n",
+                red, white,
+                start_sector, sector, left, size)
+
+            /* The last sector of the file may be cut short. */
+            ut_LSIZE sector_offset = WDBF_header.get_sector_offset(sector);
+            ut_LSIZE length = left < sector_size ? left : sector_size;
+            if(length > fapi->get_size() - sector_offset) length = fapi->get_size() - sector_offset;
+
+            dot_doc_assert(length > 0,
+                "\n%sStream Error:%s\n\tSector `0x%X` of the chain starting at `0x%X` is past the end of the file.\n",
+                red, white,
+                sector, start_sector)
+
+            add_extent(sector_offset, length);
+            left -= length;
+        }
+
+        fapi->get_stats().add(stats_counter::sectors_visited, steps);
+        prefetch();
+    }
+
+    ut_LSIZE get_size()
+    { return stream_size; }
+
+    /* The file the stream was opened in; `nullptr` before `open`. */
+    FileAPI *get_fapi()
+    { return fapi; }
+
+    /* The extents, in order; iterate with `for(stream_extent extent : stream)`. */
+    const std::vector<stream_extent>& get_extents()
+    { return extents; }
+
+    std::vector<stream_extent>::const_iterator begin()
+    { return extents.cbegin(); }
+
+    std::vector<stream_extent>::const_iterator end()
+    { return extents.cend(); }
+
+    /* Start reading the stream ahead of use; done by `open` with the sector cache (`FileAPI::FBWW_readahead`). No more than the
+     * cache budget is asked for; anything past that would be dropped from the page cache before it got used.
+     * */
+    void prefetch()
+    {
+        if(!fapi->FBWW_is_cached())
+            return;
+
+        ut_LSIZE left = fapi->get_cache_budget();
+        for(stream_extent& extent : extents)
+        {
+            if(left == 0) break;
+
+            ut_LSIZE length = extent.size < left ? extent.size : left;
+            fapi->FBWW_readahead(extent.file_offset, length);
+            left -= length;
+        }
+    }
+
+    /* Copy `length` bytes from stream offset `offset` into `destination`. */
+    void copy(ut_LSIZE offset, ut_LSIZE length, ut_BYTE *destination)
+    {
+        dot_doc_assert(offset <= stream_size && length <= stream_size - offset,
+            "\n%sStream Error:%s\n\tAttempted to read %llX bytes at offset %llX of a %llX byte stream.\n",
+            red, white,
+            length, offset, stream_size)
+
+        for(ut_DWORD extent = length > 0 ? find_extent(offset) : 0; length > 0; extent++)
+        {
+            ut_LSIZE within = offset - extent_offsets[extent];
+            ut_LSIZE available = extents[extent].size - within;
+            ut_LSIZE amount = length < available ? length : available;
+
+            fapi->FBWW_copy(extents[extent].file_offset + within, amount, destination);
+
+            destination += amount;
+            offset += amount;
+            length -= amount;
+        }
+    }
+
+    /* Whether the `length` bytes at stream offset `offset` are inside one extent, and one cache block with the sector cache
+     * (a `view` of them would not copy).
+     * */
+    bool is_contiguous(ut_LSIZE offset, ut_LSIZE length)
+    {
+        if(length == 0 || offset >= stream_size || length > stream_size - offset)
+            return length == 0;
+
+        ut_DWORD extent = find_extent(offset);
+        ut_LSIZE within = offset - extent_offsets[extent];
+
+        return length <= extents[extent].size - within && length <= fapi->FBWW_view_limit(extents[extent].file_offset + within);
+    }
+
+    /* File offset of stream offset `offset`; `contiguous` is set to the number of bytes from there to the end of its extent. */
+    ut_LSIZE get_file_offset(ut_LSIZE offset, ut_LSIZE& contiguous)
+    {
+        dot_doc_assert(offset < stream_size,
+            "\n%sStream Error:%s\n\tOffset %llX is past the end of a %llX byte stream.\n",
+            red, white,
+            offset, stream_size)
+
+        ut_DWORD extent = find_extent(offset);
+        ut_LSIZE within = offset - extent_offsets[extent];
+
+        contiguous = extents[extent].size - within;
+        return extents[extent].file_offset + within;
+    }
+
+    /* Whether views stay valid as long as the stream does; with the sector cache they only last until the next view. */
+    bool has_stable_views()
+    { return !fapi || !fapi->FBWW_is_cached(); }
+
+    /* View of `length` bytes at stream offset `offset`.
+     * Zero-copy when the bytes are in one extent (`is_contiguous`); otherwise they are copied into `scratch` (at least `length`
+     * bytes) and the view points there.
+     * */
+    FBWW_span view(ut_LSIZE offset, ut_LSIZE length, ut_BYTE *scratch)
+    {
+        dot_doc_assert(offset <= stream_size && length <= stream_size - offset,
+            "\n%sStream Error:%s\n\tAttempted to view %llX bytes at offset %llX of a %llX byte stream.\n",
+            red, white,
+            length, offset, stream_size)
+
+        if(length == 0)
+            return FBWW_span{scratch, 0};
+
+        ut_DWORD extent = find_extent(offset);
+        ut_LSIZE within = offset - extent_offsets[extent];
+
+        ut_LSIZE file_offset = extents[extent].file_offset + within;
+
+        if(length <= extents[extent].size - within && length <= fapi->FBWW_view_limit(file_offset))
+        {
+            fapi->get_stats().add(stats_counter::in_place_views);
+            return FBWW_span{fapi->FBWW_view(file_offset, length), length};
+        }
+
+        fapi->get_stats().add(stats_counter::copied_views);
+        copy(offset, length, scratch);
+        return FBWW_span{scratch, length};
+    }
+
+    /* Little-endian `T` at stream offset `offset`, even if it straddles two extents. */
+    template<typename T>
+        requires std::integral<T>
+    T get(ut_LSIZE offset)
+    {
+        ut_BYTE scratch[sizeof(T)];
+        return load_le<T> (view(offset, sizeof(T), scratch).data);
+    }
+
+    /* The whole stream in one contiguous buffer; the caller owns it (`delete[]`). */
+    ut_BYTE *copy_all()
+    {
+        ut_BYTE *contiguous = new ut_BYTE[stream_size];
+        copy(0, stream_size, contiguous);
+
+        return contiguous;
+    }
+};
+
+#endif
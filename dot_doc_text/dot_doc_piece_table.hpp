@@ -0,0 +1,215 @@
+#ifndef dot_doc_piece_table
+#define dot_doc_piece_table
+
+#define WDBF_clxt_Prc               0x01    // Prc; property modifiers, skipped
+#define WDBF_clxt_Pcdt              0x02    // Pcdt; the piece table
+#define WDBF_Pcd_size               0x08
+#define WDBF_fc_compressed          0x40000000
+#define WDBF_fc_mask                0x3FFFFFFF
+#define WDBF_text_chunk_characters  0x8000  // Pieces are transcoded this many characters at a time
+
+/* DotDoc_PieceTable - the piece table (PlcPcd, inside the CLX of the table stream); where the document text is stored.
+ *           The text is a sequence of character positions (CPs). Piece `n` covers CPs `[piece_CPs[n], piece_CPs[n + 1])`, and
+ *           its characters are stored in the `WordDocument` stream starting at `piece_FCs[n]`:
+ *               compressed (bit 30 set) - 8-bit CP1252 characters at byte offset `(fc & WDBF_fc_mask) / 2`.
+ *               otherwise               - UTF-16LE code units at byte offset `fc`.
+ *
+ * Variables:
+ *      ut_DWORD *piece_CPs - `piece_count + 1` CPs; the start of every piece, then the end of the last one.
+ *      ut_DWORD *piece_FCs - `FcCompressed` of every piece; the offset, and the compressed bit.
+ */
+class DotDoc_PieceTable
+{
+private:
+    ut_DWORD *piece_CPs = nullptr;
+    ut_DWORD *piece_FCs = nullptr;
+    ut_DWORD piece_count = 0;
+
+    /* Reused between pieces that straddle two extents of the `WordDocument` stream (or two cache blocks); never more than
+     * one chunk of `WDBF_text_chunk_characters`, whatever the size of the piece.
+     * */
+    std::vector<ut_BYTE> straddle_copy;
+
+    void release()
+    {
+        delete[] piece_CPs;
+        delete[] piece_FCs;
+
+        piece_CPs = piece_FCs = nullptr;
+        piece_count = 0;
+    }
+
+public:
+    DotDoc_PieceTable() = default;
+    DotDoc_PieceTable(const DotDoc_PieceTable&) = delete;
+
+    /* Find the Pcdt in the CLX (`fcClx`/`lcbClx` of `WDBF_FIB`, in `table_stream`) and decode its PlcPcd. */
+    void build(DotDoc_Stream& table_stream, DotDoc_FIB& WDBF_FIB)
+    {
+        release();
+
+        ut_LSIZE CLX_offset = WDBF_FIB.get_fc(fib_fc_lcb::Clx);
+        ut_LSIZE CLX_size = WDBF_FIB.get_lcb(fib_fc_lcb::Clx);
+
+        dot_doc_assert(!WDBF_FIB.is_encrypted(),
+            "\n%sText Error:%s\n\tThe WDBF is encrypted; its table stream can not be read.\n",
+            red, white)
+
+        dot_doc_assert(CLX_size > 0 && CLX_offset <= table_stream.get_size() && CLX_size <= table_stream.get_size() - CLX_offset,
+            "\n%sText Error:%s\n\tThe CLX (%llu bytes at offset %llX) is outside of the %llu byte table stream.\n",
+            red, white,
+            CLX_size, CLX_offset, table_stream.get_size())
+
+        /* Skip every Prc; the Pcdt comes last. */
+        ut_LSIZE position = CLX_offset, CLX_end = CLX_offset + CLX_size;
+        while(position < CLX_end && table_stream.get<ut_BYTE> (position) == WDBF_clxt_Prc)
+        {
+            dot_doc_assert(position + 3 <= CLX_end,
+                "\n%sText Error:%s\n\tA Prc of the CLX runs past the end of the CLX.\n",
+                red, white)
+
+            st_WORD grpprl_size = table_stream.get<st_WORD> (position + 1);
+            dot_doc_assert(grpprl_size >= 0,
+                "\n%sText Error:%s\n\tA Prc of the CLX has a negative size (%d).\n",
+                red, white,
+                grpprl_size)
+
+            position += 3 + grpprl_size;
+        }
+
+        dot_doc_assert(position + 5 <= CLX_end && table_stream.get<ut_BYTE> (position) == WDBF_clxt_Pcdt,
+            "\n%sText Error:%s\n\tThe CLX has no piece table (Pcdt).\n",
+            red, white)
+
+        ut_LSIZE PlcPcd_size = table_stream.get<ut_DWORD> (position + 1);
+        ut_LSIZE PlcPcd_offset = position + 5;
+
+        /* `n + 1` 4-byte CPs followed by `n` 8-byte Pcds. */
+        dot_doc_assert(PlcPcd_size <= CLX_end - PlcPcd_offset && PlcPcd_size >= 4 && (PlcPcd_size - 4) % 12 == 0,
+            "\n%sText Error:%s\n\tThe piece table (PlcPcd) size, %llu bytes, is invalid.\n",
+            red, white,
+            PlcPcd_size)
+
+        piece_count = (PlcPcd_size - 4) / 12;
+        piece_CPs = new ut_DWORD[piece_count + 1];
+        piece_FCs = new ut_DWORD[piece_count];
+
+        ut_BYTE *scratch = table_stream.is_contiguous(PlcPcd_offset, PlcPcd_size) ? nullptr : new ut_BYTE[PlcPcd_size];
+        FBWW_span PlcPcd = table_stream.view(PlcPcd_offset, PlcPcd_size, scratch);
+
+        for(ut_DWORD piece = 0; piece <= piece_count; piece++)
+            piece_CPs[piece] = PlcPcd.get<ut_DWORD> (piece * sizeof(ut_DWORD));
+
+        ut_LSIZE Pcds_offset = ((ut_LSIZE) piece_count + 1) * sizeof(ut_DWORD);
+        for(ut_DWORD piece = 0; piece < piece_count; piece++)
+            piece_FCs[piece] = PlcPcd.get<ut_DWORD> (Pcds_offset + piece * WDBF_Pcd_size + 2);
+
+        delete[] scratch;
+
+        for(ut_DWORD piece = 0; piece < piece_count; piece++)
+            dot_doc_assert(piece_CPs[piece] <= piece_CPs[piece + 1],
+                "\n%sText Error:%s\n\tPiece %u ends (CP %u) before it starts (CP %u).\n",
+                red, white,
+                piece, piece_CPs[piece + 1], piece_CPs[piece])
+    }
+
+    ut_DWORD get_piece_count()
+    { return piece_count; }
+
+    /* First CP of `piece`; `get_piece_CP(get_piece_count())` is the CP just past the last piece. */
+    ut_DWORD get_piece_CP(ut_DWORD piece)
+    { return piece_CPs[piece]; }
+
+    /* CP just past the last piece. */
+    ut_DWORD get_last_CP()
+    { return piece_count > 0 ? piece_CPs[piece_count] : 0; }
+
+    bool is_compressed(ut_DWORD piece)
+    { return piece_FCs[piece] & WDBF_fc_compressed; }
+
+    /* Byte offset, in the `WordDocument` stream, of the first character of `piece`. */
+    ut_LSIZE get_piece_offset(ut_DWORD piece)
+    { return is_compressed(piece) ? (piece_FCs[piece] & WDBF_fc_mask) / 2 : piece_FCs[piece] & WDBF_fc_mask; }
+
+    /* The part of `piece` inside CPs `[first_CP, last_CP)`; returns the number of characters, and sets `offset` to where the
+     * first of them is in `WordDocument`. Fails if that part is outside of the stream.
+     * */
+    ut_LSIZE get_piece_range(DotDoc_Stream& WordDocument, ut_DWORD piece, ut_DWORD first_CP, ut_DWORD last_CP, ut_LSIZE& offset)
+    {
+        ut_DWORD from = first_CP > piece_CPs[piece] ? first_CP : piece_CPs[piece];
+        ut_DWORD to = last_CP < piece_CPs[piece + 1] ? last_CP : piece_CPs[piece + 1];
+
+        if(from >= to)
+            return 0;
+
+        ut_LSIZE character_size = is_compressed(piece) ? 1 : 2;
+        ut_LSIZE length = (ut_LSIZE) (to - from) * character_size;
+        offset = get_piece_offset(piece) + (from - piece_CPs[piece]) * character_size;
+
+        dot_doc_assert(offset <= WordDocument.get_size() && length <= WordDocument.get_size() - offset,
+            "\n%sText Error:%s\n\tPiece %u (%llu bytes at offset %llX) is outside of the %llu byte `WordDocument` stream.\n",
+            red, white,
+            piece, length, offset, WordDocument.get_size())
+
+        return to - from;
+    }
+
+    /* Append CPs `[first_CP, last_CP)` to `utf8`, transcoded to UTF-8. */
+    void extract(DotDoc_Stream& WordDocument, ut_DWORD first_CP, ut_DWORD last_CP, std::string& utf8)
+    {
+        for(ut_DWORD piece = 0; piece < piece_count; piece++)
+        {
+            ut_LSIZE offset = 0;
+            ut_LSIZE characters = get_piece_range(WordDocument, piece, first_CP, last_CP, offset);
+
+            if(characters > 0)
+                transcode(WordDocument, offset, characters, is_compressed(piece), utf8);
+        }
+    }
+
+    /* Append the `characters` characters at byte offset `offset` of `WordDocument` to `utf8`, transcoded to UTF-8; CP1252 if
+     * `compressed`, otherwise UTF-16LE. The range has to be inside the stream.
+     * */
+    void transcode(DotDoc_Stream& WordDocument, ut_LSIZE offset, ut_LSIZE characters_left, bool compressed, std::string& utf8)
+    {
+        ut_LSIZE character_size = compressed ? 1 : 2;
+        utf8.reserve(utf8.size() + characters_left * 3);
+
+        while(characters_left > 0)
+        {
+            ut_LSIZE characters = characters_left < WDBF_text_chunk_characters ? characters_left : WDBF_text_chunk_characters;
+
+            /* A surrogate pair is never split between two chunks. */
+            if(characters < characters_left && !compressed)
+            {
+                ut_WORD last_unit = WordDocument.get<ut_WORD> (offset + (characters - 1) * 2);
+                if(last_unit >= 0xD800 && last_unit <= 0xDBFF) characters--;
+            }
+
+            ut_LSIZE chunk_length = characters * character_size;
+
+            /* In place, unless the chunk straddles two extents. */
+            if(!WordDocument.is_contiguous(offset, chunk_length) && straddle_copy.size() < chunk_length)
+                straddle_copy.resize(chunk_length);
+
+            FBWW_span text = WordDocument.view(offset, chunk_length, straddle_copy.data());
+
+            ut_LSIZE written = utf8.size();
+            utf8.resize(written + characters * 3);
+
+            written += compressed
+                ? transcode_CP1252(text.data, characters, ut_BYTE_PTR utf8.data() + written)
+                : transcode_UTF16LE(text.data, characters, ut_BYTE_PTR utf8.data() + written);
+
+            utf8.resize(written);
+
+            offset += chunk_length;
+            characters_left -= characters;
+        }
+    }
+
+    ~DotDoc_PieceTable()
+    { release(); }
+};
+
+#endif
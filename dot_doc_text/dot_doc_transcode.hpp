@@ -0,0 +1,183 @@
+#ifndef dot_doc_transcode
+#define dot_doc_transcode
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Transcoding of piece text to UTF-8.
+ *           Pieces are either "compressed" (8-bit CP1252) or UTF-16LE. Both kernels take `count` characters (bytes for CP1252,
+ *           code units for UTF-16LE), write UTF-8 to `out` and return the number of bytes written; `out` must have room for
+ *           `count * 3` bytes. Paragraph marks (0x0D) are written as '\n'.
+ *
+ *           With SSE2 (every x86-64 build) runs of 16 ASCII characters are converted with a handful of vector instructions;
+ *           a block holding anything else, and the tail, go through the scalar code, which is also the fallback on other
+ *           architectures (`transcode_*_scalar`).
+ */
+
+/* CP1252 0x80 - 0x9F; the rest of CP1252 is the same as Latin-1 (Unicode 0x00 - 0xFF). Undefined bytes are kept as C1 controls. */
+const ut_WORD CP1252_high_control[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+#define UTF8_replacement_character  0xFFFD
+
+inline ut_BYTE *put_UTF8(ut_DWORD code_point, ut_BYTE *out)
+{
+    if(code_point < 0x80)
+    {
+        *out++ = code_point == 0x0D ? '\n' : code_point;
+        return out;
+    }
+
+    if(code_point < 0x800)
+    {
+        *out++ = 0xC0 | (code_point >> 6);
+        *out++ = 0x80 | (code_point & 0x3F);
+        return out;
+    }
+
+    if(code_point < 0x10000)
+    {
+        *out++ = 0xE0 | (code_point >> 12);
+        *out++ = 0x80 | ((code_point >> 6) & 0x3F);
+        *out++ = 0x80 | (code_point & 0x3F);
+        return out;
+    }
+
+    *out++ = 0xF0 | (code_point >> 18);
+    *out++ = 0x80 | ((code_point >> 12) & 0x3F);
+    *out++ = 0x80 | ((code_point >> 6) & 0x3F);
+    *out++ = 0x80 | (code_point & 0x3F);
+    return out;
+}
+
+inline ut_BYTE *put_CP1252_as_UTF8(ut_BYTE character, ut_BYTE *out)
+{
+    if(character >= 0x80 && character < 0xA0)
+        return put_UTF8(CP1252_high_control[character - 0x80], out);
+
+    return put_UTF8(character, out);
+}
+
+/* UTF-16LE code unit `i` of `in` (and the one after it, for a surrogate pair); advances `i` past what was consumed. */
+inline ut_BYTE *put_UTF16LE_as_UTF8(const ut_BYTE *in, ut_LSIZE count, ut_LSIZE& i, ut_BYTE *out)
+{
+    ut_DWORD unit = load_le<ut_WORD> (in + i * 2);
+    i++;
+
+    if(unit < 0xD800 || unit > 0xDFFF)
+        return put_UTF8(unit, out);
+
+    /* High surrogate followed by a low surrogate; anything else is an unpaired surrogate. */
+    if(unit < 0xDC00 && i < count)
+    {
+        ut_DWORD low_unit = load_le<ut_WORD> (in + i * 2);
+
+        if(low_unit >= 0xDC00 && low_unit <= 0xDFFF)
+        {
+            i++;
+            return put_UTF8(0x10000 + ((unit - 0xD800) << 10) + (low_unit - 0xDC00), out);
+        }
+    }
+
+    return put_UTF8(UTF8_replacement_character, out);
+}
+
+inline ut_LSIZE transcode_CP1252_scalar(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out)
+{
+    ut_BYTE *start = out;
+
+    for(ut_LSIZE i = 0; i < count; i++)
+        out = put_CP1252_as_UTF8(in[i], out);
+
+    return out - start;
+}
+
+inline ut_LSIZE transcode_UTF16LE_scalar(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out)
+{
+    ut_BYTE *start = out;
+
+    for(ut_LSIZE i = 0; i < count;)
+        out = put_UTF16LE_as_UTF8(in, count, i, out);
+
+    return out - start;
+}
+
+#if defined(__SSE2__)
+/* 0x0D bytes of `block` become 0x0A. */
+inline __m128i paragraph_marks_to_newlines(__m128i block)
+{
+    __m128i is_mark = _mm_cmpeq_epi8(block, _mm_set1_epi8(0x0D));
+    return _mm_xor_si128(block, _mm_and_si128(is_mark, _mm_set1_epi8(0x0D ^ 0x0A)));
+}
+
+inline ut_LSIZE transcode_CP1252(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out)
+{
+    ut_BYTE *start = out;
+    ut_LSIZE i = 0;
+
+    while(i + 16 <= count)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *) (in + i));
+
+        /* A byte with the top bit set; not ASCII. */
+        if(_mm_movemask_epi8(block) != 0)
+        {
+            for(ut_LSIZE block_end = i + 16; i < block_end; i++)
+                out = put_CP1252_as_UTF8(in[i], out);
+
+            continue;
+        }
+
+        _mm_storeu_si128((__m128i *) out, paragraph_marks_to_newlines(block));
+        out += 16;
+        i += 16;
+    }
+
+    return (out - start) + transcode_CP1252_scalar(in + i, count - i, out);
+}
+
+inline ut_LSIZE transcode_UTF16LE(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out)
+{
+    ut_BYTE *start = out;
+    ut_LSIZE i = 0;
+
+    const __m128i non_ASCII_bits = _mm_set1_epi16((nt_WORD) 0xFF80);
+
+    while(i + 16 <= count)
+    {
+        __m128i low_units = _mm_loadu_si128((const __m128i *) (in + i * 2));
+        __m128i high_units = _mm_loadu_si128((const __m128i *) (in + i * 2 + 16));
+
+        /* Every one of the 16 code units below 0x80; narrow them to bytes. */
+        __m128i non_ASCII = _mm_and_si128(_mm_or_si128(low_units, high_units), non_ASCII_bits);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi16(non_ASCII, _mm_setzero_si128())) != 0xFFFF)
+        {
+            for(ut_LSIZE block_end = i + 16; i < block_end;)
+                out = put_UTF16LE_as_UTF8(in, count, i, out);
+
+            continue;
+        }
+
+        _mm_storeu_si128((__m128i *) out, paragraph_marks_to_newlines(_mm_packus_epi16(low_units, high_units)));
+        out += 16;
+        i += 16;
+    }
+
+    ut_BYTE *tail = out;
+    while(i < count)
+        tail = put_UTF16LE_as_UTF8(in, count, i, tail);
+
+    return tail - start;
+}
+#else
+inline ut_LSIZE transcode_CP1252(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out)
+{ return transcode_CP1252_scalar(in, count, out); }
+
+inline ut_LSIZE transcode_UTF16LE(const ut_BYTE *in, ut_LSIZE count, ut_BYTE *out)
+{ return transcode_UTF16LE_scalar(in, count, out); }
+#endif
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef dot_doc_thread_pool
+#define dot_doc_thread_pool
+
+/* DotDoc_ThreadPool - work-stealing pool of worker threads.
+ *           Every worker has its own queue. Tasks are handed out to the queues round-robin; a worker takes from the back of
+ *           its own queue and, once that is empty, steals from the front of the other workers' queues. Workers only
+ *           sleep when every queue is empty.
+ *
+ *           `T` is the task type; `run_task(task, worker_ID)` gets invoked, on a worker thread, for every submitted task.
+ *           `submit` blocks while there are more than `max_pending` tasks queued so that a producer enumerating millions
+ *           of files does not queue all of them up front.
+ *
+ * Variables:
+ *      std::atomic<nt_LSIZE> pending - Tasks that were submitted but not yet taken by a worker.
+ *      bool closed - Set by `finish`; no more tasks are coming, workers exit once the queues are drained.
+ */
+template<typename T>
+class DotDoc_ThreadPool
+{
+private:
+    struct worker_queue
+    {
+        std::mutex      lock;
+        std::deque<T>   tasks;
+    };
+
+    std::vector<worker_queue> queues;
+    std::vector<std::thread> workers;
+    std::function<void(T&, ut_DWORD)> run_task;
+
+    std::atomic<nt_LSIZE> pending{0};
+    ut_LSIZE max_pending = 0;
+    ut_DWORD next_queue = 0;
+    bool closed = false;
+
+    std::mutex idle_lock;
+    std::condition_variable idle_cond;
+    std::condition_variable space_cond;
+
+    bool take_task(ut_DWORD worker_ID, T& task)
+    {
+        /* Our own queue first (newest task, it is likeliest to be warm), then steal the oldest task of the others. */
+        for(ut_DWORD i = 0; i < queues.size(); i++)
+        {
+            worker_queue& queue = queues[(worker_ID + i) % queues.size()];
+            std::lock_guard<std::mutex> queue_guard(queue.lock);
+
+            if(queue.tasks.empty())
+                continue;
+
+            if(i == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void worker_loop(ut_DWORD worker_ID)
+    {
+        T task;
+
+        while(true)
+        {
+            if(take_task(worker_ID, task))
+            {
+                if(pending.fetch_sub(1) <= (nt_LSIZE) max_pending)
+                {
+                    /* Taking `idle_lock` makes sure a producer that just saw a full pool is already waiting. */
+                    { std::lock_guard<std::mutex> idle_guard(idle_lock); }
+                    space_cond.notify_one();
+                }
+
+                run_task(task, worker_ID);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> idle_guard(idle_lock);
+            idle_cond.wait(idle_guard, [this] { return pending.load() > 0 || closed; });
+
+            if(closed && pending.load() <= 0)
+                return;
+        }
+    }
+
+public:
+    DotDoc_ThreadPool(ut_DWORD worker_count, std::function<void(T&, ut_DWORD)> task_runner, ut_LSIZE max_pending_tasks = 0)
+        : queues(worker_count > 0 ? worker_count : 1)
+    {
+        run_task = task_runner;
+        max_pending = max_pending_tasks > 0 ? max_pending_tasks : queues.size() * 256;
+
+        for(ut_DWORD i = 0; i < queues.size(); i++)
+            workers.emplace_back(&DotDoc_ThreadPool::worker_loop, this, i);
+    }
+
+    ut_DWORD get_worker_count()
+    { return queues.size(); }
+
+    /* How many tasks may be queued before `submit` blocks; call before submitting any. */
+    void set_max_pending(ut_LSIZE max_pending_tasks)
+    { max_pending = max_pending_tasks > 0 ? max_pending_tasks : queues.size() * 256; }
+
+    void submit(T task)
+    {
+        {
+            std::unique_lock<std::mutex> idle_guard(idle_lock);
+            space_cond.wait(idle_guard, [this] { return pending.load() < (nt_LSIZE) max_pending; });
+        }
+
+        /* Count the task before it is visible so a worker taking it never sees `pending` go negative. */
+        pending.fetch_add(1);
+
+        worker_queue& queue = queues[next_queue];
+        next_queue = (next_queue + 1) % queues.size();
+
+        {
+            std::lock_guard<std::mutex> queue_guard(queue.lock);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        { std::lock_guard<std::mutex> idle_guard(idle_lock); }
+        idle_cond.notify_one();
+    }
+
+    /* No more tasks will be submitted; wait for every queued task to finish and join the workers. */
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> idle_guard(idle_lock);
+            closed = true;
+        }
+        idle_cond.notify_all();
+
+        for(std::thread& worker : workers)
+            if(worker.joinable()) worker.join();
+
+        workers.clear();
+    }
+
+    ~DotDoc_ThreadPool()
+    { finish(); }
+};
+
+#endif
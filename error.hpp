@@ -14,122 +14,225 @@ enum error_type
     no_error = 0x0
 };
 
-struct error_tracker
+/* One flaw found in the WDBF; just the facts, nothing is formatted until the record is printed.
+ * `offset` and `size` locate the flawed field in the file, `found` is the value that was there and `expected` the value it
+ * should have been (the value it was repaired to, when `fixed`).
+ * */
+struct error_record
 {
-    enum error_type         current_error;
-    enum error_type         previous_error;
+    enum error_type     error;
+    ut_LSIZE            offset;
+    ut_BYTE             size;
+    ut_LSIZE            found;
+    ut_LSIZE            expected;
+    bool                fixed;
+};
+
+/* error_log - every flaw found while decoding one WDBF; each decode session (`DotDoc_Header`) owns its own.
+ *           Appending is lock-free: a record slot is claimed with one atomic increment and published with a release store,
+ *           so any number of threads working on the same session can report flaws without ever blocking one another, and
+ *           different sessions never share anything. Records live in chunks of `error_log_chunk_size`, allocated on first
+ *           use; the log holds at most `error_log_chunk_size * error_log_max_chunks` records, anything past that is only counted.
+ *
+ *           Formatting is deferred to the output stage: `format_record` (human-readable) and `format_record_compact` (one line,
+ *           no color) turn a record into text only when something actually gets printed or reported.
+ *
+ * Variables:
+ *      std::atomic<error_slot *> chunks[] - Record chunks.
+ *      std::atomic<ut_DWORD> claimed - Number of slots handed out; may run ahead of the published records for a moment.
+ *      std::atomic<bool> unfixable - Set once a flaw that could not be repaired was recorded; never cleared.
+ */
+#define error_log_chunk_size    64
+#define error_log_max_chunks    256
+
+class error_log
+{
+private:
+    struct error_slot
+    {
+        struct error_record record;
+        std::atomic<bool>   published{false};
+    };
+
+    std::atomic<error_slot *> chunks[error_log_max_chunks] = {};
+    std::atomic<ut_DWORD> claimed{0};
+    std::atomic<bool> unfixable{false};
+
+    error_slot *get_chunk(ut_DWORD chunk)
+    {
+        error_slot *slots = chunks[chunk].load(std::memory_order_acquire);
+        if(slots) return slots;
 
-    ut_BYTE                 same_error_count;
-    ut_WORD                 error_count;
+        /* First record of the chunk; whichever thread gets its chunk in first wins, the others drop theirs. */
+        error_slot *fresh_slots = new error_slot[error_log_chunk_size];
+        if(chunks[chunk].compare_exchange_strong(slots, fresh_slots, std::memory_order_acq_rel))
+            return fresh_slots;
 
-    bool                    all_errors_fixed;
+        delete[] fresh_slots;
+        return slots;
+    }
 
-    ut_BYTE                 error_msg[400];
+public:
+    error_log() = default;
+    error_log(const error_log&) = delete;
 
-    error_tracker()
+    void record(enum error_type error, ut_LSIZE offset, ut_BYTE size, ut_LSIZE found, ut_LSIZE expected, bool fixed)
     {
-        current_error = previous_error = no_error;
-        same_error_count = error_count = 0;
-        all_errors_fixed = true;
-        memset(error_msg, 0, 400);
+        if(!fixed) unfixable.store(true, std::memory_order_relaxed);
+
+        ut_DWORD slot = claimed.fetch_add(1, std::memory_order_relaxed);
+        if(slot >= error_log_chunk_size * error_log_max_chunks)
+            return;
+
+        error_slot& destination = get_chunk(slot / error_log_chunk_size)[slot % error_log_chunk_size];
+        destination.record = error_record{error, offset, size, found, expected, fixed};
+        destination.published.store(true, std::memory_order_release);
     }
 
-    ut_BYTE get_same_error_count()
-    { return same_error_count; }
+    /* Number of flaws recorded, including any that did not fit in the log. */
+    ut_DWORD get_error_count()
+    { return claimed.load(std::memory_order_acquire); }
 
-    ut_WORD get_error_count()
-    { return error_count; }
+    /* Number of records that can be read back with `get_record`. */
+    ut_DWORD get_record_count()
+    {
+        ut_DWORD count = get_error_count();
+        return count < error_log_chunk_size * error_log_max_chunks ? count : error_log_chunk_size * error_log_max_chunks;
+    }
 
-    bool is_same_error(enum error_type error_to_be_raised)
+    /* Record `index`; false if it is still being written by another thread. */
+    bool get_record(ut_DWORD index, struct error_record& record)
     {
-        if(error_count == 0)
+        error_slot *slots = chunks[index / error_log_chunk_size].load(std::memory_order_acquire);
+        if(!slots || !slots[index % error_log_chunk_size].published.load(std::memory_order_acquire))
             return false;
-        
-        if(previous_error == error_to_be_raised || current_error == error_to_be_raised)
-            return true;
-        
-        return false;
+
+        record = slots[index % error_log_chunk_size].record;
+        return true;
     }
 
-    ut_BYTE *get_error_name(enum error_type error_to_be_raised)
+    bool all_errors_fixed()
+    { return !unfixable.load(std::memory_order_relaxed); }
+
+    static const nt_BYTE *get_error_name(enum error_type error)
     {
-        switch(error_to_be_raised)
+        switch(error)
         {
-            case invalid_doc_file_header_sig: return ut_BYTE_PTR "Invalid Header Signature";break;
-            case invalid_doc_file_padding: return ut_BYTE_PTR "Invalid Padding";break;
-            case invalid_CFB_minor_version: return ut_BYTE_PTR "Invalid CFB Minor Version";break;
-            case invalid_CFB_major_version: return ut_BYTE_PTR "Invalid CFB Major Version";break;
-            case invalid_CFB_little_endian_indication: return ut_BYTE_PTR "Invalid Little-Endian Indicator";break;
-            case invalid_CFB_sector_size_indication: return ut_BYTE_PTR "Invalid CFB Sector Size Indication";break;
+            case invalid_doc_file_header_sig: return "Invalid Header Signature";
+            case invalid_doc_file_padding: return "Invalid Padding";
+            case invalid_CFB_minor_version: return "Invalid CFB Minor Version";
+            case invalid_CFB_major_version: return "Invalid CFB Major Version";
+            case invalid_CFB_little_endian_indication: return "Invalid Little-Endian Indicator";
+            case invalid_CFB_sector_size_indication: return "Invalid CFB Sector Size Indication";
+            case invalid_CFB_mini_stream_sector_size: return "Invalid CFB Mini Stream Sector Size";
+            case invalid_CFB_dir_sector_count: return "Invalid CFB Directory Sector Count";
             default: break;
         }
 
-        return ut_BYTE_PTR "Unknown Error";
+        return "Unknown Error";
     }
 
-    void raise_error(enum error_type error_encountered, bool can_fix)
+    /* The flaw as one plain line, e.g. "Invalid CFB Minor Version at 0x18: 0x553E, expected 0x3E (repaired)". */
+    static void format_record_compact(const struct error_record& record, nt_BYTE *buffer, ut_LSIZE buffer_size)
     {
-        /* If `err_tracker.current_error` does not represent `no_error`, assign `err_tracker.previous_error` to whatever the last error was
-         * before `encountered_error` got called again.
-         * */
-        if(current_error != no_error)
-            previous_error = current_error;
-        
-        if(is_same_error(error_encountered))
-            goto same_error;
-
-        /* Check to see if `err_tracker.err_count` is greater than zero. If it is, check to see if the error being encountered
-         * is the same as the error that was encountered prior.
-         * */
-        if(error_count >= 1 && previous_error == error_encountered)
-        {
-            same_error:
-            /* Increase the amount of same errors. */
-            same_error_count++;
-
-            /* Make sure `err_msg` is not NULL, then print. */
-            dot_doc_assert(error_msg, "\n\e[0;31m[PROGRAM MEMORY ERROR]\e[0;37m\tInternal program error.\n")
-            printf("%s", error_msg);
+        snprintf(buffer, buffer_size, "%s at 0x%llX: 0x%llX, expected 0x%llX (%s)",
+            get_error_name(record.error), record.offset, record.found, record.expected, record.fixed ? "repaired" : "not repaired");
+    }
 
-            goto encountered_error_end;
+    /* The flaw as it is shown to a user. `repeat` is the number of records of the same kind right before this one; repeats are
+     * printed as "Exception #n" lines under the first.
+     * */
+    static void format_record(const struct error_record& record, ut_DWORD repeat, nt_BYTE *buffer, ut_LSIZE buffer_size)
+    {
+        switch(record.error)
+        {
+            case invalid_doc_file_header_sig:
+            case invalid_doc_file_padding: {
+                /* Byte-by-byte fields; the index is the position of the byte in its field. */
+                ut_LSIZE field_start = record.error == invalid_doc_file_header_sig ? (ut_LSIZE) data_locations::WDBF_HS
+                    : record.offset >= (ut_LSIZE) data_locations::WDBF_PD2 ? (ut_LSIZE) data_locations::WDBF_PD2 : (ut_LSIZE) data_locations::WDBF_PD1;
+                const nt_BYTE *field_name = record.error == invalid_doc_file_header_sig ? "8-byte header signature"
+                    : field_start == (ut_LSIZE) data_locations::WDBF_PD2 ? "6 bytes of reserved padding" : "16 bytes of padding";
+
+                if(repeat > 0)
+                    snprintf(buffer, buffer_size,
+                        "\t\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tException #%d: Value encountered at index %llu was \e[0;31m`0x%llX`\e[0;37m, expected \e[0;33m`0x%llX`\e[0;37m.\n",
+                        repeat + 1, record.offset - field_start + 1, record.found, record.expected);
+                else
+                    snprintf(buffer, buffer_size,
+                        "\n\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tAt index %llu of the %s the value encountered was \e[0;31m`0x%llX`\e[0;37m when the program was expecting \e[0;33m`0x%llX`\e[0;37m.\n",
+                        record.offset - field_start + 1, field_name, record.found, record.expected);
+                return;
+            }
+            case invalid_CFB_major_version: {
+                snprintf(buffer, buffer_size,
+                    "\n\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe major version was found to be \e[0;31m`0x%04llX`\e[0;37m, when it is expected to be \e[0;33m`0x0003`\e[0;37m or \e[0;33m`0x0004`\e[0;37m.\n",
+                    record.found);
+                return;
+            }
+            case invalid_CFB_sector_size_indication: {
+                bool is_mv3 = record.expected == 0x09;
+
+                snprintf(buffer, buffer_size,
+                    "\n\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe sector size indication was found to be \e[0;31m`0x%llX`\e[0;37m, when it is expected to be \e[0;33m`0x%llX`\e[0;37m.\n\t\t\t\tThe Major Version is \e[0;33m%s\e[0;37m, which requires sector size of %s bytes.\n",
+                    record.found, record.expected,
+                    is_mv3 ? "Major Version 3" : "Major Version 4",
+                    is_mv3 ? "512" : "4,096");
+                return;
+            }
+            case invalid_CFB_dir_sector_count: {
+                snprintf(buffer, buffer_size,
+                    "\n\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe number of Directory sectors was found to be \e[0;31m`0x%llX`\e[0;37m, when it is expected to be \e[0;33m`0x00`\e[0;37m.\n\t\t\t\tWith the WDBF using Major Version 3, this value must be zero.\n",
+                    record.found);
+                return;
+            }
+            default: {
+                const nt_BYTE *field_name = record.error == invalid_CFB_minor_version ? "minor version"
+                    : record.error == invalid_CFB_little_endian_indication ? "byte order indication"
+                    : record.error == invalid_CFB_mini_stream_sector_size ? "Mini Stream sector size" : get_error_name(record.error);
+
+                snprintf(buffer, buffer_size,
+                    "\n\e[1;93m[WordDocument Binary Flaw]\e[0;37m\tThe %s was found to be \e[0;31m`0x%04llX`\e[0;37m, when it is expected to be \e[0;33m`0x%04llX`\e[0;37m.\n",
+                    field_name, record.found, record.expected);
+                return;
+            }
         }
+    }
 
-        printf("\n");
-    
-        current_error = error_encountered;
-        dot_doc_assert(error_msg, "Internal program error.\n")
-        printf("%s", error_msg);
-
-        same_error_count = 1;
+    /* Format and print every record to `output`. */
+    void print(FILE *output)
+    {
+        nt_BYTE message[512];
+        struct error_record record, previous_record{};
+        previous_record.error = no_error;
+        ut_DWORD repeat = 0;
 
-        encountered_error_end:
-        if(!can_fix) all_errors_fixed = false;
+        for(ut_DWORD index = 0; index < get_record_count(); index++)
+        {
+            if(!get_record(index, record))
+                continue;
 
-        error_count++;
-        memset(error_msg, 0, 400);
-    }
+            repeat = record.error == previous_record.error ? repeat + 1 : 0;
+            previous_record = record;
 
-    void delete_instance(struct error_tracker *err_t)
-    {
-        delete err_t;
+            format_record(record, repeat, message, sizeof(message));
+            fputs(message, output);
+        }
     }
 
-    ~error_tracker()
+    ~error_log()
     {
-        /* Make sure all errors, if any, were fixed. */
-        dot_doc_assert(all_errors_fixed, "\n\e[0;31m[WDBF INTERNAL ERROR]\e[0;37m\tThere is an error inside the WDBF that could not be fixed.\n")
-
-        /* Debugging. */
-        std::cout << "\n\e[0;32m[DEBUG ➟ \e[0;34mstruct \e[1;35merror_tracker\e[0;32m]\e[0;37m\t`err_tracker` released." << std::endl;
+        for(ut_DWORD chunk = 0; chunk < error_log_max_chunks; chunk++)
+            delete[] chunks[chunk].load(std::memory_order_relaxed);
     }
 };
 
-static struct error_tracker *err_tracker = new struct error_tracker;
-
-#define dot_doc_raise_exception(errID, is_fixable, msg, ...)                        \
-{                                                                                   \
-    sprintf(nt_BYTE_PTR err_tracker->error_msg, nt_BYTE_CPTR msg, ##__VA_ARGS__);   \
-    err_tracker->raise_error(errID, is_fixable);                                    \
+/* `err_log` is resolved where the macro is used; every `DotDoc_Header` owns its own `err_log`,
+ * so documents decoded one after another (or in parallel) never share error state.
+ * */
+#define dot_doc_record_flaw(errID, is_fixable, location, found_value, expected_value)                                  \
+{                                                                                                                       \
+    err_log->record(errID, (ut_LSIZE) (location), sizeof(found_value), (ut_LSIZE) (found_value), (ut_LSIZE) (expected_value), is_fixable); \
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -49,6 +49,351 @@ concept BYTE_WORD_DWORD = requires {
         std::is_same<T, ut_DWORD>::value;
 };
 
+/* FBWW_span - a non-owning view of `size` bytes of file data.
+ *             Spans are handed out by `FileAPI`; they never allocate and are valid for as long as the `FileAPI` instance is.
+ * */
+struct FBWW_span
+{
+    const ut_BYTE   *data = nullptr;
+    ut_LSIZE        size = 0;
+
+    /* Bounds-checked little-endian read of a `T` at `offset` into the span. */
+    template<typename T>
+        requires std::integral<T>
+    T get(ut_LSIZE offset) const
+    {
+        dot_doc_assert(offset <= size && sizeof(T) <= size - offset,
+            "\n\t%sRead Error:%s\n\tAttempted to read %ld bytes at offset %llX of a %llX byte span.\n",
+            red, white,
+            sizeof(T), offset, size)
+
+        return load_le<T> (data + offset);
+    }
+
+    FBWW_span sub(ut_LSIZE offset, ut_LSIZE length) const
+    {
+        dot_doc_assert(offset <= size && length <= size - offset,
+            "\n\t%sRead Error:%s\n\tAttempted to view %llX bytes at offset %llX of a %llX byte span.\n",
+            red, white,
+            length, offset, size)
+
+        return FBWW_span{data + offset, length};
+    }
+};
+
+/* FBWW_dirty_ranges - the byte ranges of the file data that were rewritten, kept coalesced.
+ *           Overlapping and touching ranges are merged as they are added, so repairing every field of a header ends up as a
+ *           handful of ranges (usually one) no matter how many individual bytes were rewritten.
+ *
+ * Variables:
+ *      std::map<ut_LSIZE, ut_LSIZE> ranges - First byte of every range, mapped to the byte just past its end.
+ */
+class FBWW_dirty_ranges
+{
+private:
+    std::map<ut_LSIZE, ut_LSIZE> ranges;
+
+public:
+    void add(ut_LSIZE offset, ut_LSIZE length)
+    {
+        if(length == 0)
+            return;
+
+        ut_LSIZE begin = offset, end = offset + length;
+
+        /* The first range that could touch [begin, end) is the last one starting at or before `begin`. */
+        auto range = ranges.upper_bound(begin);
+        if(range != ranges.begin() && std::prev(range)->second >= begin)
+            range = std::prev(range);
+
+        while(range != ranges.end() && range->first <= end)
+        {
+            if(range->first < begin) begin = range->first;
+            if(range->second > end) end = range->second;
+
+            range = ranges.erase(range);
+        }
+
+        ranges.emplace(begin, end);
+    }
+
+    void clear()
+    { ranges.clear(); }
+
+    bool empty() const
+    { return ranges.empty(); }
+
+    ut_LSIZE get_range_count() const
+    { return ranges.size(); }
+
+    /* Total number of dirty bytes. */
+    ut_LSIZE get_byte_count() const
+    {
+        ut_LSIZE bytes = 0;
+        for(const auto& range : ranges) bytes += range.second - range.first;
+
+        return bytes;
+    }
+
+    /* In file order; `range.first` is the first byte, `range.second` the byte just past the end. */
+    std::map<ut_LSIZE, ut_LSIZE>::const_iterator begin() const
+    { return ranges.cbegin(); }
+
+    std::map<ut_LSIZE, ut_LSIZE>::const_iterator end() const
+    { return ranges.cend(); }
+};
+
+/* FBWW_sector_cache - a fixed amount of memory holding the most used blocks of a file; for files too large to keep in memory.
+ *           The pool is allocated once: `slot_count` slots of `FBWW_cache_slot_size` bytes, each holding one aligned block of the
+ *           file. 4096 bytes is a sector of Major Version 4 and eight of Major Version 3, so no sector ever straddles two slots.
+ *           A miss `pread`s the block into a slot picked by CLOCK: the hand sweeps the slots, clearing reference bits, and takes
+ *           the first one not referenced since its last pass. Two kinds of slot are never taken:
+ *               dirty slots - They hold repairs (`FileAPI::rewrite_at`); dropping them would lose the repairs.
+ *               the slot of the last lookup - So the pointer `get_block` just returned stays valid until the next lookup.
+ *
+ * Variables:
+ *      ut_BYTE *slot_data - The pool; slot `n` is `slot_data + n * FBWW_cache_slot_size`.
+ *      ut_LSIZE *slot_blocks - Block held by each slot; `FBWW_cache_no_block` when empty.
+ *      ut_BYTE *slot_flags - `FBWW_cache_referenced` and `FBWW_cache_dirty` per slot.
+ *      ut_DWORD *block_index - Open-addressed hash of block -> slot + 1 (zero is empty); linear probing, backward-shift deletion.
+ */
+#define FBWW_cache_slot_size        0x1000
+#define FBWW_cache_slot_shift       12
+#define FBWW_cache_min_slots        4
+#define FBWW_default_cache_budget   (4ULL << 20)
+#define FBWW_cache_no_block         (~0ULL)
+#define FBWW_cache_referenced       0x1
+#define FBWW_cache_dirty            0x2
+
+class FBWW_sector_cache
+{
+private:
+    nt_DWORD file;
+    ut_LSIZE file_size;
+    DotDoc_Stats& stats;
+
+    ut_BYTE *slot_data = nullptr;
+    ut_LSIZE *slot_blocks = nullptr;
+    ut_BYTE *slot_flags = nullptr;
+    ut_DWORD slot_count = 0;
+    ut_DWORD used_slots = 0;
+    ut_DWORD hand = 0;
+    ut_DWORD last_slot = ~0U;
+
+    ut_DWORD *block_index = nullptr;
+    ut_DWORD index_mask = 0;
+
+    static ut_DWORD hash_block(ut_LSIZE block)
+    { return (ut_DWORD) ((block * 0x9E3779B97F4A7C15ULL) >> 32); }
+
+    /* Position in `block_index` of `block`, or of the empty position it would go in. */
+    ut_DWORD find_position(ut_LSIZE block)
+    {
+        ut_DWORD position = hash_block(block) & index_mask;
+        while(block_index[position] != 0 && slot_blocks[block_index[position] - 1] != block)
+            position = (position + 1) & index_mask;
+
+        return position;
+    }
+
+    /* Take `block` out of the index; later entries of its probe run are shifted back so no lookup stops early. */
+    void unindex(ut_LSIZE block)
+    {
+        ut_DWORD position = find_position(block);
+        if(block_index[position] == 0) return;
+
+        for(ut_DWORD next = (position + 1) & index_mask; block_index[next] != 0; next = (next + 1) & index_mask)
+        {
+            ut_DWORD home = hash_block(slot_blocks[block_index[next] - 1]) & index_mask;
+
+            /* Move the entry at `next` into the hole unless its home lies cyclically in (position, next]. */
+            if(((next - home) & index_mask) >= ((next - position) & index_mask))
+            {
+                block_index[position] = block_index[next];
+                position = next;
+            }
+        }
+
+        block_index[position] = 0;
+    }
+
+    /* CLOCK; an empty slot while there is one, otherwise the first slot not referenced since the hand last passed it. */
+    ut_DWORD pick_slot()
+    {
+        if(used_slots < slot_count)
+            return used_slots++;
+
+        for(ut_DWORD sweep = 0; sweep < 2 * slot_count; sweep++)
+        {
+            ut_DWORD slot = hand;
+            hand = (hand + 1) % slot_count;
+
+            if(slot == last_slot || (slot_flags[slot] & FBWW_cache_dirty))
+                continue;
+
+            if(slot_flags[slot] & FBWW_cache_referenced)
+            {
+                slot_flags[slot] &= ~FBWW_cache_referenced;
+                continue;
+            }
+
+            unindex(slot_blocks[slot]);
+            return slot;
+        }
+
+        dot_doc_error("\n%sCache Error:%s\n\tEvery one of the %u cache slots holds repairs; raise the cache budget.\n",
+            red, white,
+            slot_count)
+    }
+
+    void fill_slot(ut_DWORD slot, ut_LSIZE block)
+    {
+        ut_BYTE *data = slot_data + ((ut_LSIZE) slot << FBWW_cache_slot_shift);
+        ut_LSIZE offset = block << FBWW_cache_slot_shift;
+        ut_LSIZE length = file_size - offset < FBWW_cache_slot_size ? file_size - offset : FBWW_cache_slot_size;
+        ut_LSIZE filled = 0;
+
+        while(filled < length)
+        {
+            ssize_t result = pread(file, data + filled, length - filled, offset + filled);
+            stats.add(stats_counter::syscalls);
+
+            if(result < 0 && errno == EINTR)
+                continue;
+
+            dot_doc_assert(result > 0, "\n%sRead Error:%s\n\tCould not read %llu bytes at offset %llX: %s.\n",
+                red, white,
+                length - filled, offset + filled, result < 0 ? strerror(errno) : "unexpected end of file")
+
+            filled += result;
+        }
+
+        /* The last block of the file may be partial. */
+        memset(data + length, 0, FBWW_cache_slot_size - length);
+    }
+
+public:
+    FBWW_sector_cache(nt_DWORD file_descriptor, ut_LSIZE size, ut_LSIZE budget, DotDoc_Stats& session_stats)
+        : file(file_descriptor), file_size(size), stats(session_stats)
+    {
+        slot_count = budget >> FBWW_cache_slot_shift;
+        if(slot_count < FBWW_cache_min_slots) slot_count = FBWW_cache_min_slots;
+
+        /* No more slots than the file has blocks. */
+        ut_LSIZE file_blocks = (file_size + FBWW_cache_slot_size - 1) >> FBWW_cache_slot_shift;
+        if(file_blocks < slot_count) slot_count = file_blocks > 0 ? file_blocks : 1;
+
+        ut_DWORD index_size = std::bit_ceil(slot_count * 2);
+        index_mask = index_size - 1;
+
+        slot_data = new ut_BYTE[(ut_LSIZE) slot_count << FBWW_cache_slot_shift];
+        slot_blocks = new ut_LSIZE[slot_count];
+        slot_flags = new ut_BYTE[slot_count];
+        block_index = new ut_DWORD[index_size];
+
+        std::fill(slot_blocks, slot_blocks + slot_count, FBWW_cache_no_block);
+        memset(slot_flags, 0, slot_count);
+        memset(block_index, 0, index_size * sizeof(ut_DWORD));
+    }
+
+    FBWW_sector_cache(const FBWW_sector_cache&) = delete;
+
+    /* The slot holding `block`, read in if it is not cached yet. Valid until the next call. */
+    ut_BYTE *get_block(ut_LSIZE block)
+    {
+        ut_DWORD position = find_position(block);
+        ut_DWORD slot;
+
+        if(block_index[position] != 0)
+        {
+            slot = block_index[position] - 1;
+            stats.add(stats_counter::cache_hits);
+        }
+        else
+        {
+            slot = pick_slot();
+            fill_slot(slot, block);
+
+            slot_blocks[slot] = block;
+            block_index[find_position(block)] = slot + 1;
+            stats.add(stats_counter::cache_misses);
+        }
+
+        slot_flags[slot] |= FBWW_cache_referenced;
+        last_slot = slot;
+
+        return slot_data + ((ut_LSIZE) slot << FBWW_cache_slot_shift);
+    }
+
+    /* Keep `block` (which must be cached; `get_block` it first) until the cache is released. */
+    void mark_dirty(ut_LSIZE block)
+    {
+        ut_DWORD position = find_position(block);
+        if(block_index[position] != 0) slot_flags[block_index[position] - 1] |= FBWW_cache_dirty;
+    }
+
+    /* Ask the kernel to start reading `length` bytes at `offset`, so the misses that follow find them in the page cache. */
+    void readahead(ut_LSIZE offset, ut_LSIZE length)
+    {
+        if(offset >= file_size || length == 0) return;
+        if(length > file_size - offset) length = file_size - offset;
+
+        stats.add(stats_counter::syscalls);
+        posix_fadvise(file, offset, length, POSIX_FADV_WILLNEED);
+    }
+
+    /* Memory the cache holds, whatever the size of the file. */
+    ut_LSIZE get_budget()
+    { return (ut_LSIZE) slot_count << FBWW_cache_slot_shift; }
+
+    ~FBWW_sector_cache()
+    {
+        delete[] slot_data;
+        delete[] slot_blocks;
+        delete[] slot_flags;
+        delete[] block_index;
+    }
+};
+
+/* How `FileAPI` gets at the data of the file.
+ *      FBWW_mapped     - The file is memory-mapped (`MAP_PRIVATE`); every read returns a view into the mapping, nothing gets copied.
+ *      FBWW_buffered   - The file is read, via `read`, into a heap buffer. This is the fallback for files that cannot be mapped.
+ *      FBWW_probe      - Only the 512-byte header block is read, with a single `pread`; views past it fail. For classifying files
+ *                        (`DotDoc_Header::probe_WDBF_heading`) without reading, or mapping, the rest of them, whatever their size.
+ *      FBWW_cached     - Blocks are read on demand into a `FBWW_sector_cache` of fixed size; memory stays the same however large
+ *                        the file. A view can not cross a 4096-byte block (`FBWW_view_limit`; `FBWW_copy` can), and is only valid
+ *                        until the next view. Also the fallback for files that cannot be mapped and are larger than the cache budget.
+ * */
+enum class FileAPI_backend: ut_BYTE
+{
+    FBWW_mapped     = 0x0,
+    FBWW_buffered   = 0x1,
+    FBWW_probe      = 0x2,
+    FBWW_cached     = 0x3
+};
+
+#define FBWW_probe_size         0x200
+#define FBWW_pipe_buffer_size   0x10000
+
+/* A file opened, and possibly read, ahead of time (`DotDoc_AsyncIO`); `FileAPI` takes over the descriptor and the data.
+ *      std::string path - The file.
+ *      nt_DWORD fd - Its descriptor; -1 if it could not be opened ahead of time, `FileAPI` then opens it (or fails to) itself.
+ *      ut_BYTE *data - The first `loaded` bytes of the file (`new[]`'d); `nullptr` if none were read, `FileAPI` then picks a
+ *                      backend for the descriptor as usual.
+ *      ut_LSIZE size - Size of the file.
+ *      DotDoc_Arena *arena - The arena to decode the file in, lent by its owner (`DotDoc_Session`) and never released by `FileAPI`;
+ *                            `nullptr` takes one from the thread's free list.
+ * */
+struct FBWW_preloaded
+{
+    std::string     path;
+    nt_DWORD        fd = -1;
+    ut_BYTE         *data = nullptr;
+    ut_LSIZE        size = 0;
+    ut_LSIZE        loaded = 0;
+    DotDoc_Arena    *arena = nullptr;
+};
+
 /* FileAPI - class that extensively works with reading from/writing to a file.
  *           This class will be capable of transitioning from reading a file to writing to the file
  *           when needed. When initiated, the file passed to the constructor `FileAPI` will be opened in Read Binary (rb) mode.
@@ -57,7 +402,17 @@ concept BYTE_WORD_DWORD = requires {
  *      FILE *FBWW - File Being Worked With; the file being read from/written to.
  *      ut_LSIZE seek_pos - The current position in the file. This gets set anytime we read from the file,
  *                          write to the file, or use `fseek`.
- *      _dot_doc_header *WDBF_header - Structure representing the entire header of the Word Document Binary File (WDBF).
+ *      ut_BYTE *all_file_data - The file data; either the private mapping of the file or the heap buffer it was read into.
+ *                               `nullptr` with the sector cache.
+ *      FBWW_sector_cache *cache - The sector cache; only with `FileAPI_backend::FBWW_cached`.
+ *      ut_LSIZE WDBF_size - Size of the file.
+ *      ut_LSIZE loaded_size - How much of the file is in `all_file_data`; all of it, unless probing.
+ *      FileAPI_backend backend - Which of the above `all_file_data` is.
+ *      FBWW_dirty_ranges dirty - Every range of `all_file_data` that was rewritten; what `FBWW_persist`/`FBWW_persist_to` write out.
+ *      DotDoc_Stats FBWW_stats - Counters and phase timings of the decode session this file belongs to.
+ *      DotDoc_Arena *arena - Where the decode session allocates everything it keeps; from the thread's free list, given back
+ *                            (reset in one step) when the file is released.
+ *      bool arena_lent - `arena` was lent through `FBWW_preloaded`; it is only cleared on release, its owner keeps it.
  *
  */
 class FileAPI
@@ -65,72 +420,449 @@ class FileAPI
 private:
     FILE *FBWW = NULL;
     ut_LSIZE seek_pos = 0;
-    ut_BYTE *read_in_data = nullptr;
     ut_BYTE *all_file_data = nullptr;
     ut_LSIZE WDBF_size = 0;
+    ut_LSIZE loaded_size = 0;
+    FileAPI_backend backend = FileAPI_backend::FBWW_buffered;
+    std::string FBWW_path;
+    FBWW_dirty_ranges dirty;
+    DotDoc_Stats FBWW_stats;
+    FBWW_sector_cache *cache = nullptr;
+    DotDoc_Arena *arena = nullptr;
+    bool arena_lent = false;
 
-public:
-    FileAPI(ut_BYTE *filename)
+    /* Map the file. The mapping is private, so `rewrite` only ever touches our copy of the page and never the file on disk.
+     * `MAP_NORESERVE` keeps the kernel from reserving swap for the whole (writable) mapping up front, which would make mapping
+     * files larger than RAM fail; only the few pages that actually get repaired are ever copied.
+     * Returns false if the file cannot be mapped (empty file, not a regular file, `mmap` failure) so the constructor can fall back
+     * to reading it.
+     * */
+    bool FBWW_map()
+    {
+        struct stat FBWW_stat;
+
+        FBWW_stats.add(stats_counter::syscalls, 2);
+        if(fstat(fileno(FBWW), &FBWW_stat) != 0 || !S_ISREG(FBWW_stat.st_mode) || FBWW_stat.st_size <= 0)
+            return false;
+
+        void *mapping = mmap(NULL, FBWW_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE, fileno(FBWW), 0);
+        if(mapping == MAP_FAILED)
+            return false;
+
+        WDBF_size = loaded_size = FBWW_stat.st_size;
+        all_file_data = ut_BYTE_PTR mapping;
+        backend = FileAPI_backend::FBWW_mapped;
+
+        /* The header sector is read immediately after opening; everything else is read on demand by following sector chains. */
+        FBWW_advise(0, 0x200, MADV_WILLNEED);
+        return true;
+    }
+
+    /* Read the whole file into a heap buffer; what is left when it can not be mapped. A regular file is sized with `fstat`;
+     * anything else (a pipe, `/dev/stdin`) has no size up front and is read to its end, the buffer doubling as it fills.
+     * */
+    void FBWW_buffer()
+    {
+        struct stat FBWW_stat;
+
+        FBWW_stats.add(stats_counter::syscalls);
+        dot_doc_assert(fstat(fileno(FBWW), &FBWW_stat) == 0, "\n%sFile Error:%s\n\tCould not stat `%s`: %s.\n",
+            red, white,
+            FBWW_path.c_str(), strerror(errno))
+
+        bool sized = S_ISREG(FBWW_stat.st_mode);
+        ut_LSIZE capacity = sized ? (ut_LSIZE) FBWW_stat.st_size : FBWW_pipe_buffer_size;
+        all_file_data = new ut_BYTE[capacity];
+
+        /* `read` directly rather than `fread`, so every syscall is counted. */
+        while(!sized || seek_pos < capacity)
+        {
+            if(seek_pos == capacity)
+            {
+                ut_BYTE *grown = new ut_BYTE[capacity * 2];
+                memcpy(grown, all_file_data, seek_pos);
+                delete[] all_file_data;
+                all_file_data = grown;
+                capacity *= 2;
+            }
+
+            ssize_t result = read(fileno(FBWW), all_file_data + seek_pos, capacity - seek_pos);
+            FBWW_stats.add(stats_counter::syscalls);
+
+            if(result < 0 && errno == EINTR)
+                continue;
+
+            dot_doc_assert(result > 0 || (result == 0 && !sized), "\n%sRead Error:%s\n\tThere was an error reading the file.\n",
+                red, white)
+
+            /* End of the pipe. */
+            if(result == 0)
+                break;
+
+            seek_pos += result;
+        }
+
+        WDBF_size = loaded_size = seek_pos;
+        seek_pos = 0;
+        backend = FileAPI_backend::FBWW_buffered;
+    }
+
+    /* `pread` the header block and nothing else. The size comes from `fstat`, so nothing past the header is ever touched;
+     * for something that is not a regular file (a pipe) the size is just what could be read.
+     * */
+    void FBWW_probe_header()
+    {
+        struct stat FBWW_stat;
+
+        FBWW_stats.add(stats_counter::syscalls);
+        dot_doc_assert(fstat(fileno(FBWW), &FBWW_stat) == 0, "\n%sFile Error:%s\n\tCould not stat `%s`: %s.\n",
+            red, white,
+            FBWW_path.c_str(), strerror(errno))
+
+        all_file_data = new ut_BYTE[FBWW_probe_size];
+        backend = FileAPI_backend::FBWW_probe;
+
+        while(loaded_size < FBWW_probe_size)
+        {
+            ssize_t result = pread(fileno(FBWW), all_file_data + loaded_size, FBWW_probe_size - loaded_size, loaded_size);
+            FBWW_stats.add(stats_counter::syscalls);
+
+            if(result < 0 && errno == EINTR)
+                continue;
+
+            dot_doc_assert(result >= 0, "\n%sRead Error:%s\n\tThere was an error reading the file.\n",
+                red, white)
+
+            /* End of file; a file smaller than the header is still probed, and found wanting. */
+            if(result == 0)
+                break;
+
+            loaded_size += result;
+        }
+
+        WDBF_size = S_ISREG(FBWW_stat.st_mode) && (ut_LSIZE) FBWW_stat.st_size > loaded_size ? FBWW_stat.st_size : loaded_size;
+    }
+
+    void FBWW_open_cache(ut_LSIZE cache_budget)
+    {
+        struct stat FBWW_stat;
+
+        FBWW_stats.add(stats_counter::syscalls);
+        dot_doc_assert(fstat(fileno(FBWW), &FBWW_stat) == 0 && S_ISREG(FBWW_stat.st_mode),
+            "\n%sFile Error:%s\n\t`%s` is not a regular file; it can not be read through the sector cache.\n",
+            red, white,
+            FBWW_path.c_str())
+
+        WDBF_size = loaded_size = FBWW_stat.st_size;
+        cache = new FBWW_sector_cache(fileno(FBWW), WDBF_size, cache_budget, FBWW_stats);
+        backend = FileAPI_backend::FBWW_cached;
+    }
+
+    /* Where the bytes at `offset` are kept; for `rewrite_at` and `FBWW_patch`. Bounds are checked by the callers. */
+    ut_BYTE *FBWW_data_at(ut_LSIZE offset)
+    {
+        if(backend != FileAPI_backend::FBWW_cached)
+            return all_file_data + offset;
+
+        return cache->get_block(offset >> FBWW_cache_slot_shift) + (offset & (FBWW_cache_slot_size - 1));
+    }
+
+    /* The arena lent to the session, or one from the thread's free list. */
+    void FBWW_take_arena(DotDoc_Arena *lent_arena)
+    {
+        arena_lent = lent_arena != nullptr;
+        arena = arena_lent ? lent_arena : DotDoc_Arena::acquire();
+    }
+
+    /* Open `filename` and get at its data through `preferred_backend` (or what it falls back to). */
+    void FBWW_open(const nt_BYTE *filename, FileAPI_backend preferred_backend, ut_LSIZE cache_budget,
+                   DotDoc_Arena *lent_arena = nullptr)
     {
-        FBWW = fopen(nt_BYTE_CPTR filename, "rb");
+        FBWW = fopen(filename, "rb");
+        FBWW_path = filename;
 
         dot_doc_assert(FBWW, "\n%sFile Error:%s\n\tThere was an error opening the file `%s`.\n",
             red, white,
             filename)
+
+        FBWW_take_arena(lent_arena);
         
-        /* Get filesize. */
-        fseek(FBWW, 0, SEEK_END);
-        WDBF_size = ftell(FBWW);
-        fseek(FBWW, 0, SEEK_SET);
-
-        all_file_data = new ut_BYTE[WDBF_size];
-        dot_doc_assert(all_file_data, "\n%sMemory Allocation Error:%s\n\tThere was an error allocating memory for file data.\n",
-            red, white)
-        
-        seek_pos = fread(all_file_data, sizeof(*all_file_data), WDBF_size, FBWW);
-        dot_doc_assert(seek_pos == WDBF_size, "\n%sRead Error:%s\n\tThere was an error reading the file.\n",
-            red, white)
+        /* The destructor does not run if the constructor throws; release what was obtained so far before passing the error on. */
+        try
+        {
+            FBWW_open_backend(preferred_backend, cache_budget);
+        }
+        catch(...)
+        {
+            FBWW_release();
+            throw;
+        }
+    }
 
-        /* Go back to the beginning. */
-        seek_pos = 0;
-        fseek(FBWW, seek_pos, SEEK_SET);
+    void FBWW_open_backend(FileAPI_backend preferred_backend, ut_LSIZE cache_budget)
+    {
+        if(preferred_backend == FileAPI_backend::FBWW_probe)
+        {
+            FBWW_probe_header();
+            return;
+        }
+
+        if(preferred_backend == FileAPI_backend::FBWW_cached)
+        {
+            FBWW_open_cache(cache_budget);
+            return;
+        }
+
+        if(preferred_backend == FileAPI_backend::FBWW_mapped && FBWW_map())
+            return;
+
+        /* Reading a file larger than the budget into memory is what the cache is there to avoid; unless asked to. */
+        struct stat FBWW_stat;
+        if(preferred_backend == FileAPI_backend::FBWW_mapped && fstat(fileno(FBWW), &FBWW_stat) == 0 &&
+           S_ISREG(FBWW_stat.st_mode) && (ut_LSIZE) FBWW_stat.st_size > cache_budget)
+        {
+            FBWW_open_cache(cache_budget);
+            return;
+        }
+
+        FBWW_buffer();
+    }
+
+public:
+    /* `cache_budget` is the memory the sector cache may use; only with `FBWW_cached`, or when falling back to it. */
+    FileAPI(ut_BYTE *filename, FileAPI_backend preferred_backend = FileAPI_backend::FBWW_mapped,
+            ut_LSIZE cache_budget = FBWW_default_cache_budget)
+    {
+        auto open_timer = FBWW_stats.time(stats_phase::open);
+        FBWW_open(nt_BYTE_CPTR filename, preferred_backend, cache_budget);
+    }
+
+    /* Take over a file opened ahead of time; its data, if any was read, becomes `all_file_data` (`FBWW_buffered`, or
+     * `FBWW_probe` when that is what was asked for), otherwise the descriptor gets `preferred_backend` as usual.
+     * `preloaded` is left without a descriptor or data either way.
+     * */
+    FileAPI(FBWW_preloaded& preloaded, FileAPI_backend preferred_backend = FileAPI_backend::FBWW_mapped,
+            ut_LSIZE cache_budget = FBWW_default_cache_budget)
+    {
+        auto open_timer = FBWW_stats.time(stats_phase::open);
+
+        all_file_data = preloaded.data;
+        preloaded.data = nullptr;
+
+        FBWW = preloaded.fd >= 0 ? fdopen(preloaded.fd, "rb") : NULL;
+        if(!FBWW && preloaded.fd >= 0) close(preloaded.fd);
+        preloaded.fd = -1;
+
+        if(!FBWW)
+        {
+            delete[] all_file_data;
+            all_file_data = nullptr;
+
+            FBWW_open(preloaded.path.c_str(), preferred_backend, cache_budget, preloaded.arena);
+            return;
+        }
+
+        FBWW_path = preloaded.path;
+        FBWW_take_arena(preloaded.arena);
+
+        if(all_file_data)
+        {
+            WDBF_size = preloaded.size;
+            loaded_size = preloaded.loaded;
+            backend = preferred_backend == FileAPI_backend::FBWW_probe ? FileAPI_backend::FBWW_probe : FileAPI_backend::FBWW_buffered;
+            return;
+        }
+
+        try
+        {
+            FBWW_open_backend(preferred_backend, cache_budget);
+        }
+        catch(...)
+        {
+            FBWW_release();
+            throw;
+        }
+    }
+
+    FileAPI_backend get_backend()
+    { return backend; }
+
+    DotDoc_Stats& get_stats()
+    { return FBWW_stats; }
+
+    /* The decode session's arena; everything allocated in it is gone once this file is released. */
+    DotDoc_Arena& get_arena()
+    { return *arena; }
+
+    ut_LSIZE get_size()
+    { return WDBF_size; }
+
+    const std::string& get_path()
+    { return FBWW_path; }
+
+    /* `fstat` the file; false if that failed. */
+    bool FBWW_get_stat(struct stat& file_stat)
+    {
+        FBWW_stats.add(stats_counter::syscalls);
+        return fstat(fileno(FBWW), &file_stat) == 0;
+    }
+
+    /* Bytes that can be viewed; `get_size()`, unless probing. */
+    ut_LSIZE get_loaded_size()
+    { return loaded_size; }
+
+    /* Memory the sector cache holds; zero without it. */
+    ut_LSIZE get_cache_budget()
+    { return cache ? cache->get_budget() : 0; }
+
+    /* Whether reads go through the sector cache; views are then only valid until the next view. */
+    bool FBWW_is_cached()
+    { return backend == FileAPI_backend::FBWW_cached; }
+
+    /* The most bytes, starting at `offset`, that one `FBWW_view` can return; the rest of the block with the sector cache. */
+    ut_LSIZE FBWW_view_limit(ut_LSIZE offset)
+    {
+        if(offset >= loaded_size) return 0;
+        if(backend != FileAPI_backend::FBWW_cached) return loaded_size - offset;
+
+        ut_LSIZE block_left = FBWW_cache_slot_size - (offset & (FBWW_cache_slot_size - 1));
+        return block_left < loaded_size - offset ? block_left : loaded_size - offset;
+    }
+
+    /* Read `length` bytes at `offset` ahead of time: the rest of a chain, or a stream about to be read. Only the sector cache
+     * needs it; mapped pages are read ahead by the kernel already.
+     * */
+    void FBWW_readahead(ut_LSIZE offset, ut_LSIZE length)
+    {
+        if(backend == FileAPI_backend::FBWW_cached)
+            cache->readahead(offset, length);
+    }
+
+    /* Give the kernel a paging hint (`MADV_*`) for a region of the file.
+     * Does nothing when the file was read into a heap buffer.
+     * */
+    void FBWW_advise(ut_LSIZE offset, ut_LSIZE length, nt_DWORD advice)
+    {
+        if(backend != FileAPI_backend::FBWW_mapped || offset >= WDBF_size)
+            return;
+
+        /* `madvise` wants a page-aligned address. */
+        ut_LSIZE page_size = sysconf(_SC_PAGESIZE);
+        ut_LSIZE aligned_offset = offset & ~(page_size - 1);
+
+        if(length > WDBF_size - offset) length = WDBF_size - offset;
+        FBWW_stats.add(stats_counter::syscalls);
+        madvise(all_file_data + aligned_offset, length + (offset - aligned_offset), advice);
+    }
+
+    /* Get a view of `length` bytes at `offset` without moving `seek_pos`.
+     * The view points directly into the file data; it is valid for as long as this instance is.
+     * */
+    const ut_BYTE *FBWW_view(ut_LSIZE offset, ut_LSIZE length)
+    {
+        dot_doc_assert(offset <= loaded_size && length <= loaded_size - offset,
+            "\n\t%sRead Error:%s\n\tThe WDBF is only %llX (%lld) bytes in size (%llX loaded), the program is attempting to view %llX (%lld) bytes at offset %llX.\n",
+            red, white,
+            WDBF_size, WDBF_size, loaded_size,
+            length, length,
+            offset)
+
+        FBWW_stats.add(stats_counter::bytes_read, length);
+
+        if(backend == FileAPI_backend::FBWW_cached)
+        {
+            if(length == 0)
+                return nullptr;
+
+            dot_doc_assert(length <= FBWW_view_limit(offset),
+                "\n\t%sRead Error:%s\n\tA view of %llX bytes at offset %llX crosses a cache block; use `FBWW_copy`.\n",
+                red, white,
+                length, offset)
+
+            return FBWW_data_at(offset);
+        }
+
+        return all_file_data + offset;
+    }
+
+    /* Copy `length` bytes at `offset` to `destination`; works across cache blocks. */
+    void FBWW_copy(ut_LSIZE offset, ut_LSIZE length, ut_BYTE *destination)
+    {
+        dot_doc_assert(offset <= loaded_size && length <= loaded_size - offset,
+            "\n\t%sRead Error:%s\n\tThe WDBF is only %llX (%lld) bytes in size, the program is attempting to copy %llX (%lld) bytes at offset %llX.\n",
+            red, white,
+            WDBF_size, WDBF_size,
+            length, length,
+            offset)
+
+        while(length > 0)
+        {
+            ut_LSIZE amount = length < FBWW_view_limit(offset) ? length : FBWW_view_limit(offset);
+            memcpy(destination, FBWW_view(offset, amount), amount);
+
+            destination += amount;
+            offset += amount;
+            length -= amount;
+        }
     }
 
     void print_seek_pos()
     { printf("Seek Pos: %llX\n", seek_pos); }
 
-    /* `T` can be `ut_BYTE`, `ut_WORD` or `ut_DWORD`.
-     * `bytes` will be multiplied by the size of the variable `bytes`.
-     * So, with `FBWW_read_in<ut_WORD> (4)`, the function will read in four 2-byte values (8 bytes in total).
+    /* Cursor reads.
+     * All of these read at `seek_pos` and move `seek_pos` past what was read. Reads are bounds-checked, little-endian and never allocate;
+     * `read_bytes` returns a view into the file data rather than a copy.
      * */
+    FBWW_span read_bytes(ut_LSIZE length)
+    {
+        FBWW_span view{FBWW_view(seek_pos, length), length};
+        seek_pos += length;
+
+        return view;
+    }
+
     template<typename T>
-        requires BYTE_WORD_DWORD<T>
-    ut_BYTE *FBWW_read_in(T bytes)
+        requires std::integral<T>
+    T read_le()
     {
-        if(read_in_data) delete read_in_data;
+        T value = load_le<T> (FBWW_view(seek_pos, sizeof(T)));
+        seek_pos += sizeof(T);
+
+        return value;
+    }
+
+    ut_BYTE read_u8()
+    { return read_le<ut_BYTE> (); }
+
+    ut_WORD read_u16()
+    { return read_le<ut_WORD> (); }
 
-        read_in_data = new ut_BYTE[bytes * sizeof(bytes)];
+    ut_DWORD read_u32()
+    { return read_le<ut_DWORD> (); }
+
+    ut_LSIZE read_u64()
+    { return read_le<ut_LSIZE> (); }
+
+    /* Positional read; does not move `seek_pos`. */
+    template<typename T>
+        requires std::integral<T>
+    T read_le_at(ut_LSIZE offset)
+    { return load_le<T> (FBWW_view(offset, sizeof(T))); }
 
-        /* Move the position, then make sure it does not exceed the size of the binary file. */
-        seek_pos += bytes * sizeof(bytes);
-        dot_doc_assert(seek_pos <= WDBF_size,
-            "\n\t%sRead Error:%s\n\tThe WDBF is only %llX (%lld) bytes in size, the program is attempting to read %lld bytes beyond the size of the file.\n\tPerhaps try replacing the file.\n",
+    void FBWW_seek(ut_LSIZE position)
+    {
+        dot_doc_assert(position <= WDBF_size,
+            "\n\t%sRead Error:%s\n\tThe WDBF is only %llX (%lld) bytes in size, the program is attempting to seek to %llX.\n",
             red, white,
             WDBF_size, WDBF_size,
-            seek_pos - WDBF_size)
-        
-        ut_LSIZE read_in_size = fread(read_in_data, sizeof(bytes), bytes, FBWW);
-        
-        /* Make sure we read in the correct amount of bytes. */
-        dot_doc_assert(read_in_size == bytes,
-            "\n\t%sRead Error:%s\n\tExpected to read in %lX (%ld) bytes, instead read in only %llX (%lld) bytes.\n",
-            red, white,
-            bytes * sizeof(bytes), bytes * sizeof(bytes),
-            read_in_size, read_in_size)
+            position)
 
-        return read_in_data;
+        seek_pos = position;
     }
 
+    ut_LSIZE FBWW_tell()
+    { return seek_pos; }
+
     /* Seek beyond the current position.
      * This is especially useful when the program is obtaining a 4-byte value and the last
      * two bytes are zero.
@@ -155,7 +887,7 @@ public:
         switch(sizeof(VTTA))
         {
             case 1: {
-                if(VTTA == all_file_data[seek_pos])
+                if(VTTA == *FBWW_view(seek_pos, 1))
                 { 
                     if(!move_if_matches) FBWW_manual_seek(seek_length * -1);
                     return true;
@@ -177,66 +909,263 @@ public:
         return false;
     }
 
-    /* If there was any error with the data, manipulate the values where the reside via
-     * `all_file_data`.
+    /* If there was any error with the data, manipulate the values where they reside via `all_file_data`.
+     * `rewrite` overwrites the `sizeof(value)` bytes that were just read (the bytes right before `seek_pos`),
+     * `rewrite_at` overwrites the bytes at `offset`. Values are stored little-endian.
      * */
     template<typename T>
         requires BYTE_WORD_DWORD<T>
-    void rewrite(T value)
+    void rewrite_at(ut_LSIZE offset, T value)
     {
-        seek_pos -= sizeof(value);
+        dot_doc_assert(offset <= loaded_size && sizeof(value) <= loaded_size - offset,
+            "\n\t%sWrite Error:%s\n\tThe WDBF is only %llX (%lld) bytes in size (%llX loaded), the program is attempting to rewrite %ld bytes at offset %llX.\n",
+            red, white,
+            WDBF_size, WDBF_size, loaded_size,
+            sizeof(value), offset)
 
-        switch(sizeof(value))
-        {
-            case 2: {
-                all_file_data[seek_pos] = value & 0xFF;
-                seek_pos++;
+        dot_doc_assert(sizeof(value) <= FBWW_view_limit(offset),
+            "\n\t%sWrite Error:%s\n\tA rewrite of %ld bytes at offset %llX crosses a cache block.\n",
+            red, white,
+            sizeof(value), offset)
 
-                all_file_data[seek_pos] = (value >> 8) & 0xFF;
-                seek_pos++;
-                break;
-            }
-            case 4: {
-                all_file_data[seek_pos] = value & 0xFF;
-                seek_pos++;
-
-                all_file_data[seek_pos] = (value >> 8) & 0xFF;
-                seek_pos++;
-
-                all_file_data[seek_pos] = (value >> 16) & 0xFF;
-                seek_pos++;
-                
-                all_file_data[seek_pos] = (value >> 24) & 0xFF;
-                seek_pos++;
-                
-                break;
-            }
-            default: break;
-        }
+        ut_BYTE *target = FBWW_data_at(offset);
+
+        /* A cached block holding repairs is kept until they are written out. */
+        if(backend == FileAPI_backend::FBWW_cached)
+            cache->mark_dirty(offset >> FBWW_cache_slot_shift);
+
+        store_le<T> (target, value);
+        dirty.add(offset, sizeof(value));
     }
 
+    template<typename T>
+        requires BYTE_WORD_DWORD<T>
+    void rewrite(T value)
+    { rewrite_at<T> (seek_pos - sizeof(value), value); }
+
     /* Rewrite data at a specific location in the data. */
     template<typename T>
         requires BYTE_WORD_DWORD<T>
     void rewrite_specific(data_locations location, T value)
+    { rewrite_at<T> ((ut_LSIZE) location, value); }
+
+    const FBWW_dirty_ranges& get_dirty_ranges()
+    { return dirty; }
+
+    /* Write the dirty ranges back into the file itself with `pwrite`; nothing else of the file is touched.
+     * Returns the number of bytes written.
+     * */
+    ut_LSIZE FBWW_persist()
+    {
+        if(dirty.empty())
+            return 0;
+
+        nt_DWORD output = open(FBWW_path.c_str(), O_WRONLY);
+        dot_doc_assert(output >= 0, "\n%sWrite Error:%s\n\tCould not open `%s` for writing: %s.\n",
+            red, white,
+            FBWW_path.c_str(), strerror(errno))
+
+        ut_LSIZE written = FBWW_patch(output, FBWW_path.c_str());
+        close(output);
+
+        return written;
+    }
+
+    /* Write the repaired file to `output_path`, leaving the original untouched.
+     * The original is cloned (a reflink, on filesystems that support it) or copied in the kernel (`copy_file_range`), then only the
+     * dirty ranges are written on top. Returns the number of bytes written by the patch (the copy itself is not counted).
+     * */
+    ut_LSIZE FBWW_persist_to(const nt_BYTE *output_path)
     {
-        ut_LSIZE curr_pos = seek_pos;
-        seek_pos = (ut_LSIZE) location;
-        rewrite<T> (value);
-        seek_pos = curr_pos;
+        struct stat input_stat, output_stat;
+        dot_doc_assert(fstat(fileno(FBWW), &input_stat) == 0, "\n%sWrite Error:%s\n\tCould not stat `%s`: %s.\n",
+            red, white,
+            FBWW_path.c_str(), strerror(errno))
+
+        /* Copying a file onto itself would truncate it first. */
+        if(stat(output_path, &output_stat) == 0 && output_stat.st_dev == input_stat.st_dev && output_stat.st_ino == input_stat.st_ino)
+            return FBWW_persist();
+
+        nt_DWORD output = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, input_stat.st_mode & 0777);
+        dot_doc_assert(output >= 0, "\n%sWrite Error:%s\n\tCould not create `%s`: %s.\n",
+            red, white,
+            output_path, strerror(errno))
+
+        try
+        {
+            FBWW_clone(output, output_path);
+            ut_LSIZE written = FBWW_patch(output, output_path);
+
+            close(output);
+            return written;
+        }
+        catch(...)
+        {
+            close(output);
+            throw;
+        }
     }
 
-    ~FileAPI()
+private:
+    /* `pwrite` every dirty range to `output`. */
+    ut_LSIZE FBWW_patch(nt_DWORD output, const nt_BYTE *output_path)
+    {
+        ut_LSIZE written = 0;
+
+        for(const auto& range : dirty)
+        {
+            for(ut_LSIZE offset = range.first; offset < range.second;)
+            {
+                ut_LSIZE length = range.second - offset < FBWW_view_limit(offset) ? range.second - offset : FBWW_view_limit(offset);
+                ssize_t result = pwrite(output, FBWW_data_at(offset), length, offset);
+
+                if(result < 0 && errno == EINTR)
+                    continue;
+
+                dot_doc_assert(result > 0, "\n%sWrite Error:%s\n\tCould not write %llu bytes at offset %llX of `%s`: %s.\n",
+                    red, white,
+                    length, offset, output_path, result < 0 ? strerror(errno) : "nothing was written")
+
+                offset += result;
+                written += result;
+            }
+        }
+
+        dot_doc_assert(fdatasync(output) == 0, "\n%sWrite Error:%s\n\tCould not flush `%s`: %s.\n",
+            red, white,
+            output_path, strerror(errno))
+
+        dirty.clear();
+        return written;
+    }
+
+    /* Make `output` a copy of the file as it is on disk (the repairs only exist in `all_file_data`). */
+    void FBWW_clone(nt_DWORD output, const nt_BYTE *output_path)
+    {
+        nt_DWORD input = fileno(FBWW);
+
+#if defined(FICLONE)
+        /* Shares the extents of the original; no data is copied at all. */
+        if(ioctl(output, FICLONE, input) == 0)
+            return;
+#endif
+
+        ut_LSIZE copied = 0;
+        bool in_kernel = true;
+
+        while(copied < WDBF_size)
+        {
+            ssize_t result = -1;
+
+            if(in_kernel)
+            {
+                loff_t input_offset = copied, output_offset = copied;
+                result = copy_file_range(input, &input_offset, output, &output_offset, WDBF_size - copied, 0);
+
+                /* Not supported between these files (or by this kernel); copy through user space instead. */
+                if(result < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+                {
+                    in_kernel = false;
+                    continue;
+                }
+            }
+            else
+            {
+                ut_BYTE buffer[0x10000];
+                ut_LSIZE chunk = WDBF_size - copied < sizeof(buffer) ? WDBF_size - copied : sizeof(buffer);
+
+                result = pread(input, buffer, chunk, copied);
+                if(result > 0) result = pwrite(output, buffer, result, copied);
+            }
+
+            if(result < 0 && errno == EINTR)
+                continue;
+
+            dot_doc_assert(result > 0, "\n%sWrite Error:%s\n\tCould not copy `%s` to `%s`: %s.\n",
+                red, white,
+                FBWW_path.c_str(), output_path, result < 0 ? strerror(errno) : "unexpected end of file")
+
+            copied += result;
+        }
+    }
+
+    void FBWW_release()
     {
         if(FBWW) fclose(FBWW);
-        if(read_in_data) delete read_in_data;
-        if(all_file_data) delete all_file_data;
 
-        read_in_data = nullptr;
+        if(all_file_data)
+        {
+            if(backend == FileAPI_backend::FBWW_mapped) munmap(all_file_data, WDBF_size);
+            else delete[] all_file_data;
+        }
+
         all_file_data = nullptr;
 
+        delete cache;
+        cache = nullptr;
+
+        if(arena_lent) arena->clear();
+        else DotDoc_Arena::release(arena);
+
+        arena = nullptr;
+        arena_lent = false;
+
         FBWW = NULL;
     }
+
+public:
+    ~FileAPI()
+    { FBWW_release(); }
 };
 
-#endif
\ No newline at end of file
+/* Write `parts`, in order, to a file of their own next to `path` and rename it into place; whoever opens `path` sees the whole
+ * file or the one that was there before, never a torn one. `parts` is used up as it gets written. Returns whether it got written.
+ * */
+inline bool FBWW_replace_file(const nt_BYTE *path, struct iovec *parts, ut_DWORD part_count)
+{
+    std::string temporary_path = std::string(path) + ".tmp." + std::to_string(getpid()) + "." + std::to_string(syscall(SYS_gettid));
+    nt_DWORD output = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = output >= 0;
+
+    while(written && part_count > 0)
+    {
+        if(parts->iov_len == 0)
+        {
+            parts++;
+            part_count--;
+            continue;
+        }
+
+        ssize_t result = writev(output, parts, part_count < IOV_MAX ? part_count : IOV_MAX);
+
+        if(result < 0 && errno == EINTR)
+            continue;
+
+        written = result > 0;
+
+        /* Skip what got written; a part written in part is written from where it stopped. */
+        for(ut_LSIZE done = written ? result : 0; done > 0;)
+        {
+            if(done >= parts->iov_len)
+            {
+                done -= parts->iov_len;
+                parts++;
+                part_count--;
+            }
+            else
+            {
+                parts->iov_base = ut_BYTE_PTR parts->iov_base + done;
+                parts->iov_len -= done;
+                done = 0;
+            }
+        }
+    }
+
+    if(output >= 0) written &= close(output) == 0;
+    written = written && rename(temporary_path.c_str(), path) == 0;
+
+    if(!written && output >= 0) unlink(temporary_path.c_str());
+    return written;
+}
+
+#endif
@@ -1,21 +1,454 @@
 #include <iostream>
 #include "common.hpp"
 
-int main(int args, char *argv[])
+/* Usage:
+ *      main.o <file>                                   - Decode a single file.
+ *      main.o --text [--cache SIZE] [--snapshot FILE] <file>
+ *                                                      - Write the document text, as UTF-8, to stdout.
+ *                                                        `--cache` reads the file through a sector cache of `SIZE` bytes (`4M`,
+ *                                                        `512K`, ...) rather than mapping it; memory then stays the same
+ *                                                        however large the file is.
+ *                                                        `--snapshot` compares the file against the snapshot in `FILE`, left
+ *                                                        there by the last run, and only transcodes the text that changed since;
+ *                                                        what changed is written to stderr (see `dot_doc_snapshot.hpp`).
+ *      main.o --repair <file> [output]                 - Decode a file and save the repaired header; to the file itself, or to `output`.
+ *      main.o --stats [--cache SIZE] [--trace out.json] <file>
+ *                                                      - Decode a file and extract its text, then print the time spent in each phase
+ *                                                        and the counters (see `dot_doc_stats.hpp`); `--trace` also writes the
+ *                                                        phases as a Chrome trace.
+ *      main.o --probe <file>                           - Classify a file from its first 512 bytes alone (valid, repairable, damaged or
+ *                                                        not a compound file); nothing else of the file is read.
+ *      main.o --metadata [--cache SIZE] [--format F] <file>
+ *                                                      - Write the title, author, dates, counts, ... of a file, one record as
+ *                                                        `--batch` writes them; nothing but the header, FAT, directory and the
+ *                                                        two property set streams is read (see `dot_doc_metadata/NOTE`).
+ *      main.o --batch [--jobs N] [--format F] [--cache SIZE] [--io-depth N] [--sidecars DIR] [--probe|--metadata] [--stats] [--trace out.json] <file|directory>...
+ *                                                      - Decode many files across all cores; directories are walked for `.doc` files.
+ *                                                        `F` is `human` (default), `json` (JSON lines) or `binary` (see `dot_doc_sink.hpp`).
+ *                                                        `--io-depth` is how many files are opened and read ahead of the workers
+ *                                                        (io_uring, or threads without it; 64 by default, 0 to have every worker
+ *                                                        open its own files).
+ *                                                        `--sidecars` keeps a sidecar index of every file in `DIR` and decodes
+ *                                                        from it while the file is unchanged, skipping the header, FAT and
+ *                                                        directory (see `dot_doc_structure/dot_doc_sidecar.hpp`).
+ *                                                        `--probe` probes rather than decodes every file, `--metadata` only
+ *                                                        reads the properties of every file (as `--metadata` does).
+ *                                                        `--stats` prints per-phase mean/p50/p90/p99/max over the batch to stderr.
+ *      main.o --batch [--jobs N] [--format F] [--cache SIZE] [--io-depth N] [--sidecars DIR] [--probe|--metadata] [--stats] [--trace out.json] -
+ *                                                      - Same, with the paths read (one per line) from stdin.
+ *      main.o --serve [--jobs N] [--cache SIZE] [--sidecars DIR] [--snapshots DIR] <socket>
+ *                                                      - Stay resident and decode the files sent over the Unix socket `socket`,
+ *                                                        one job per line (`info`, `text`, `probe` or `metadata` and a path; see
+ *                                                        `dot_doc_server.hpp`). Stops on SIGINT/SIGTERM.
+ *                                                        `--snapshots` keeps a snapshot of every file a `text` job is sent for in
+ *                                                        `DIR`, so the text of a file sent again after an edit is only extracted
+ *                                                        where it changed.
+ * */
+#if DOT_DOC_STATS
+/* Allocation counts for `--stats`; every allocation bumps the calling thread's `dot_doc_thread_allocations`.
+ * They pair `malloc` with `free`; GCC sees the inlined `free` under `delete[]` and warns about a mismatch that is not there.
+ * */
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t size)
+{
+    dot_doc_thread_allocations++;
+    if(void *allocation = malloc(size ? size : 1)) return allocation;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    dot_doc_thread_allocations++;
+    if(void *allocation = malloc(size ? size : 1)) return allocation;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *allocation) noexcept
+{ free(allocation); }
+
+void operator delete[](void *allocation) noexcept
+{ free(allocation); }
+
+void operator delete(void *allocation, size_t) noexcept
+{ free(allocation); }
+
+void operator delete[](void *allocation, size_t) noexcept
+{ free(allocation); }
+#endif
+
+/* `SIZE` of `--cache`; bytes, or `K`/`M`/`G` of them. */
+ut_LSIZE parse_cache_budget(const nt_BYTE *size)
+{
+    nt_BYTE *unit;
+    ut_LSIZE budget = strtoull(size, &unit, 10);
+
+    switch(toupper(*unit))
+    {
+        case 'K': budget <<= 10; break;
+        case 'M': budget <<= 20; break;
+        case 'G': budget <<= 30; break;
+        default: break;
+    }
+
+    dot_doc_assert(budget > 0, "\n%sArgument Error:%s\n\t`--cache` expects a size, e.g. `4M`. Got `%s`.\n",
+        red, white,
+        size)
+
+    return budget;
+}
+
+/* `F` of `--format`. */
+dot_doc_sink_format parse_format(const nt_BYTE *format)
+{
+    if(strcmp(format, "human") == 0) return dot_doc_sink_format::human;
+    if(strcmp(format, "json") == 0) return dot_doc_sink_format::JSON_lines;
+    if(strcmp(format, "binary") == 0) return dot_doc_sink_format::binary;
+
+    dot_doc_error("\n%sArgument Error:%s\n\t`--format` expects `human`, `json` or `binary`. Got `%s`.\n",
+        red, white,
+        format)
+}
+
+/* `DIR` of `--sidecars` (or `--snapshots`, given as `option`); created if it is not there yet. */
+const nt_BYTE *parse_directory(const nt_BYTE *option, const nt_BYTE *directory)
+{
+    std::error_code directory_error;
+    std::filesystem::create_directories(directory, directory_error);
+
+    dot_doc_assert(std::filesystem::is_directory(directory, directory_error),
+        "\n%sArgument Error:%s\n\t`%s` expects a directory to keep its files in. Could not use `%s`.\n",
+        red, white,
+        option, directory)
+
+    return directory;
+}
+
+int dot_doc_batch_main(int args, char *argv[])
+{
+    ut_DWORD jobs = 0;
+    dot_doc_sink_format format = dot_doc_sink_format::human;
+    ut_LSIZE cache_budget = 0;
+    ut_DWORD io_depth = dot_doc_io_default_depth;
+    bool collect_stats = false, probe = false, metadata_only = false;
+    const nt_BYTE *trace_path = nullptr, *sidecar_directory = nullptr;
+    int arg = 2;
+
+    for(; arg < args; arg++)
+    {
+        if(strcmp(argv[arg], "--stats") == 0)
+        {
+            collect_stats = true;
+            continue;
+        }
+
+        if(strcmp(argv[arg], "--probe") == 0)
+        {
+            probe = true;
+            continue;
+        }
+
+        if(strcmp(argv[arg], "--metadata") == 0)
+        {
+            metadata_only = true;
+            continue;
+        }
+
+        if(arg + 1 >= args) break;
+
+        if(strcmp(argv[arg], "--jobs") == 0)
+        {
+            dot_doc_assert(atoi(argv[arg + 1]) > 0, "\n%sArgument Error:%s\n\t`--jobs` expects a positive number.\n",
+                red, white)
+
+            jobs = atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "--format") == 0) format = parse_format(argv[++arg]);
+        else if(strcmp(argv[arg], "--trace") == 0) trace_path = argv[++arg];
+        else if(strcmp(argv[arg], "--sidecars") == 0) sidecar_directory = parse_directory("--sidecars", argv[++arg]);
+        else if(strcmp(argv[arg], "--cache") == 0) cache_budget = parse_cache_budget(argv[++arg]);
+        else if(strcmp(argv[arg], "--io-depth") == 0)
+        {
+            dot_doc_assert(isdigit(argv[arg + 1][0]), "\n%sArgument Error:%s\n\t`--io-depth` expects a number; 0 turns reading ahead off.\n",
+                red, white)
+
+            io_depth = atoi(argv[++arg]);
+        }
+        else break;
+    }
+
+    dot_doc_assert(arg < args, "\n%sArgument Error:%s\n\tExpected files, directories or `-` (read paths from stdin) after `--batch`.\n",
+        red, white)
+
+    DotDoc_Batch batch(jobs, format);
+    if(cache_budget) batch.use_sector_cache(cache_budget);
+    if(probe) batch.probe_only();
+    if(metadata_only) batch.read_metadata_only();
+    if(sidecar_directory) batch.use_sidecars(sidecar_directory);
+    batch.use_async_io(io_depth);
+    if(collect_stats) batch.collect_stats();
+    if(trace_path) batch.write_trace_to(trace_path);
+
+    for(; arg < args; arg++)
+    {
+        if(strcmp(argv[arg], "-") == 0) batch.add_paths_from(stdin);
+        else batch.add_path(argv[arg]);
+    }
+
+    return batch.finish();
+}
+
+int dot_doc_serve_main(int args, char *argv[])
+{
+    ut_DWORD jobs = 0;
+    ut_LSIZE cache_budget = 0;
+    const nt_BYTE *sidecar_directory = nullptr, *snapshot_directory = nullptr;
+    int arg = 2;
+
+    for(; arg + 1 < args; arg++)
+    {
+        if(strcmp(argv[arg], "--jobs") == 0)
+        {
+            dot_doc_assert(atoi(argv[arg + 1]) > 0, "\n%sArgument Error:%s\n\t`--jobs` expects a positive number.\n",
+                red, white)
+
+            jobs = atoi(argv[++arg]);
+        }
+        else if(strcmp(argv[arg], "--cache") == 0) cache_budget = parse_cache_budget(argv[++arg]);
+        else if(strcmp(argv[arg], "--sidecars") == 0) sidecar_directory = parse_directory("--sidecars", argv[++arg]);
+        else if(strcmp(argv[arg], "--snapshots") == 0) snapshot_directory = parse_directory("--snapshots", argv[++arg]);
+        else break;
+    }
+
+    dot_doc_assert(arg + 1 == args, "\n%sArgument Error:%s\n\tExpected the path of the socket to listen on after `--serve`.\n",
+        red, white)
+
+    DotDoc_Server server(argv[arg], jobs, cache_budget, sidecar_directory, snapshot_directory);
+    return server.run();
+}
+
+int dot_doc_text_main(int args, char *argv[])
+{
+    const nt_BYTE *snapshot_path = nullptr;
+    ut_LSIZE cache_budget = 0;
+    int arg = 2;
+
+    for(; arg + 1 < args; arg += 2)
+    {
+        if(strcmp(argv[arg], "--cache") == 0) cache_budget = parse_cache_budget(argv[arg + 1]);
+        else if(strcmp(argv[arg], "--snapshot") == 0) snapshot_path = argv[arg + 1];
+        else break;
+    }
+
+    dot_doc_assert(arg < args, "\n%sArgument Error:%s\n\tExpected file as input after `--text`.\n",
+        red, white)
+
+    DotDoc_File WDBF(ut_BYTE_PTR argv[arg], true,
+        cache_budget ? FileAPI_backend::FBWW_cached : FileAPI_backend::FBWW_mapped, cache_budget);
+    WDBF.decode();
+
+    std::string text;
+
+    if(snapshot_path)
+    {
+        DotDoc_Snapshot snapshot;
+        bool had_snapshot = snapshot.load(snapshot_path);
+
+        snapshot.compare(WDBF);
+        snapshot.extract_text(WDBF, text);
+
+        if(!snapshot.save(snapshot_path, text))
+            fprintf(stderr, "Could not save the snapshot `%s`.\n", snapshot_path);
+
+        /* What changed goes to stderr; stdout has nothing but the text. */
+        fprintf(stderr, "%s: %s; %u of %u sectors, %u FAT entries and %zu stream(s) changed",
+            argv[arg], had_snapshot ? "compared against the snapshot" : "no snapshot", snapshot.get_changed_sector_count(),
+            snapshot.get_sector_count(), snapshot.get_changed_FAT_entries(), snapshot.get_changed_streams().size());
+
+        const std::vector<ut_DWORD>& changed_streams = snapshot.get_changed_streams();
+        for(ut_DWORD i = 0; i < changed_streams.size() && i < 8; i++)
+            fprintf(stderr, "%s `%s`", i == 0 ? ":" : ",", WDBF.get_directory()->get_printable_name(changed_streams[i]).c_str());
+
+        if(changed_streams.size() > 8) fprintf(stderr, ", ...");
+
+        fprintf(stderr, "%s; %llu bytes of text reused, %llu transcoded.\n",
+            snapshot.is_transaction_changed() ? " (new transaction signature)" : "",
+            snapshot.get_reused_bytes(), snapshot.get_transcoded_bytes());
+    }
+    else
+        WDBF.extract_text(text);
+
+    fwrite(text.data(), 1, text.size(), stdout);
+    if(!text.empty() && text.back() != '\n') fputc('\n', stdout);
+
+    return 0;
+}
+
+int dot_doc_metadata_main(int args, char *argv[])
+{
+    dot_doc_sink_format format = dot_doc_sink_format::human;
+    ut_LSIZE cache_budget = 0;
+    int arg = 2;
+
+    for(; arg + 1 < args; arg += 2)
+    {
+        if(strcmp(argv[arg], "--cache") == 0) cache_budget = parse_cache_budget(argv[arg + 1]);
+        else if(strcmp(argv[arg], "--format") == 0) format = parse_format(argv[arg + 1]);
+        else break;
+    }
+
+    dot_doc_assert(arg < args, "\n%sArgument Error:%s\n\tExpected file as input after `--metadata`.\n",
+        red, white)
+
+    FBWW_preloaded file;
+    file.path = argv[arg];
+
+    struct dot_doc_file_result result;
+    bool decoded = DotDoc_Batch::decode_into(file, result, false, cache_budget, false, nullptr, nullptr, nullptr, true);
+
+    DotDoc_Sink *sink = DotDoc_Sink::get_sink(format);
+    sink->write_result(result);
+    delete sink;
+
+    return decoded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int dot_doc_probe_main(int args, char *argv[])
+{
+    dot_doc_assert(args > 2, "\n%sArgument Error:%s\n\tExpected file as input after `--probe`.\n",
+        red, white)
+
+    DotDoc_Header WDBFH(ut_BYTE_PTR argv[2], true, FileAPI_backend::FBWW_probe);
+    WDBF_probe_verdict verdict = WDBFH.probe_WDBF_heading();
+
+    printf("%s: %s", argv[2], get_probe_verdict_name(verdict));
+    if(verdict == WDBF_probe_verdict::WDBF_valid || verdict == WDBF_probe_verdict::WDBF_repairable)
+        printf(" (v%d, %llu-byte sectors, %u flaw(s))", WDBFH.get_WDBF_header()->CFB_major_version,
+            WDBFH.get_WDBF_header()->get_sector_size(), WDBFH.get_flaw_count());
+    printf("\n");
+
+    return verdict == WDBF_probe_verdict::WDBF_valid || verdict == WDBF_probe_verdict::WDBF_repairable ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int dot_doc_stats_main(int args, char *argv[])
+{
+    const nt_BYTE *trace_path = nullptr;
+    ut_LSIZE cache_budget = 0;
+    int arg = 2;
+
+    for(; arg + 1 < args; arg += 2)
+    {
+        if(strcmp(argv[arg], "--trace") == 0) trace_path = argv[arg + 1];
+        else if(strcmp(argv[arg], "--cache") == 0) cache_budget = parse_cache_budget(argv[arg + 1]);
+        else break;
+    }
+
+    dot_doc_assert(arg < args, "\n%sArgument Error:%s\n\tExpected file as input after `--stats`.\n",
+        red, white)
+
+    DotDoc_File WDBF(ut_BYTE_PTR argv[arg], true,
+        cache_budget ? FileAPI_backend::FBWW_cached : FileAPI_backend::FBWW_mapped, cache_budget);
+    WDBF.decode();
+
+    /* A document without readable text still has statistics for everything up to the text. */
+    std::string text;
+    try
+    {
+        WDBF.extract_text(text);
+    }
+    catch(dot_doc_fatal_error& fatal_error)
+    {
+        fprintf(stderr, "No text extracted:%s", fatal_error.what());
+    }
+
+    DotDoc_Stats& stats = WDBF.get_header()->get_fapi()->get_stats();
+    printf("%s (%llu bytes of text):\n\n", argv[arg], (ut_LSIZE) text.size());
+    stats.print(stdout);
+
+    if(trace_path)
+    {
+        FILE *trace = fopen(trace_path, "w");
+        dot_doc_assert(trace, "\n%sArgument Error:%s\n\tCould not create the trace `%s`.\n",
+            red, white,
+            trace_path)
+
+        bool first = true;
+        fputs("{\"traceEvents\":[\n", trace);
+        stats.write_trace(trace, argv[arg], first);
+        fputs("\n]}\n", trace);
+        fclose(trace);
+
+        printf("\nTrace written to `%s`.\n", trace_path);
+    }
+
+    return 0;
+}
+
+int dot_doc_repair_main(int args, char *argv[])
+{
+    dot_doc_assert(args > 2, "\n%sArgument Error:%s\n\tExpected file as input after `--repair`.\n",
+        red, white)
+
+    const nt_BYTE *output_path = args > 3 ? argv[3] : nullptr;
+
+    DotDoc_File WDBF(ut_BYTE_PTR argv[2], true);
+    WDBF.decode();
+
+    ut_LSIZE range_count = WDBF.get_header()->get_fapi()->get_dirty_ranges().get_range_count();
+    ut_LSIZE written = WDBF.save_repairs(output_path);
+
+    printf("%u flaw(s) repaired; wrote %llu byte(s) in %llu range(s) to `%s`.\n",
+        WDBF.get_header()->get_flaw_count(), written, range_count, output_path ? output_path : argv[2]);
+
+    return 0;
+}
+
+int dot_doc_main(int args, char *argv[])
 {
     dot_doc_assert(args > 1, "\n%sArgument Error:%s\n\tExpected file as input.\n",
         red, white)
     
+    if(strcmp(argv[1], "--batch") == 0)
+        return dot_doc_batch_main(args, argv);
+
+    if(strcmp(argv[1], "--serve") == 0)
+        return dot_doc_serve_main(args, argv);
+
+    if(strcmp(argv[1], "--text") == 0)
+        return dot_doc_text_main(args, argv);
+
+    if(strcmp(argv[1], "--repair") == 0)
+        return dot_doc_repair_main(args, argv);
+
+    if(strcmp(argv[1], "--probe") == 0)
+        return dot_doc_probe_main(args, argv);
+
+    if(strcmp(argv[1], "--metadata") == 0)
+        return dot_doc_metadata_main(args, argv);
+
+    if(strcmp(argv[1], "--stats") == 0)
+        return dot_doc_stats_main(args, argv);
+
     /* Make sure the file starts with a ASCII-based value. */
     dot_doc_assert(is_ascii(argv[1][0]), "\n%sArgument Error:%s\n\tThe argument needs to start with an ASCII-based value. Got `%c`.\n",
         red, white,
         argv[1][0])
     
-    /* WDBFH - Word Document Binary Format Heading. */
-    DotDoc_Header *WDBFH = new DotDoc_Header(ut_BYTE_PTR argv[1]);
-    WDBFH->gather_WDBF_heading();
-
-    WDBFH->delete_instance(WDBFH);//delete WDBFH;
+    DotDoc_File WDBF(ut_BYTE_PTR argv[1]);
+    WDBF.decode();
 
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int args, char *argv[])
+{
+    try
+    {
+        return dot_doc_main(args, argv);
+    }
+    catch(dot_doc_fatal_error& fatal_error)
+    {
+        fprintf(stderr, "%s", fatal_error.what());
+        return EXIT_FAILURE;
+    }
+}